@@ -13,8 +13,33 @@
 
 #define Logfile Falloc
 
+#if Yal_mmap_reserve
+// growth policy for address space reserved after a large block
+static size_t mmap_rsvlen(size_t len)
+{
+  size_t maxlen = (size_t)1 << min(Mmap_reserve_max,Vmbits - 4);
+
+  return min(len << Mmap_reserve_shift,maxlen);
+}
+
+// map len followed by a reservation. nil if not available
+static void *mmap_reserve(heap Unused *hb,mpregion *reg,size_t len)
+{
+  size_t rsvlen = mmap_rsvlen(len);
+  void *p;
+
+  if (mem_charge(len) == 0) return nil; // reservation itself is not counted
+  p = osmreserve(len,rsvlen);
+  if (p == nil) { mem_uncharge(len); return nil; }
+  Atomad(global_mapadd,1,Monone);
+  reg->rsvlen = rsvlen;
+  ystats(hb->stat.mreserves)
+  return p;
+}
+#endif
+
 // large blocks. aligned_alloc returns the user ptr midway.
-static mpregion *yal_mmap(heapdesc *hd,heap *hb,size_t len,size_t ulen,enum Loc loc,ub4 fln)
+static mpregion *yal_mmap(heapdesc Unused *hd,heap *hb,size_t len,size_t ulen,enum Loc loc,ub4 fln)
 {
   size_t ip,alen,rlen;
   void *p;
@@ -51,8 +76,15 @@ static mpregion *yal_mmap(heapdesc *hd,heap *hb,size_t len,size_t ulen,enum Loc
 
     // Atomset(hb->lock,0,Morel); // todo syscall not under lock
 
-    p = osmem(Fln,hb->id,len,"alloc > mmap_max");
+    p = nil;
+    mem_drop(hb,alen);
+#if Yal_mmap_reserve
+    if ( (Yal_mmap_reserve > 1 || loc == Lreal) && alen >= (1ul << Mmap_reserve_order)) p = mmap_reserve(hb,reg,alen);
+    if (p == nil)
+#endif
+    p = osmem(Fln,hb->id,alen,"alloc > mmap_max");
     if (p == nil) return nil;
+    osnodebind(hb,p,alen);
     ip = (size_t)p;
     ycheck(nil,loc,ip & Pagesize1,"mmap %zx not page aligned",ip)
     reg->len = alen;
@@ -62,10 +94,16 @@ static mpregion *yal_mmap(heapdesc *hd,heap *hb,size_t len,size_t ulen,enum Loc
   vg_mem_noaccess(ip,alen)
   if (loc == Lcalloc) {
     vg_mem_def(ip,len)
-    if (reg->clr) memset((void *)ip,0,ulen);
+    if (reg->clr) {
+      ystats2(hb->stat.callocclear,ulen)
+      memset((void *)ip,0,ulen);
+    } else {
+      ystats2(hb->stat.calloczero,ulen)
+    }
   } else {
     vg_mem_undef(ip,ulen)
   }
+  reg->clr = 1; // for next use
 
 #if 0 // todo see above
   zero = 0;
@@ -106,15 +144,16 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
   ub4 pos,nxpos,claseq;
   Ub8 clasmsk,fremsk,msk;
   ub4 clascnt,threshold;
+  bool usebump;
   ub4 ord,cord;
   ub4 iter;
-  ub4 xpct;
+  ub4 Unused xpct;
 
-  if (ulen < 64) { // small
+  if (ulen < Tabclas) { // small, or all below Smalclas for profiled classes
     len = (ub4)ulen;
     clas = len2clas[len];
     alen = clas2len[clas];
-    ord = clas;
+    ord = len < 64 ? clas : 32 - clz(len);
     clen = 4;
 
     ydbg2(Fln,Lnone,"clas %2u for len %5u",clas,len);
@@ -155,18 +194,18 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
   }
   ycheck(nil,loc,clas >= Xclascnt,"class %u for len  %zu` out of range %u",clas,ulen,Xclascnt)
 
-  clascnt = hb->clascnts[clas] & Hi31;
+  clascnt = hb->clasinf[clas].cnt & Hi31;
 
   if (unlikely(clascnt == 0)) {
-    hb->claslens[clas] = alen;
-    hb->cfremsk[clas] = 0xfffffffful;
+    hb->clasinf[clas].len = alen;
+    hb->clasinf[clas].fremsk = 0xfffffffful;
     ydbg2(Fln,Lnone,"clas %2u for len %5u`",clas,len);
   }
 #if Yal_enable_check
-  else if (hb->claslens[clas] != alen) { error(loc,"ulen %zu clas %u alen %u vs %u",ulen,clas,alen,hb->claslens[clas]) return nil; }
+  else if (hb->clasinf[clas].len != alen) { error(loc,"ulen %zu clas %u alen %u vs %u",ulen,clas,alen,hb->clasinf[clas].len) return nil; }
 #endif
 
-  hb->clascnts[clas] = clascnt + 1;
+  hb->clasinf[clas].cnt = clascnt + 1;
 
   // mmap ?
   if (unlikely(ulen >= mmap_limit)) {
@@ -189,7 +228,11 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
 
   // bump ?
   threshold = max(Clas_threshold >> (ord / 2),3);
-  if (unlikely(clascnt < threshold && len <= min(Bumplen,Bumpmax) )) { // size class not popular yet
+  usebump = clascnt < threshold;
+#if Yal_clas_adapt
+  usebump = clas_adapt(hd,hb,clas,loc == Lreal ? len + (len >> 2) : len,usebump);
+#endif
+  if (unlikely(usebump && len <= min(Bumplen,Bumpmax) )) { // size class not popular yet
     ypush(hd,loc,Fln)
     if (likely(loc != Lreal)) len = ulen4;
     else len = ulen4 + (ulen4 >> 2); // plus ~25% headroom
@@ -205,7 +248,7 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
 
   // regular slab
   clasregs = hb->clasregs + clas * Clasregs;
-  fremsk = hb->cfremsk[clas];
+  fremsk = hb->clasinf[clas].fremsk;
 
 #if Yal_enable_check > 1
   Ub8 trymsk = fremsk;
@@ -217,9 +260,9 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
   }
 #endif
 
-  pos = hb->claspos[clas];
+  pos = hb->clasinf[clas].pos;
   ycheck(nil,loc,pos >= Clasregs,"clas %u pos %u",clas,pos)
-  ydbg2(Fln,loc,"clas %u pos %u msk %lx %lx",clas,pos,hb->clasmsk[clas],fremsk);
+  ydbg2(Fln,loc,"clas %u pos %u msk %lx %lx",clas,pos,hb->clasinf[clas].msk,fremsk);
 
   iter = Clasregs * 2 + 2;
   do {
@@ -227,7 +270,7 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
     if (unlikely(loc == Lreal && clen > 1)) { // try headroom if available
       nxclasregs = clasregs + Clasregs;
       nxclas = clas + 1;
-      nxpos = hb->claspos[nxclas];
+      nxpos = hb->clasinf[nxclas].pos;
       nxreg = nxclasregs[nxpos];
       if (nxreg) { openreg(nxreg) }
       if (nxreg && (nxreg->binpos || nxreg->inipos < nxreg->celcnt) ) { // has space
@@ -238,7 +281,7 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
         pos = nxpos;
         clasregs = nxclasregs;
         alen = reg->cellen;
-        fremsk = hb->cfremsk[clas];
+        fremsk = hb->clasinf[clas].fremsk;
       }
     }
 
@@ -253,7 +296,7 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
         for (nx = 1; nx < 3; nx++) {
           nxclas = clas + nx;
           nxclasregs = hb->clasregs + nxclas * Clasregs;
-          nxpos = hb->claspos[nxclas];
+          nxpos = hb->clasinf[nxclas].pos;
           ycheck(nil,loc,nxpos >= Clasregs,"clas %u pos %u",clas,nxpos)
           nxreg = nxclasregs[nxpos];
           if (nxreg) { openreg(nxreg) }
@@ -263,12 +306,12 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
             ycheck(nil,loc,reg->cellen < len,"region %.01llu clas %u cellen %u len %u.%u tag %.01u",reg->uid,clas,reg->cellen,len,len,tag)
             vg_mem_def(reg,sizeof(region))
             vg_mem_def(reg->meta,reg->metalen)
-            ydbg2(Fln,Lnone,"reg %.01llu clas %u use %u len %u,%u for %u",reg->uid,clas,nxclas,hb->claslens[nxclas],reg->cellen,alen);
+            ydbg2(Fln,Lnone,"reg %.01llu clas %u use %u len %u,%u for %u",reg->uid,clas,nxclas,hb->clasinf[nxclas].len,reg->cellen,alen);
             clas = nxclas;
             pos = nxpos;
             alen = reg->cellen;
             clasregs = hb->clasregs + clas * Clasregs;
-            fremsk = hb->cfremsk[clas];
+            fremsk = hb->clasinf[clas].fremsk;
             ycheck(nil,loc,clas != reg->clas,"region %zx %.01llu clas %u len %u vs %u %u",(size_t)reg,reg->uid,reg->clas,reg->cellen,clas,alen)
             ycheck(nil,loc,reg->inuse != 1,"region %zx %.01llu clas %u len %u vs %u %u",(size_t)reg,reg->uid,reg->clas,reg->cellen,clas,alen)
             break;
@@ -278,7 +321,7 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
 
       if (unlikely(reg == nil)) { // get new region
         ypush(hd,loc,Fln)
-        claseq = hb->clasregcnt[clas];
+        claseq = hb->clasinf[clas].regcnt;
         ycheck(nil,loc,alen < len,"clas %u aen %u len %u.%u tag %.01u",clas,alen,len,len,tag)
         reg = newslab(hb,alen,clas,claseq);
         if (unlikely(reg == nil)) {
@@ -286,18 +329,18 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
           return xreg ? (void *)xreg->user : nil;
         }
         reg->claspos = pos;
-        hb->clasregcnt[clas] = (ub2)(claseq + 1);
-        clasmsk = hb->clasmsk[clas];
+        hb->clasinf[clas].regcnt = (ub2)(claseq + 1);
+        clasmsk = hb->clasinf[clas].msk;
         msk = (1ul << pos);
         clasregs[pos] = reg;
         clasmsk |= msk;
         fremsk &= ~msk;
-        hb->clasmsk[clas] = clasmsk;
-        hb->cfremsk[clas] = fremsk;
+        hb->clasinf[clas].msk = clasmsk;
+        hb->clasinf[clas].fremsk = fremsk;
         ydbg2(Fln,loc,"reg %.01llu clas %u pos %u msk %lx %lx",reg->uid,clas,pos,clasmsk,fremsk);
         xpct = Atomget(reg->lock,Moacq);
         ycheck(nil,loc,xpct != 0,"new reg %u lock %u",reg->id,xpct)
-        hb->smalclas[clas] = reg;
+        hb->clasinf[clas].smal = reg;
         ydbg2(Fln,loc,"reg %.01llu clas %u len %u",reg->uid,clas,len);
       }
     } else { // havereg
@@ -312,6 +355,7 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
     ydbg2(Fln,loc,"clas %u pos %u msk %lx",clas,pos,fremsk);
 
     ypush(hd,loc,Fln)
+    if (Realloc_headroom && unlikely(loc == Lreal)) reg->real = 1;
     p = slab_alloc(hd,hb,reg,(ub4)ulen,(ub4)align,loc,tag);
 
     if (likely(p != nil)) {
@@ -325,9 +369,9 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
     if (hd->status == St_error) {
       return nil;
     }
-    clasmsk = hb->clasmsk[clas];
+    clasmsk = hb->clasinf[clas].msk;
     clasmsk &= ~(1ul << pos); // disable full one
-    hb->clasmsk[clas] = clasmsk;
+    hb->clasinf[clas].msk = clasmsk;
     if (clasmsk == 0) {
         if (fremsk == 0) {
          do_ylog(Diagcode,loc,Fln,Warn,0,"clas %u pos %u msk %lx",clas,pos,fremsk);
@@ -340,32 +384,43 @@ static Hot void *alloc_heap(heapdesc *hd,heap *hb,size_t ulen,ub4 align,enum Loc
       ydbg2(Fln,loc,"clas %u pos %u msk %lx",clas,pos,clasmsk);
     }
 
-    claseq = hb->clasregcnt[clas];
+    claseq = hb->clasinf[clas].regcnt;
 
     if (pos >= Clasregs) {
       ydbg1(Fln,loc,"clas %u pos %u msk %lx",clas,pos,fremsk);
-      ydbg3(loc,"clas %u wrap pos mask %x",clas,hb->clasmsk[clas]);
+      ydbg3(loc,"clas %u wrap pos mask %x",clas,hb->clasinf[clas].msk);
       pos = 0;
     }
-    hb->claspos[clas] = (ub2)pos;
+    hb->clasinf[clas].pos = (ub2)pos;
     reg = clasregs[pos];
     if (reg) {
       openreg(reg)
       ycheck(nil,loc,clas != reg->clas,"region %.01llu clas %u len %u vs %u %u",reg->uid,reg->clas,reg->cellen,clas,alen)
       ycheck(nil,loc,reg->cellen < len,"region %.01llu clas %u len %u vs %u",reg->uid,clas,reg->cellen,len)
     }
-    hb->smalclas[clas] = reg; // may be nil
+    hb->clasinf[clas].smal = reg; // may be nil
     ydbg2(Fln,loc,"reg %.01llu clas %u len %u",reg->uid,clas,len);
 
   } while (likely(--iter));
 
   if (reg) errorctx(reg->fln,loc,"reg %u msk %lx",reg->id,fremsk)
-  error2(loc,Fln,"class %u size %u regions exceed %u mask %lx,%lx",clas,alen,claseq,hb->clasmsk[clas],fremsk)
+  error2(loc,Fln,"class %u size %u regions exceed %u mask %lx,%lx",clas,alen,claseq,hb->clasinf[clas].msk,fremsk)
   hd->status = St_oom; // should never occur due to region size growth
   hd->errfln = Fln;
   return nil;
 }
 
+// last resort outside any heap, counted in the budget
+static void *oom_mmap(size_t len)
+{
+  void *p;
+
+  if (mem_charge(len) == 0) return nil;
+  p = osmmap(len);
+  if (p == nil) mem_uncharge(len);
+  return p;
+}
+
 // nil len handled
 static void *yal_heap(heapdesc *hd,heap *hb,size_t len,ub4 align,enum Loc loc,ub4 tag)
 {
@@ -376,12 +431,13 @@ static void *yal_heap(heapdesc *hd,heap *hb,size_t len,ub4 align,enum Loc loc,ub
   if (likely(p != nil)) return p;
 
   st = hd->status; hd->status = St_ok;
+  if (st == St_ok && mem_overlimit) return p; // over budget, reported by oom()
   error(loc,"status %d",st)
   if (st == St_error) return p;
 
   if (st == St_oom) {
     oom(hb,Fln,loc,len,0);
-    return osmmap(len); // fallback
+    return oom_mmap(len); // fallback
   }
 
   return p;
@@ -389,7 +445,7 @@ static void *yal_heap(heapdesc *hd,heap *hb,size_t len,ub4 align,enum Loc loc,ub
 
 // main entry for malloc, calloc, realloc, alloc_align.
 // If no heap yet and small request, use mini bumpallocator
-static Hot void *yal_heapdesc(heapdesc *hd,size_t len,ub4 align,enum Loc loc,ub4 tag)
+static Hot void *yal_heapdesc_(heapdesc *hd,size_t len,ub4 align,enum Loc loc,ub4 tag)
 {
   heap *hb = hd->hb;
   void *p;
@@ -424,6 +480,7 @@ static Hot void *yal_heapdesc(heapdesc *hd,size_t len,ub4 align,enum Loc loc,ub4
       from = 0; didcas = Cas(hb->lock,from,1);
     } else {
       didcas = 1;
+      priv_enter(hb)
     }
     ydbg2(Fln,loc,"try heap %u cas %u",hb->id,didcas)
   } // hb or not
@@ -439,13 +496,13 @@ static Hot void *yal_heapdesc(heapdesc *hd,size_t len,ub4 align,enum Loc loc,ub4
     cheaps = hd->nogetheaps; // local contention
     hd->nogetheaps = cheaps + 1;
 
-    if (heaps > 100 && cheaps * 1 > heaps) { // private heap if too much contention
+    if (Yal_percpu == 0 && heaps > 100 && cheaps * 1 > heaps) { // private heap if too much contention
       hd->getheaps = hd->nogetheaps = 0;
       hb = newheap(hd,loc,Fln);
     } else {
       hb = heap_new(hd,loc,Fln);
     }
-    if (hb == nil) return osmmap(len); // fallback
+    if (hb == nil) return oom_mmap(len); // fallback
     ydbg3(loc,"heap %u",hb->id);
 
     if (unlikely(hd->minidir == 0 && hd->mhb != nil)) {
@@ -454,6 +511,7 @@ static Hot void *yal_heapdesc(heapdesc *hd,size_t len,ub4 align,enum Loc loc,ub4
       setregion(hb,(xregion *)breg,breg->user,breg->len,1,loc,Fln); // add mini to dir
     }
     hd->hb = hb;
+    reserve_env(hb);
   } else {
     vg_drd_wlock_acq(hb)
     // Atomset(hb->locfln,Fln,Morel);
@@ -472,12 +530,20 @@ static Hot void *yal_heapdesc(heapdesc *hd,size_t len,ub4 align,enum Loc loc,ub4
   if (tidstate != Ts_private) {
     Atomset(hb->lock,0,Morel);
     vg_drd_wlock_rel(hb)
-  }
+  } else priv_leave(hb)
 
   ycheck(nil,loc,p == nil,"p nil for len %zu",len)
   return p;
 }
 
+static Hot inline void *yal_heapdesc(heapdesc *hd,size_t len,ub4 align,enum Loc loc,ub4 tag)
+{
+  Latstart
+  void *p = yal_heapdesc_(hd,len,align,loc,tag);
+  Latend(hd->stat,Yal_lat_alloc)
+  return p;
+}
+
 // calloc
 static void *yalloc(size_t len,enum Loc loc,ub4 tag)
 {
@@ -485,8 +551,11 @@ static void *yalloc(size_t len,enum Loc loc,ub4 tag)
   void *p;
 
   ypush(hd,Lalloc | Lapi,Fln);
+  ystats(hd->stat.apiallocs)
 
   p = yal_heapdesc(hd,len,1,loc,tag);
+  hist_alloc(hd,p,len,tag);
+  prof_alloc(hd,p,len);
 
 #if Yal_enable_check > 1
   if (unlikely(chkalign(p,len,Stdalign) != 0)) error(Lalloc,"alloc(%zu) = %zx not aligns",len,(size_t)p)
@@ -497,8 +566,8 @@ static void *yalloc(size_t len,enum Loc loc,ub4 tag)
   return p;
 }
 
-// malloc
-static void *ymalloc(size_t len,ub4 tag)
+// malloc. For aligned_alloc, len is a multiple of align and its class has cels aligned by construction
+static void *ymalloc_(size_t len,ub4 align,ub4 tag)
 {
   heapdesc *hd = getheapdesc(Lalloc);
   heap *hb = hd->hb;
@@ -509,8 +578,23 @@ static void *ymalloc(size_t len,ub4 tag)
   ub4 from;
   bool didcas;
   enum Tidstate tidstate;
+#if Yal_enable_magazine
+  struct magazine *mg = hd->mag;
+#endif
 
   ypush(hd,Lalloc | Lapi,Fln);
+  if (align == 1) { ystats(hd->stat.apiallocs) } // aligned_alloc counted by caller
+
+#if Yal_enable_magazine
+  if (likely(mg != nil && len && len < Magazine_len && mg->hb == hb)) { // no lock needed. malloc(0) below
+    p = mag_alloc(hd,mg,(ub4)len,tag);
+    if (likely(p != nil)) {
+      hist_alloc(hd,p,len,tag);
+      prof_alloc(hd,p,len);
+      return p;
+    }
+  }
+#endif
 
   if (likely(hb != nil)) { // simplified case
     tidstate = hd->tidstate;
@@ -522,6 +606,7 @@ static void *ymalloc(size_t len,ub4 tag)
 #endif
     } else {
       didcas = 1;
+      priv_enter(hb)
     }
 
     if (likely(didcas != 0)) {
@@ -531,18 +616,23 @@ static void *ymalloc(size_t len,ub4 tag)
         len4 = (ub4)len;
         clas = len2clas[len4];
         ydbg2(Fln,Lnone,"clas %2u for len %5u tag %.01u",clas,len4,tag);
-        reg = hb->smalclas[clas];
+        reg = hb->clasinf[clas].smal;
         if (likely(reg != nil)) {
-          clascnt = hb->clascnts[clas] & Hi31;
+          clascnt = hb->clasinf[clas].cnt & Hi31;
           ycheck(nil,Lalloc,clascnt == 0,"clas %u count 0",clas)
-          hb->clascnts[clas] = clascnt + 1;
+          hb->clasinf[clas].cnt = clascnt + 1;
           vg_mem_def(reg,sizeof(region))
           vg_mem_def(reg->meta,reg->metalen)
           ycheck(nil,Lalloc,reg->clas != clas,"region %.01llu clas %u len %u vs %u %u",reg->uid,clas,len4,reg->clas,reg->cellen)
           ycheck1(nil,Lalloc,reg->cellen < len,"region %.01llu clas %u len %u vs %u",reg->uid,clas,reg->cellen,len4)
           reg->age = 0; // todo replace with re-check at trim
 
+#if Yal_enable_magazine
+          if (len4 < Magazine_len) p = mag_fill(hd,hb,reg,clas,len4,tag);
+          else p = slab_malloc(reg,len4,tag);
+#else
           p = slab_malloc(reg,len4,tag);
+#endif
 
           if (likely(p != nil)) {
 #if Yal_enable_check > 1
@@ -552,13 +642,15 @@ static void *ymalloc(size_t len,ub4 tag)
             if (tidstate != Ts_private) {
               Atomset(hb->lock,0,Morel);
               vg_drd_wlock_rel(hb)
-            }
+            } else priv_leave(hb)
             vg_mem_noaccess(reg->meta,reg->metalen)
             vg_mem_noaccess(reg,sizeof(region))
             ypush(hd,Lalloc | Lapi,Fln);
+            hist_alloc(hd,p,len,tag);
+            prof_alloc(hd,p,len);
             return p;
           }
-          hb->smalclas[clas] = nil; // e.g. full
+          hb->clasinf[clas].smal = nil; // e.g. full
         } // havereg
 
         if (unlikely(len == 0)) {
@@ -568,29 +660,111 @@ static void *ymalloc(size_t len,ub4 tag)
           if (tidstate != Ts_private) {
             Atomset(hb->lock,0,Morel);
             vg_drd_wlock_rel(hb)
-          }
+          } else priv_leave(hb)
           return p;
         }
 
       } // small
 
-      p = alloc_heap(hd,hb,len,1,Lalloc,tag);
+      p = alloc_heap(hd,hb,len,align,align > 1 ? Lallocal : Lalloc,tag);
 
       if (tidstate != Ts_private) {
         Atomset(hb->lock,0,Morel);
         vg_drd_wlock_rel(hb)
-      }
+      } else priv_leave(hb)
       ypush(hd,Lalloc | Lapi,Fln);
+      hist_alloc(hd,p,len,tag);
+      prof_alloc(hd,p,len);
       return p;
     } // locked
     ydbg2(Fln,Lalloc,"len %zu",len)
   } // heap
   ydbg3(Fln,Lalloc,"len %zu",len)
-  p = yal_heapdesc(hd,len,1,Lalloc,tag);
+  p = yal_heapdesc(hd,len,align,align > 1 ? Lallocal : Lalloc,tag);
   ypush(hd,Lalloc | Lapi,Fln);
+  hist_alloc(hd,p,len,tag);
+  prof_alloc(hd,p,len);
   return p;
 }
 
+static void *ymalloc(size_t len,ub4 tag)
+{
+  return ymalloc_(len,1,tag);
+}
+
+/* malloc cnt blocks of len. Lock heap and lookup class once, fill from the current region of the class.
+   returns count allocated */
+static size_t ymalloc_batch(size_t len,void **ptrs,size_t cnt,ub4 tag)
+{
+  heapdesc *hd = getheapdesc(Lalloc);
+  heap *hb = hd->hb;
+  region *reg;
+  void *p;
+  size_t i,n = 0;
+  ub4 clas,clascnt;
+  ub4 len4,got;
+  ub4 from;
+  bool didcas;
+  enum Tidstate tidstate = hd->tidstate;
+
+  ypush(hd,Lalloc | Lapi,Fln);
+
+  if (unlikely(len == 0 || len >= Smalclas || hb == nil)) didcas = 0;
+  else if (tidstate == Ts_mt) {
+    from = 0; didcas = Cas(hb->lock,from,1);
+  } else {
+    didcas = 1;
+    priv_enter(hb)
+  }
+
+  if (unlikely(didcas == 0)) { // as single
+    while (n < cnt) {
+      p = ymalloc(len,tag);
+      if (p == nil) break;
+      ptrs[n++] = p;
+    }
+    return n;
+  }
+  vg_drd_wlock_acq(hb)
+
+  len4 = (ub4)len;
+  clas = len2clas[len4];
+  ytrace(0,hd,Lalloc,tag,0,"+malloc_batch(%u,%zu)",len4,cnt)
+
+  while (n < cnt) {
+    reg = hb->clasinf[clas].smal;
+    if (likely(reg != nil)) {
+      vg_mem_def(reg,sizeof(region))
+      vg_mem_def(reg->meta,reg->metalen)
+      ycheck(n,Lalloc,reg->clas != clas,"region %.01llu clas %u len %u vs %u %u",reg->uid,clas,len4,reg->clas,reg->cellen)
+      got = slab_mallocs(reg,len4,ptrs + n,(ub4)min(cnt - n,Hi31),tag);
+      vg_mem_noaccess(reg->meta,reg->metalen)
+      vg_mem_noaccess(reg,sizeof(region))
+      clascnt = hb->clasinf[clas].cnt & Hi31;
+      hb->clasinf[clas].cnt = clascnt + got;
+      n += got;
+      if (n == cnt) break;
+      hb->clasinf[clas].smal = nil; // e.g. full
+    }
+    p = alloc_heap(hd,hb,len,1,Lalloc,tag); // select or create next region
+    if (unlikely(p == nil)) break;
+    ptrs[n++] = p;
+  }
+  ystats2(hd->stat.apiallocs,n)
+
+  if (tidstate != Ts_private) {
+    Atomset(hb->lock,0,Morel);
+    vg_drd_wlock_rel(hb)
+  } else priv_leave(hb)
+
+  for (i = 0; i < n; i++) {
+    hist_alloc(hd,ptrs[i],len,tag);
+    prof_alloc(hd,ptrs[i],len);
+  }
+  ypush(hd,Lalloc | Lapi,Fln);
+  return n;
+}
+
 // in contrast with c11, any size and pwr2 alignment is accepted
 static void *yalloc_align(size_t align, size_t len,ub4 tag)
 {
@@ -606,6 +780,7 @@ static void *yalloc_align(size_t align, size_t len,ub4 tag)
   enum Tidstate tidstate = hd->tidstate;
 
   ypush(hd,Lallocal | Lapi,Fln)
+  ystats(hd->stat.apiallocs)
 
   ytrace(0,hd,Lallocal,tag,0,"+ mallocal(%zu`,%zu)",len,align)
 
@@ -632,12 +807,20 @@ static void *yalloc_align(size_t align, size_t len,ub4 tag)
   if (likely(len < mmap_limit && align <= Pagesize)) { // no provisions needed, slab handles
 
     ytrace(0,hd,Lallocal,tag,0,"+ mallocal(%zu`,%zu)",len,align)
-    len4 = (ub4)len;
-    if (len4 & (len4 - 1)) {
-      ord = 32 - clz(len4) + 1;
-      len = 1ul << ord;
+    alen = doalign8(len,align);
+
+    // a class above the table has a len multiple of align, and each cel is aligned. Likewise for tabled ones that happen to be
+    if (alen >= Smalclas || (clas2len[len2clas[alen]] & (align - 1)) == 0) {
+      ystats(hd->stat.alclasallocs)
+      p = ymalloc_(alen,(ub4)align,tag);
+    } else {
+      len4 = (ub4)len;
+      if (len4 & (len4 - 1)) {
+        ord = 32 - clz(len4) + 1;
+        len = 1ul << ord;
+      }
+      p = yal_heapdesc(hd,len,(ub4)align,Lallocal,tag);
     }
-    p = yal_heapdesc(hd,len,(ub4)align,Lallocal,tag);
 
     if (p) {
 #if Yal_enable_check
@@ -663,6 +846,7 @@ static void *yalloc_align(size_t align, size_t len,ub4 tag)
       }
     } else {
       didcas = 1;
+      priv_enter(hb)
     }
   }
   if (hb == nil) {
@@ -677,7 +861,13 @@ static void *yalloc_align(size_t align, size_t len,ub4 tag)
   ystats(hb->stat.mapAllocs)
   ystats(hb->stat.mapaligns[abit])
 
-  if (reg == nil) return nil;
+  if (reg == nil) {
+    if (tidstate != Ts_private) {
+      Atomset(hb->lock,0,Morel);
+      vg_drd_wlock_rel(hb)
+    } else priv_leave(hb)
+    return nil;
+  }
   ip = reg->user;
   aip = doalign8(ip,align);
 
@@ -692,7 +882,7 @@ static void *yalloc_align(size_t align, size_t len,ub4 tag)
   if (tidstate != Ts_private) {
     Atomset(hb->lock,0,Morel);
     vg_drd_wlock_rel(hb)
-  }
+  } else priv_leave(hb)
 
   ytrace(0,hd,Lallocal,tag,0,"-mallocal(%zu`,%zu) = %zx",len,align,aip)
   ypush(hd,Lallocal | Lapi,Fln)
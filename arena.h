@@ -0,0 +1,202 @@
+/* arena.h - region-scoped allocation
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   An arena is a list of chunks from osmem(), each starting with its region descriptor. Blocks are bump allocated without metadata.
+   yal_arena_destroy() unmaps all chunks at once. Chunks are in the global directory only, as arenas are not owned by a heap,
+   so free() of an arena block is found and ignored or reported, as set by Yal_arena_free. After destroy, the usual invalid free diagnostics apply.
+   An arena is used by one thread at a time. free() from any thread is fine.
+*/
+
+#define Logfile Farena
+
+struct Align(16) st_aregion { // arena chunk. head of chunk and of arena
+
+  // + common
+  size_t user; // user aka client block
+  size_t len; // gross client block len as allocated
+
+  struct st_heap *hb; // nil
+
+  _Atomic ub4 lock;
+  enum Rtype typ;
+
+  ub4 hid;
+  ub4 id;
+
+  // - common
+
+  struct st_aregion *nxt; // chunk list from head
+  struct st_aregion *cur; // head: current chunk
+
+  size_t pos; // bump offset from user
+  size_t chunklen; // head: len of next chunk
+
+  size_t allocs,bytes; // head
+  ub4 chunks; // head
+  ub4 tag;
+};
+typedef struct st_aregion aregion;
+
+#define Arena_hdr doalign8(sizeof(aregion),Stdalign)
+
+static _Atomic ub4 global_arenaid;
+
+static aregion *arena_chunk(ub4 hid,ub4 id,size_t len,enum Loc loc)
+{
+  aregion *reg;
+
+  len = doalign8(len,Pagesize);
+  reg = osmem(Fln,hid,len,"arena");
+  if (reg == nil) return nil;
+
+  reg->user = (size_t)reg;
+  reg->len = len;
+  reg->typ = Rarena;
+  reg->hid = hid;
+  reg->id = id;
+  reg->pos = Arena_hdr;
+
+  setgregion(nil,(xregion *)reg,reg->user,len,1,loc,Fln);
+  return reg;
+}
+
+yal_arena *yal_arena_create(size_t len,unsigned int tag)
+{
+  heapdesc *hd = getheapdesc(Lalloc);
+  aregion *reg;
+  ub4 id = Atomad(global_arenaid,1,Monone) + 1;
+
+  if (len == 0) len = Arena_chunk;
+  if (len >= Vmsize) {
+    error(Lalloc,"arena len %zu` too large tag %.01u",len,tag)
+    return nil;
+  }
+
+  reg = arena_chunk(hd->id,id,len + Arena_hdr,Lalloc);
+  if (reg == nil) return nil;
+
+  reg->cur = reg;
+  reg->chunklen = min(reg->len * 2,Arena_maxchunk);
+  reg->chunks = 1;
+  reg->tag = tag;
+
+  ystats(hd->stat.arenas)
+  ytrace(0,hd,Lalloc,tag,0,"arena %u len %zu` at %zx",id,reg->len,(size_t)reg)
+  return (yal_arena *)reg;
+}
+
+// add chunk for len at align, after the current or as current
+static Cold void *arena_grow(aregion *ap,size_t len,size_t align,ub4 tag)
+{
+  aregion *reg,*cur = ap->cur;
+  size_t need = Arena_hdr + len + (align > Stdalign ? align : 0); // len and align below Vmsize
+  size_t clen = ap->chunklen;
+  size_t ip;
+
+  if (need >= Vmsize) {
+    error(Lalloc,"arena %u alloc %zu` too large tag %.01u",ap->id,len,tag)
+    return nil;
+  }
+
+  reg = arena_chunk(ap->hid,ap->id,max(need,clen),Lalloc);
+  if (reg == nil) return nil;
+
+  reg->nxt = cur->nxt;
+  cur->nxt = reg;
+  ap->chunks++;
+  if (need <= clen) { // regular: continue here
+    ap->cur = reg;
+    ap->chunklen = min(clen * 2,Arena_maxchunk);
+  }
+
+  ip = doalign8(reg->user + reg->pos,align);
+  reg->pos = ip + len - reg->user;
+  return (void *)ip;
+}
+
+Hot void *yal_arena_alloc(yal_arena *arena,size_t len,size_t align,unsigned int tag)
+{
+  aregion *ap = (aregion *)arena;
+  aregion *reg;
+  size_t ip,end;
+
+  if (unlikely(ap == nil || ap->typ != Rarena || ap->cur == nil)) {
+    error(Lalloc,"invalid arena %zx tag %.01u",(size_t)ap,tag)
+    return nil;
+  }
+  if (align < Stdalign) align = Stdalign;
+  else if (unlikely(align & (align - 1))) {
+    error(Lalloc,"arena %u align %zu not a power of two",ap->id,align)
+    return nil;
+  }
+  if (unlikely(len == 0)) len = 1;
+  if (unlikely(len >= Vmsize || align >= Vmsize)) { // before any addition can wrap
+    error(Lalloc,"arena %u alloc %zu` align %zu` too large tag %.01u",ap->id,len,align,tag)
+    return nil;
+  }
+
+  ap->allocs++;
+  ap->bytes += len;
+
+  reg = ap->cur;
+  ip = doalign8(reg->user + reg->pos,align);
+  end = ip + len;
+  if (likely(end <= reg->user + reg->len && end > ip)) {
+    reg->pos = end - reg->user;
+    return (void *)ip;
+  }
+  return arena_grow(ap,len,align,tag);
+}
+
+void yal_arena_destroy(yal_arena *arena,unsigned int tag)
+{
+  heapdesc *hd = getheapdesc(Lfree);
+  aregion *ap = (aregion *)arena;
+  aregion *reg,*nxt;
+  ub4 iter;
+
+  if (ap == nil) return;
+  if (unlikely(findgregion(Lfree,(size_t)ap) != (xregion *)ap)) { // also catches destroy twice
+    hd->stat.invalid_frees++;
+    error(Lfree,"invalid arena %zx tag %.01u",(size_t)ap,tag)
+    return;
+  }
+
+  ytrace(0,hd,Lfree,tag,0,"arena %u destroy %u chunks %zu` allocs",ap->id,ap->chunks,ap->allocs)
+  ystats2(hd->stat.arenachunks,ap->chunks)
+  ystats2(hd->stat.arenaallocs,ap->allocs)
+  ystats2(hd->stat.arenabytes,ap->bytes)
+
+  reg = ap->nxt;
+  iter = ap->chunks;
+  while (reg && iter--) { // head last, as it holds the list
+    nxt = reg->nxt;
+    setgregion(nil,(xregion *)reg,reg->user,reg->len,0,Lfree,Fln);
+    osunmem(Fln,hd,reg,reg->len,"arena");
+    reg = nxt;
+  }
+  ap->cur = nil;
+  setgregion(nil,(xregion *)ap,ap->user,ap->len,0,Lfree,Fln);
+  osunmem(Fln,hd,ap,ap->len,"arena");
+}
+
+// free() of an arena block: ignored, as released at destroy. size() and realloc() have no len
+static size_t arena_free(heapdesc *hd,aregion *reg,size_t ip,enum Loc loc,ub4 tag)
+{
+  ycheck(Nolen,loc,ip < reg->user + Arena_hdr || ip >= reg->user + reg->pos,"arena %u ptr %zx outside %zx .. %zx",reg->id,ip,reg->user + Arena_hdr,reg->user + reg->pos)
+
+  ystats(hd->stat.arenafrees)
+  if (Yal_arena_free == 0 && loc != Lsize) {
+    ytrace(1,hd,loc,tag,0,"arena %u ptr %zx ignored",reg->id,ip)
+    return 0;
+  }
+  hd->stat.invalid_frees++;
+  error(loc,"ptr %zx is in arena %u.%u tag %.01u",ip,reg->hid,reg->id,tag)
+  return Nolen;
+}
+
+#undef Logfile
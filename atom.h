@@ -24,6 +24,8 @@
 #define Atomset(a,b,o) atomic_store_explicit(&(a),(b),o)
 #define Atomseta(a,b,o) atomic_store_explicit((a),(b),o)
 
+#define Atomxchg(a,b,o) atomic_exchange_explicit(&(a),(b),o)
+
 #define Atomfence(o) atomic_thread_fence(o)
 
 #define Monone memory_order_relaxed
@@ -49,6 +51,8 @@
   #define Atomset(a,b,o) __atomic_store_n(&(a),(b),o)
   #define Atomseta(a,b,o) __atomic_store_n((a),(b),o)
 
+  #define Atomxchg(a,b,o) __atomic_exchange_n(&(a),(b),o)
+
   #define Atomfence(o) __atomic_thread_fence(o)
 
   #define Monone __ATOMIC_RELAXED
@@ -77,6 +81,9 @@
  #define Atomset(a,b,o) (a) = (b)
  #define Atomseta(a,b,o) *(a) = (b)
 
+ static inline ub4 atomxchg4(ub4 *a,ub4 b) { ub4 o = *a; *a = b; return o; }
+ #define Atomxchg(a,b,o) atomxchg4(&(a),(b))
+
  #define Atomfence(o) __atomic_thread_fence(o)
 
  #define Monone
@@ -0,0 +1,485 @@
+/* bench.c - yalloc benchmarks
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   Semi-portable, unix-like systems only with pthreads
+   Timed multithreaded workloads. Each reports calls/sec, latency percentiles per call, peak RSS and a stats summary
+   Latency is measured per call with clock_gettime() and includes its overhead. Runs are repeatable for a given seed and thread count
+*/
+
+#define _POSIX_C_SOURCE 200809L // pthread_barrier
+
+#include <unistd.h>
+
+#include <pthread.h>
+#include <sched.h> // sched_yield
+#include <time.h>
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "stdlib.h"
+#include "malloc.h"
+
+#include "base.h"
+
+#include "printf.h"
+#include "os.h"
+
+#include "atom.h"
+
+#include "util.h"
+
+#define L __LINE__
+
+static const char usagemsg[] = "\nusage: bench [opts] workload threads [iters] [seed]\n\n\
+-s   print stats at end\n\
+\n\
+l - larson : threads replace random blocks in arrays passed on to the next thread each round\n\
+p - producer/consumer : thread pairs, one allocates and the other frees\n\
+f - fixed-size pool : allocate and free batches of one size\n\
+r - random sizes up to Bench_maxlen, skewed to small\n\
+g - realloc growth by 1.5 up to 1MB\n\
+c - calloc of large zeroed blocks\n\
+A - aligned_alloc churn at 32, 64, 128 and 4096 alignment\n\
+a - all of above\n\
+\n";
+
+#define Tids 64
+#define Bench_maxlen (1ul << 22) // as Mmap_max_threshold in config.h
+
+#define Larson_slots 1024
+#define Pc_ring 4096 // pwr2
+#define Pool_batch 256
+#define Rand_live 256
+#define Align_live 256
+
+static const int Log_fd = 1;
+
+static unsigned long mypid;
+static bool dostat;
+
+// -- rng, as in test.c --
+
+static void inixor(ub8 *state)
+{
+  state[16] = 0; // p
+}
+
+static ub8 xorshift64star(ub8 x)
+{
+  x ^= x >> 12; // a
+  x ^= x << 25; // b
+  x ^= x >> 27; // c
+  return (x * 2685821657736338717ULL);
+}
+
+static ub8 xorshift1024star(ub8 *state)
+{
+  ub4 p = (ub4)state[16];
+
+  ub8 s0 = state[p];
+  ub8 s1 = state[p = ( p + 1 ) & 15];
+  s1 ^= s1 << 31; // a
+  s1 ^= s1 >> 11; // b
+  s0 ^= s0 >> 30; // c
+  state[p] = s0 ^ s1;
+
+  return (ub4)(state[p] * 1181783497276652981ULL);
+}
+
+static size_t rnd(size_t range,ub8 *state)
+{
+  size_t r = (size_t)xorshift1024star(state);
+  return r % range;
+}
+
+static Printf(2,3) int info(int line,cchar *fmt,...)
+{
+  va_list ap;
+  char buf[1024];
+  ub4 pos,len = 1022;
+
+  pos = snprintf_mini(buf,0,len,"   yal/bench.c:%4d %-5lu ",line,mypid);
+  va_start(ap,fmt);
+  pos += mini_vsnprintf(buf,pos,len,fmt,ap);
+  va_end(ap);
+  buf[pos++] = '\n';
+  oswrite(Log_fd,buf,pos,__LINE__);
+  return line;
+}
+
+// -- latency histogram: 8 steps per pwr2 of ns --
+
+#define Lat_bins (64 * 8)
+
+struct binfo {
+  ub4 tid;
+  ub4 tidcnt;
+  size_t iters;
+  ub8 seed;
+  size_t ops;
+  size_t errs;
+  size_t lats[Lat_bins];
+};
+
+static ub8 nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (ub8)ts.tv_sec * 1000000000ul + (ub8)ts.tv_nsec;
+}
+
+static ub4 latbin(ub8 ns)
+{
+  ub4 msb;
+
+  if (ns < 8) return (ub4)ns;
+  msb = 63 - (ub4)__builtin_clzll(ns);
+  return msb * 8 + (ub4)((ns >> (msb - 3)) & 7);
+}
+
+static size_t binlat(ub4 bin) // upper bound
+{
+  ub4 msb = bin / 8;
+
+  if (bin < 8) return bin;
+  return ((8ul | (bin & 7)) + 1) << (msb - 3);
+}
+
+static void seed(struct binfo *ip,ub8 *state)
+{
+  ub4 i;
+  ub8 x = ip->seed * 0x9e3779b97f4a7c15ul + ip->tid + 1;
+
+  inixor(state);
+  for (i = 0; i < 16; i++) state[i] = x = xorshift64star(x);
+}
+
+#define Lat(ip,t0) do { ub8 t1 = nsecs(); (ip)->lats[latbin(t1 - (t0))]++; (ip)->ops++; t0 = t1; } while (0)
+
+static void *bmalloc(struct binfo *ip,size_t len)
+{
+  ub8 t0 = nsecs();
+  void *p = malloc(len);
+
+  Lat(ip,t0);
+  if (p == nil) ip->errs++;
+  return p;
+}
+
+static void bfree(struct binfo *ip,void *p)
+{
+  ub8 t0 = nsecs();
+
+  free(p);
+  Lat(ip,t0);
+}
+
+static pthread_barrier_t barrier;
+
+// -- workloads --
+
+static void * _Atomic larson_slots[Tids][Larson_slots];
+
+static void *larson(void *arg)
+{
+  struct binfo *ip = arg;
+  ub8 state[17];
+  size_t it,i,round,rounds = 16;
+  void * _Atomic *slots;
+  void *p;
+
+  seed(ip,state);
+
+  for (round = 0; round < rounds; round++) {
+    slots = larson_slots[(ip->tid + round) % ip->tidcnt]; // blocks of the previous owner
+    for (it = 0; it < ip->iters / rounds; it++) {
+      i = rnd(Larson_slots,state);
+      p = Atomgeta(slots + i,Monone);
+      if (p) bfree(ip,p);
+      p = bmalloc(ip,rnd(500,state) + 10);
+      Atomseta(slots + i,p,Monone);
+    }
+    pthread_barrier_wait(&barrier);
+  }
+  pthread_barrier_wait(&barrier);
+  for (i = 0; i < Larson_slots; i++) { // own array
+    slots = larson_slots[ip->tid];
+    p = Atomgeta(slots + i,Monone);
+    if (p) bfree(ip,p);
+    Atomseta(slots + i,nil,Monone);
+  }
+  return nil;
+}
+
+struct pcring {
+  _Atomic size_t head,tail;
+  void * _Atomic ps[Pc_ring];
+};
+
+static struct pcring pcrings[Tids / 2];
+
+static void *prodcons(void *arg)
+{
+  struct binfo *ip = arg;
+  struct pcring *rp = pcrings + ip->tid / 2;
+  ub8 state[17];
+  size_t it,head,tail;
+  void *p;
+  bool prod = (ip->tid & 1) == 0;
+
+  seed(ip,state);
+
+  if (ip->tid + 1 == ip->tidcnt && prod) { // unpaired: both sides
+    for (it = 0; it < ip->iters; it++) {
+      p = bmalloc(ip,rnd(256,state) + 8);
+      bfree(ip,p);
+    }
+    return nil;
+  }
+
+  for (it = 0; it < ip->iters; it++) {
+    if (prod) {
+      p = bmalloc(ip,rnd(256,state) + 8);
+      head = Atomget(rp->head,Monone);
+      while (head - Atomget(rp->tail,Moacq) >= Pc_ring) sched_yield();
+      Atomseta(rp->ps + (head & (Pc_ring - 1)),p,Monone);
+      Atomset(rp->head,head + 1,Morel);
+    } else {
+      tail = Atomget(rp->tail,Monone);
+      while (Atomget(rp->head,Moacq) == tail) sched_yield();
+      p = Atomgeta(rp->ps + (tail & (Pc_ring - 1)),Monone);
+      Atomset(rp->tail,tail + 1,Morel);
+      bfree(ip,p);
+    }
+  }
+  return nil;
+}
+
+static void *pool(void *arg)
+{
+  struct binfo *ip = arg;
+  void *ps[Pool_batch];
+  size_t it,i;
+
+  for (it = 0; it < ip->iters / Pool_batch; it++) {
+    for (i = 0; i < Pool_batch; i++) ps[i] = bmalloc(ip,64);
+    for (i = 0; i < Pool_batch; i++) bfree(ip,ps[i]);
+  }
+  return nil;
+}
+
+static void *randsiz(void *arg)
+{
+  struct binfo *ip = arg;
+  ub8 state[17];
+  void *ps[Rand_live];
+  size_t it,i,ord,maxord = 63 - (size_t)__builtin_clzll(Bench_maxlen);
+
+  seed(ip,state);
+  memset(ps,0,sizeof(ps));
+
+  for (it = 0; it < ip->iters / 2; it++) {
+    i = rnd(Rand_live,state);
+    if (ps[i]) bfree(ip,ps[i]);
+    ord = rnd(maxord,state) + 1;
+    ord = rnd(ord,state) + 1; // skew to small
+    ps[i] = bmalloc(ip,rnd(1ul << ord,state) + 1);
+  }
+  for (i = 0; i < Rand_live; i++) if (ps[i]) bfree(ip,ps[i]);
+  return nil;
+}
+
+static void *grow(void *arg)
+{
+  struct binfo *ip = arg;
+  size_t it = 0,len;
+  ub8 t0;
+  char *p,*q;
+
+  while (it < ip->iters) {
+    len = 16;
+    p = bmalloc(ip,len);
+    it++;
+    while (len < (1ul << 20) && it < ip->iters) {
+      len += len / 2;
+      t0 = nsecs();
+      q = realloc(p,len);
+      Lat(ip,t0);
+      it++;
+      if (q == nil) { ip->errs++; break; }
+      p = q;
+      p[len - 1] = 1;
+    }
+    bfree(ip,p);
+    it++;
+  }
+  return nil;
+}
+
+static void *zeroed(void *arg)
+{
+  struct binfo *ip = arg;
+  ub8 state[17];
+  size_t it,len;
+  ub8 t0;
+  char *p;
+
+  seed(ip,state);
+
+  for (it = 0; it < ip->iters / 64; it++) { // page faults dominate
+    len = (rnd(64,state) + 1) << 16; // 64KB .. 4MB
+    t0 = nsecs();
+    p = calloc(1,len);
+    Lat(ip,t0);
+    if (p == nil) { ip->errs++; continue; }
+    if (p[0] | p[len / 2] | p[len - 1]) ip->errs++;
+    p[len / 2] = 1;
+    bfree(ip,p);
+  }
+  return nil;
+}
+
+static void *alignchurn(void *arg)
+{
+  struct binfo *ip = arg;
+  ub8 state[17];
+  void *ps[Align_live];
+  static const size_t aligns[4] = { 32,64,128,4096 };
+  size_t it,i,align,len;
+  ub8 t0;
+
+  seed(ip,state);
+  memset(ps,0,sizeof(ps));
+
+  for (it = 0; it < ip->iters / 2; it++) {
+    i = rnd(Align_live,state);
+    if (ps[i]) bfree(ip,ps[i]);
+    align = aligns[rnd(4,state)];
+    len = align == 4096 ? (rnd(4,state) + 1) << 12 : (rnd(64,state) + 1) * align; // multiple of align
+    t0 = nsecs();
+    ps[i] = aligned_alloc(align,len);
+    Lat(ip,t0);
+    if (ps[i] == nil || ((size_t)ps[i] & (align - 1))) ip->errs++;
+  }
+  for (i = 0; i < Align_live; i++) if (ps[i]) bfree(ip,ps[i]);
+  return nil;
+}
+
+// -- driver --
+
+static struct binfo infos[Tids];
+
+static int run(cchar *name,void *(*fn)(void *),ub4 tidcnt,size_t iters,ub8 seedval)
+{
+  pthread_t tids[Tids];
+  struct osrusage usg;
+  struct yal_stats st;
+  size_t lats[Lat_bins];
+  ub8 t0,t1;
+  size_t ops = 0,errs = 0,cum,p50 = 0,p99 = 0,p999 = 0,rate;
+  ub4 t,b;
+  int rv;
+
+  memset(infos,0,sizeof(infos));
+  memset(lats,0,sizeof(lats));
+  pthread_barrier_init(&barrier,nil,tidcnt);
+
+  for (t = 0; t < tidcnt; t++) {
+    infos[t].tid = t;
+    infos[t].tidcnt = tidcnt;
+    infos[t].iters = iters;
+    infos[t].seed = seedval;
+  }
+
+  t0 = nsecs();
+  for (t = 0; t < tidcnt; t++) {
+    rv = pthread_create(tids + t,nil,fn,infos + t);
+    if (rv) return info(L,"cannot create thread %u",t);
+  }
+  for (t = 0; t < tidcnt; t++) pthread_join(tids[t],nil);
+  t1 = nsecs();
+  pthread_barrier_destroy(&barrier);
+
+  for (t = 0; t < tidcnt; t++) {
+    ops += infos[t].ops;
+    errs += infos[t].errs;
+    for (b = 0; b < Lat_bins; b++) lats[b] += infos[t].lats[b];
+  }
+  cum = 0;
+  for (b = 0; b < Lat_bins && ops; b++) {
+    cum += lats[b];
+    if (p50 == 0 && cum * 2 >= ops) p50 = binlat(b);
+    if (p99 == 0 && cum * 100 >= ops * 99) p99 = binlat(b);
+    if (p999 == 0 && cum * 1000 >= ops * 999) { p999 = binlat(b); break; }
+  }
+
+  osrusage(&usg);
+  yal_mstats(&st,Yal_stats_totals,L,name);
+
+  rate = t1 > t0 ? (size_t)((double)ops * 1e9 / (double)(t1 - t0)) : 0;
+  info(L,"%-8s threads %2u calls %9zu  %9zu /sec  p50 %6zu p99 %6zu p999 %7zu ns  rss %lu KB",name,tidcnt,ops,rate,p50,p99,p999,usg.maxrss);
+  info(L,"%-8s process totals: allocs %zu frees %zu reallocs %zu mmaps %zu munmaps %zu regions %zu",name,
+    st.allocs + st.callocs,st.frees,st.reallocles + st.reallocgts,st.mmaps,st.munmaps,st.region_cnt);
+  if (dostat) yal_mstats(nil,Yal_stats_totals | Yal_stats_print,L,name);
+
+  if (errs) return info(L,"%s: %zu errors",name,errs);
+  return 0;
+}
+
+struct workload {
+  char cmd;
+  cchar *name;
+  void *(*fn)(void *);
+};
+
+static const struct workload workloads[] = {
+  { 'l',"larson",larson },
+  { 'p',"prodcons",prodcons },
+  { 'f',"pool",pool },
+  { 'r',"random",randsiz },
+  { 'g',"realloc",grow },
+  { 'c',"calloc",zeroed },
+  { 'A',"aligned",alignchurn }
+};
+
+int main(int argc,char *argv[])
+{
+  const struct workload *wp;
+  cchar *cmd;
+  ub4 tidcnt,w;
+  size_t iters = 1000000;
+  ub8 seedval = 1;
+  int rv = 0;
+
+  mypid = ospid();
+
+  argc--; argv++;
+  while (argc && argv[0][0] == '-') {
+    if (argv[0][1] == 's') dostat = 1;
+    else { oswrite(1,usagemsg,sizeof(usagemsg) - 1,__LINE__); return 1; }
+    argc--; argv++;
+  }
+  if (argc < 2) { oswrite(1,usagemsg,sizeof(usagemsg) - 1,__LINE__); return 1; }
+
+  cmd = argv[0];
+  tidcnt = atou(argv[1]);
+  if (argc > 2) iters = atoul(argv[2]);
+  if (argc > 3) seedval = atoul(argv[3]);
+  tidcnt = max(tidcnt,1);
+  tidcnt = min(tidcnt,Tids);
+
+  for (w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+    wp = workloads + w;
+    if (*cmd != 'a' && *cmd != wp->cmd) continue;
+    rv = run(wp->name,wp->fn,tidcnt,iters,seedval);
+    if (rv) break;
+  }
+  return rv;
+}
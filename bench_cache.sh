@@ -0,0 +1,16 @@
+#!/bin/sh
+
+# cache behaviour of a bench workload, via perf stat if available, else cachegrind
+# usage: ./bench_cache.sh [path/to/bench] workload threads [iters] [seed]
+# run with the bench of both builds to compare before / after a change
+
+set -e
+
+b=./bench
+if [ -x "$1" ]; then b=$1; shift; fi
+
+if command -v perf >/dev/null 2>&1; then
+  perf stat -e cycles,instructions,L1-dcache-loads,L1-dcache-load-misses,LLC-load-misses "$b" "$@"
+else
+  valgrind --tool=cachegrind --cache-sim=yes --cachegrind-out-file=/dev/null "$b" "$@"
+fi
@@ -0,0 +1,103 @@
+/* bg.h - background maintenance thread
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   A detached thread wakes every Yal_bg_envvar msecs and visits all heaps on global_heaps that are not locked.
+   Per heap it merges buffered remote frees, and runs one free_trim() pass : ageing and release of empty slab regions and cached mmap regions.
+   While it runs, the regfree_interval tick in free() only checks whether the heap was visited within Bg_maxlag ticks.
+   Busy heaps that are never found unlocked thus fall back to the inline work. Private heaps stay locked and are left to their owner.
+   The thread is started at the first ageing tick of a second thread, outside heap locks.
+*/
+
+#include <pthread.h>
+
+#define Logfile Fbg
+
+enum Bgstate { Bg_none,Bg_start,Bg_run,Bg_fail };
+
+static _Atomic ub4 global_bgstate;
+static ub4 global_bgms; // interval from Yal_bg_envvar
+
+struct trimctl;
+static inline bool free_trim(heapdesc *hd,heap *hb,ub4 tick,struct trimctl *tc); // free.h
+
+// heap visited recently, leave trim to the thread
+static inline bool bg_recent(heap *hb)
+{
+  return Atomget(global_bgstate,Monone) == Bg_run && hb->trimcnt - hb->bgtick < Bg_maxlag;
+}
+
+static void bg_heap(heapdesc *hd,heap *hb)
+{
+  ub4 from = 0;
+  ub4 iter = 4;
+  bool locked;
+
+  if (Atomget(hb->lock,Monone)) return; // in use or private
+  if (Cas(hb->lock,from,1) == 0) return;
+  vg_drd_wlock_acq(hb)
+
+  if (hb->pool == nil) {
+    while (hb->remask && hb->stat.xfreebuf != hb->stat.xfreebatch && iter--) slab_unbuffer(hb,Lfree,0);
+    hb->bgtick = hb->trimcnt;
+    hb->stat.bgtrims++;
+    locked = free_trim(hd,hb,(ub4)hb->stat.frees,nil); // normally unlocks
+    if (locked == 0) return;
+  }
+  Atomset(hb->lock,0,Morel);
+  vg_drd_wlock_rel(hb)
+}
+
+static void *bg_main(void Unused *arg)
+{
+  heapdesc *hd = getheapdesc(Lfree);
+  heap *hb;
+  ub4 iter;
+
+  minidiag(Fln,Lnone,Vrb,hd->id,"background thread every %u msec",global_bgms);
+  for (;;) {
+    ossleep(global_bgms);
+    hb = Atomget(global_heaps,Moacq);
+    iter = 1000;
+    while (hb && --iter) {
+      bg_heap(hd,hb);
+      hb = hb->nxt;
+    }
+  }
+  return nil;
+}
+
+// called at heap ageing ticks, outside heap lock. Start once when multithreaded
+static void bg_tick(heapdesc *hd)
+{
+  pthread_attr_t attr;
+  pthread_t tid;
+  ub4 from = Bg_none;
+  int rv;
+
+  if (likely(Atomget(global_bgstate,Monone) != Bg_none) || global_bgms == 0) return;
+  if (hd->tidstate != Ts_mt || Atomget(global_tid,Monone) < 2) return;
+  if (Cas(global_bgstate,from,Bg_start) == 0) return;
+
+  rv = pthread_attr_init(&attr);
+  if (rv == 0) {
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    rv = pthread_create(&tid,&attr,bg_main,nil);
+    pthread_attr_destroy(&attr);
+  }
+  if (rv) minidiag(Fln,Lnone,Warn,hd->id,"cannot create background thread - error %d",rv);
+  Atomset(global_bgstate,rv ? Bg_fail : Bg_run,Morel);
+}
+
+// Yal_bg_envvar=<msecs>
+static void init_bg(void)
+{
+  cchar *envs = getenv(Yal_bg_envvar);
+
+  global_bgms = envs ? atou(envs) : Bg_interval;
+}
+
+#undef Logfile
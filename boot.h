@@ -11,7 +11,9 @@
 
 #define Fln (Fboot << 16) |  __LINE__
 
-static Cold void diag_initrace(void); // diag.h
+#if Yal_enable_trace
+  static Cold void diag_initrace(void); // diag.h
+#endif
 
 #if __STDC_VERSION__ < 201112L // c99
 static void assert_fail(ub4 fln,cchar *msg)
@@ -113,6 +115,13 @@ static void at_exit(void)
 #endif
 
 static void setsigs(void); // dbg.h
+static void init_export(void); // export.h
+static void init_prof(void); // prof.h
+static void init_rec(void); // rec.h
+static void init_reserve(void); // reserve.h
+static void init_memlimit(void); // memlimit.h
+static void init_bg(void); // bg.h
+static void init_fork(void); // fork.h
 
 static ub4 init_stats(ub4 uval)
 {
@@ -161,7 +170,6 @@ static void init_check(void)
 {
   cchar *envs = nil;
   ub4 val = Yal_check_default;
-  ub4 page;
 
 #ifdef Yal_check_envvar
   envs = getenv(Yal_check_envvar);
@@ -170,7 +178,7 @@ static void init_check(void)
   global_check = val;
 
 #if Yal_enable_check
-  page = ospagesize();
+  ub4 page = ospagesize();
   if (page != Pagesize) minidiag(Fln,Lnone,Assert,0,"os page size %u, configured %u",page,Pagesize);
 #endif
 }
@@ -197,5 +205,12 @@ static void init_env(void)
   init_check();
   init_trace();
   init_stats(Hi32);
+  init_export();
+  init_prof();
+  init_rec();
+  init_reserve();
+  init_memlimit();
+  init_bg();
+  init_fork();
 }
 #undef Fln
@@ -13,6 +13,7 @@ set -eu
 tool=guess
 dbg=0
 dev=0
+profile=''
 osinc=0
 printinc=1
 
@@ -21,11 +22,16 @@ usage()
   echo 'usage: build [options] [target]'
   echo
   echo '-a  - analyze'
+  echo '-b  - enable backtrace, needed for Yal_enable_prof'
   echo '-d  - development mode'
+  echo '-F  - fast and safe variant in one yalloc.o, picked at startup. See variant.c'
   echo '-o  - separate object files'
   echo '-q  - quick - build yalloc.o only'
   echo '-t  - also build test'
+  echo '-B  - also build bench'
+  echo '-U  - also build ubench, microbenchmarks of internal functions'
   echo '-m  - create map file'
+  echo '-p  - size classes from profile file, see config.h'
   echo '-v  - verbose'
   echo 'V  - verify'
   echo '-h  - help'
@@ -128,7 +134,10 @@ map=0
 docfg=1
 vrb=0
 bldtst=0
+bldbench=0
+bldubench=0
 quick=0
+variant=0
 verify=0
 target=''
 objs=''
@@ -179,14 +188,18 @@ ld()
 while [ $# -ge 1 ]; do
   case "$1" in
   '-a') cflags="$cflags $cana" ;;
-  '-b') cflags="$cflags -DBacktrace" ;;
+  '-b') cflags="$cflags -DBacktrace -fasynchronous-unwind-tables" ;;
   '-d') cflags="$cflags -DYal_dev" ;;
   '-h'|'-?') usage ;;
   '-m') map=1 ;;
+  '-p') shift; profile="$1" ;;
   '-o') osinc=0; printinc=0 ;;
   '-q') quick=1; docfg=0; ;;
   '-Q') quick=2; docfg=0; ;;
   '-t') bldtst=2 ;;
+  '-B') bldbench=1 ;;
+  '-U') bldubench=1 ;;
+  '-F') variant=1 ;;
   '-T') bldtst=1 ;;
   '-v') vrb=1 ;;
   '-V') verify=1; bldtst=2 ;;
@@ -213,14 +226,31 @@ if [ $docfg -eq 1 ]; then
   cc configure.o configure.c
   ld  configure  "configure.o $objs"
   verbose './configure' './configure'
-  if ./configure "layout.h"; then
+  if ./configure ${profile:+-p "$profile"} "layout.h"; then
     echo "configure returned OK"
   else
     error "configure returned error code $?"
   fi
 fi
 
-cc yalloc.o yalloc.c
+# no checks, trace, full stats or tags
+Yal_fast_flags='-DYal_enable_check=0 -DYal_enable_trace=0 -DYal_enable_stats=1 -DYal_enable_tag=0'
+
+if [ $variant -eq 1 ]; then
+  verbose "$cc -c yalloc.c safe+fast" "$cc -c $cflags [$Yal_fast_flags] -o yalloc_{safe,fast}.o yalloc.c"
+  $cc -c $cflags -DDate=$date -DTime=1$time -o yalloc_safe.o yalloc.c
+  $cc -c $cflags $Yal_fast_flags -DDate=$date -DTime=1$time -o yalloc_fast.o yalloc.c
+  for v in safe fast; do
+    nm -g --defined-only yalloc_$v.o | awk -v p=yal_${v}_ '{ print $3, p $3 }' > yalloc_$v.sym
+    objcopy --redefine-syms=yalloc_$v.sym yalloc_$v.o
+  done
+  awk '{ print "#define Yal_v_" $1 " 1" }' yalloc_safe.sym > variant_gen.h
+  cc variant.o variant.c
+  verbose "ld -r yalloc.o" "$cc -r -nostdlib -o yalloc.o yalloc_safe.o yalloc_fast.o variant.o"
+  $cc -r -nostdlib -o yalloc.o yalloc_safe.o yalloc_fast.o variant.o
+else
+  cc yalloc.o yalloc.c
+fi
 
 if [ $bldtst -ge 2 ]; then
   cc printf.o printf.c
@@ -233,6 +263,18 @@ if [ $bldtst -ge 1 ]; then
   # ld test_libc "test.o yaldum.o $objs"
 fi
 
+if [ $bldbench -eq 1 ]; then
+  cc printf.o printf.c
+  cc bench.o bench.c
+  ld bench "bench.o yalloc.o os.o printf.o"
+fi
+
+if [ $bldubench -eq 1 ]; then
+  cc printf.o printf.c
+  cc ubench.o ubench.c
+  ld ubench "ubench.o os.o printf.o"
+fi
+
 if [ $quick -eq 2 ]; then
   exit 0
 fi
@@ -293,3 +335,51 @@ if ./test -s R 1 0x20000 10000; then
 else
   error "test 4 failed"
 fi
+
+# thread waves
+verbose 'test thread waves' 'test waves"'
+if ./test -s w 8 4 2000 2000; then
+  echo "test 5 ok"
+else
+  error "test 5 failed"
+fi
+
+# arena, size limit errors expected
+verbose 'test arena' 'test arena 100k * 200"'
+if Yalloc_check=1 ./test -s e 100000 200; then
+  echo "test 6 ok"
+else
+  error "test 6 failed"
+fi
+
+# pool zeroing
+verbose 'test pool' 'test pool 48 * 100k"'
+if ./test -s P 48 100000; then
+  echo "test 7 ok"
+else
+  error "test 7 failed"
+fi
+
+# snap and delta
+verbose 'test snap' 'test snap 10k"'
+if ./test -s D 10000; then
+  echo "test 8 ok"
+else
+  error "test 8 failed"
+fi
+
+# fork while threads churn
+verbose 'test fork' 'test fork 4 threads 50 forks"'
+if ./test -s f 4 50; then
+  echo "test 9 ok"
+else
+  error "test 9 failed"
+fi
+
+# hard memory limit
+verbose 'test memlimit' 'test memlimit 128m"'
+if ./test -s L 0x8000000; then
+  echo "test 10 ok"
+else
+  error "test 10 failed"
+fi
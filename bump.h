@@ -43,6 +43,7 @@ static bool newbump(heap *hb,ub4 hid,bregion *reg,ub4 len,ub4 regpos,enum Rtype
 
   user = osmem(Fln,hid,len,"bumpalloc");
   if (user == nil) return 1;
+  osnodebind(hb,user,len);
   vg_mem_name(user,len,"bump region",regpos + 1,0)
   vg_mem_noaccess(user,len)
   meta = bootalloc(Fln,hid,loc,metalen);
@@ -67,14 +68,14 @@ static bool newbump(heap *hb,ub4 hid,bregion *reg,ub4 len,ub4 regpos,enum Rtype
 }
 
 // hb is nil for mimi
-static void *bumpalloc(heapdesc *hd,heap *hb,ub4 hid,bregion *regs,ub4 regcnt,ub4 ulen,ub4 align,enum Loc loc,ub4 tag)
+static void *bumpalloc(heapdesc Unused *hd,heap *hb,ub4 hid,bregion *regs,ub4 regcnt,ub4 ulen,ub4 align,enum Loc loc,ub4 tag)
 {
   ub4 len = ulen;
   ub4 *meta;
   _Atomic ub2 *lens;
   ub4 *tags;
   size_t ip,base;
-  ub4 ord;
+  ub4 Unused ord;
   ub4 pos = 0,apos,cel;
   _Atomic ub1 *fres;
   ub4 regpos=0;
@@ -168,8 +169,69 @@ static void *bump_alloc(heapdesc *hd,heap *hb,ub4 len,ub4 align,enum Loc loc,ub4
   return bumpalloc(hd,hb,hb->id,hb->bumpregs,Bumpregions,len,align,loc,tag);
 }
 
+#if Yal_clas_adapt
+
+static ub4 clas_rate(heap *hb,struct clasinfo *ci)
+{
+  ub4 dt = hb->trimcnt - ci->ratetick;
+
+  if (dt) {
+    ci->rate = dt < 32 ? ci->rate >> dt : 0;
+    ci->ratetick = hb->trimcnt;
+  }
+  return ci->rate;
+}
+
+/* bump or slab for class clas in alloc_heap(), bump as by popularity. hb locked
+   Bump blocks are counted per class of their aligned len, as bump_free() knows only that.
+   When most of these are freed again, the class is moved to slab: bump space is reused only when all of a region is */
+static bool clas_adapt(heapdesc Unused *hd,heap *hb,ub4 clas,ub4 len,bool bump)
+{
+  struct clasinfo *ci = hb->clasinf + clas;
+  struct clasinfo *bci;
+  ub4 bclas;
+  ub4 allocs,frees;
+
+  ci->rate = clas_rate(hb,ci) + 1;
+
+  if (ci->mode == Clas_slab) return 0;
+  if (bump == 0 || len > Bumpmax) return bump;
+
+  bclas = len2clas[doalign4(len,Stdalign)];
+  bci = hb->clasinf + bclas;
+  allocs = ++bci->bumpallocs;
+  if (allocs & (Clas_adapt_sample - 1)) return 1;
+
+  frees = Atomget(hb->clasrem.bumpfrees[bclas],Monone);
+  if ((size_t)frees * 100 < (size_t)allocs * Clas_adapt_freed) return 1;
+
+  ci->mode = Clas_slab;
+  ystats(hb->stat.clas2slab)
+  ytrace(0,hd,Lalloc,0,0,"clas %u len %u to slab after %u bump allocs %u frees",clas,ci->len,allocs,frees)
+  return 0;
+}
+
+// last slab region of clas trimmed. back to bump unless still allocating. hb locked
+static void clas_demote(heapdesc Unused *hd,heap *hb,ub4 clas)
+{
+  struct clasinfo *ci = hb->clasinf + clas;
+  ub4 bclas;
+
+  if (ci->len > Bumpmax || ci->fremsk != 0xfffffffful) return; // not for bump, or regions left
+  if (clas_rate(hb,ci) > Clas_adapt_rate) return;
+
+  ytrace(0,hd,Lfree,0,0,"clas %u len %u to bump after %u allocs",clas,ci->len,ci->cnt)
+  ci->cnt = 0; // popularity from scratch
+  ci->mode = 0;
+  bclas = len2clas[doalign4(ci->len,Stdalign)];
+  hb->clasinf[bclas].bumpallocs = 0;
+  Atomset(hb->clasrem.bumpfrees[bclas],0,Monone);
+  ystats(hb->stat.clas2bump)
+}
+#endif
+
 // returns len. hb may be nil. Region not locked. size() if reqlen = Nolen
-static ub4 bump_free(heapdesc *hd,heap *hb,bregion *reg,size_t ip,size_t reqlen,ub4 fretag,enum Loc loc)
+static ub4 bump_free(heapdesc *hd,heap Unused *hb,bregion *reg,size_t ip,size_t reqlen,ub4 fretag,enum Loc loc)
 {
   size_t base = reg->user;
   ub4 *meta;
@@ -182,8 +244,8 @@ static ub4 bump_free(heapdesc *hd,heap *hb,bregion *reg,size_t ip,size_t reqlen,
   ub4 altag;
   bool didcas;
   enum Rtype typ = reg->typ;
-  char buf[256];
-  void *p;
+  char Unused buf[256];
+  void Unused *p;
 
 #if Yal_enable_check
   if (hb && typ != Rmini) {
@@ -257,6 +319,9 @@ static ub4 bump_free(heapdesc *hd,heap *hb,bregion *reg,size_t ip,size_t reqlen,
 
   ydbg3(loc,"bumpregion %.01llu ptr %zx len %u cel %u tag %.01u state %u",reg->uid,ip,len,cel,fretag,Atomgeta(fres + cel,Moacq))
   Atomset(reg->frees,frees + 1,Morel);
+#if Yal_clas_adapt
+  if (typ == Rbump) Atomad(reg->hb->clasrem.bumpfrees[len2clas[len]],1,Monone);
+#endif
 
 #if 0 // recycle todo requires sync
   if (loc & Lremote) return len;
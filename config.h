@@ -35,7 +35,9 @@
   1 - minimal. Yal_stats(() is defined and a few basic tallies are maintained
   2 - full
    */
-  #define Yal_enable_stats 2
+  #ifndef Yal_enable_stats // -D from build.sh -F
+   #define Yal_enable_stats 2
+  #endif
 
   /* If enabled above, control statistics printing at exit - as bit mask
     1 - summary per heap
@@ -43,13 +45,57 @@
     4 - totals over all heaps
     8 - add state
     32 - add config
+    64 - add sampled histograms, if enabled below. Also written to Yal_hist_file
    */
   #define Yal_stats_envvar "Yalloc_stats"
 
+  /* sampled histograms of requested and granted length, block lifetime and cross-thread frees per class, printed with Yal_stats_hist
+     gathered per thread without atomics, merged at Yal_stats(). Adds minor overhead
+   */
+  #define Yal_enable_hist 0
+  #define Hist_interval 63 // sample 1 in 64 alloc and free calls
+  #define Hist_track 64 // sampled blocks followed for lifetime, per thread. pwr2
+
+  // machine-readable dump of above, loadable as configure profile. pid appended
+  #define Yal_hist_file "yal-hist"
+
+  /* stats export as JSON or Prometheus text, see yal_stats_export() in malloc.h
+     Yal_export_envvar=<opts>[,<secs>] writes it every secs to Yal_export_file-<pid>.json or .prom, checked at heap ageing ticks
+     opts as enum Yal_export_opts
+   */
+  #define Yal_enable_export 1
+  #define Yal_export_envvar "Yalloc_export"
+  #define Yal_export_file "yal-export"
+  #define Yal_export_signal 0 // let SIGUSR2 request a write at the next tick
+
+  /* sampling heap profiler: a backtrace every Prof_rate allocated bytes on average, geometrically distributed. Needs build.sh -b
+     Yal_prof_envvar=<rate> overrides, 0 disables. See yal_heapprofile() in malloc.h
+   */
+  #define Yal_enable_prof 0
+  #define Prof_rate 0x80000 // 512 KB
+  #define Prof_depth 32 // frames
+  #define Prof_stacks 0x1000 // distinct stacks, pwr2
+  #define Prof_samples 0x4000 // live samples, pwr2
+  #define Yal_prof_envvar "Yalloc_prof"
+  #define Yal_prof_file "yal-heap" // pid appended
+
+  /* binary record of each malloc, free etc. call as struct yal_rec in malloc.h, replayable with test p <file>
+     Yal_rec_envvar=1 writes Yal_rec_file-<pid>.bin, per thread in batches of Rec_len records
+   */
+  #define Yal_enable_rec 0
+  #define Rec_len 0x2000
+  #define Yal_rec_envvar "Yalloc_rec"
+  #define Yal_rec_file "yal-rec"
+
+  // cycle-count histograms of internal calls as enum Yal_lat_ops in malloc.h, printed with stats. Uses rdtsc or cntvct. Adds minor overhead
+  #define Yal_enable_lat 0
+
   #define Yal_trigger_stats 0x11223344 // compatible hack - make calloc(0,trigger) invoke Yal_stats()
   #define Yal_trigger_stats_threads 0x11223345
 
-  #define Yal_enable_trace 1 // incurs minor overhead, unless enabled at run time
+  #ifndef Yal_enable_trace
+   #define Yal_enable_trace 1 // incurs minor overhead, unless enabled at run time
+  #endif
   #define Yal_trace_default 0
 
   /* control tracing bitmask
@@ -63,10 +109,14 @@
   #define Yal_trace_ctl "yal_diag.cfg"
 
   // Store callsite tag. Adds minor overhead
-  #define Yal_enable_tag 0
+  #ifndef Yal_enable_tag
+   #define Yal_enable_tag 0
+  #endif
 
   // Enables various internal checks aka assertions. Adds minor overhead. Advised to enable for alpha and beta versions.
-  #define Yal_enable_check 1
+  #ifndef Yal_enable_check
+   #define Yal_enable_check 1
+  #endif
 
   // enable semi stack trace. Adds minor overhead
   #define Yal_enable_stack 0
@@ -96,17 +146,54 @@
 #define Mmap_threshold 16u // mmap threshold for unpopular blocks
 #define Mmap_max_threshold 22u // -rerun configure-  mmap threshold for all blocks
 
+/* reserve address space after large mmap blocks, for realloc to grow in place
+   0 - no
+   1 - for blocks allocated or moved by realloc
+   2 - for all blocks from Mmap_reserve_order
+ */
+#define Yal_mmap_reserve 1
+#define Mmap_reserve_order 20 // 1MB
+#define Mmap_reserve_shift 2 // reserve 4 * len
+#define Mmap_reserve_max 36 // up to 64GB, as order
+
 #define Xclas_threshold 4
 #define Clas_threshold 128 // popularity measure
 
+/* adaptive bump or slab per size class, see clas_adapt() in bump.h
+   a class goes to slab once Clas_adapt_freed % of its bump blocks are freed, as bump space is not reused
+   a class back to bump when its last slab region is trimmed, and its decaying alloc rate is at most Clas_adapt_rate
+ */
+#define Yal_clas_adapt 1
+#define Clas_adapt_sample 16 // pwr2
+#define Clas_adapt_freed 75
+#define Clas_adapt_rate 2
+
 #define Smalclas 1024 // -rerun configure- use tabled class below this len
 
+/* -rerun configure- size classes below Smalclas from a workload profile, via configure -p <file> aka build.sh -p <file>
+   lines of '<len> <count>'. Hot lengths get an exact class, cold classes merge into the next one if within 50%, except pwr2 ones
+   configure fails if the profile classes would increase internal waste
+ */
+#define Class_hot_permille 10 // share of allocations for an exact class
+#define Class_hotmax 16
+#define Class_cold_permille 2 // share of allocations below which a class is merged
+
+/* huge pages for large slab regions
+   0 - none
+   1 - align to huge page and request transparent huge pages via madvise()
+   2 - reserved huge pages via MAP_HUGETLB, else as 1
+ */
+#define Yal_huge_pages 0
+#define Huge_order 21 // 2MB
+#define Huge_threshold 22 // from this region order
+
 // --- memory usage ---
 
 // How many free() calls between a region age step. Must be pwr2 - 1
 static const unsigned int regfree_interval = 0xff;
 
 #define Trim_scan 64 // number of regions to scan at a time. 0 to disable
+#define Trim_effort 4 // ageing rounds for malloc_trim(), enough to release all empty regions
 
 // --- safety ---
 #define Realloc_clear 0 // clear freed part if shrinking block
@@ -119,16 +206,48 @@ static unsigned int Trim_ages[3] = {
   12}; // release mem
 static unsigned int Trim_Ages[3] = {3,6,9}; // idem, larger blocks
 
+/* return pages of recycled slab regions while keeping them mapped, via madvise()
+   0 - no
+   1 - at ageing step 'remove from dir', unmap at 'release mem'
+   2 - as 1, never unmap
+ */
+#define Yal_trim_decommit 1
+#define Decommit_min 0x100000 // min region len to decommit the tail left by a previous use at recycle
+
+/* decommit such that pages read as zero after, e.g. MADV_DONTNEED instead of MADV_FREE
+   calloc() then skips clearing slab cells beyond the previously used part, and decommitted mmap regions
+   Off by default : each trim then drops the pages at once, and their reuse faults in zeroed pages, even for malloc()
+ */
+#define Yal_decommit_zero 0
+#define Calloc_fresh_min 0x40000 // calloc() from this len skips recycled mmap regions needing a clear, for a fresh or decommitted one
+
 static const unsigned int Region_interval = 0xff; // pwr2 - 1
 static const unsigned int Region_alloc = 32; // allow #alloc releases per interval
 static const unsigned long Mmap_retainlimit = 1ul << 30; // directly release memory
+static const unsigned long Mmap_cachelimit = 1ul << 28; // per heap bytes of freed mmap regions kept for reuse. Beyond, release directly
+static const unsigned long Mmap_splitmin = 1ul << 20; // split a reused mmap region that exceeds the request by this much
 
 // --- slab ---
 #define Cel_nolen 1023 // Store user aka net length per cell above this len
+#define Yal_lazy_len 1 // 1 - store above only once a region serves realloc, the cel len standing in until then. 0 - at each alloc
+
+#define Realloc_runmax 8 // realloc grows blocks above Cel_nolen in place into following never-allocated cells, up to this many. 1 to disable
+#define Realloc_headroom 1 // realloc adds ~25% to small blocks from regions that served realloc before
+
+#define Yal_slab_bitmap 64 // cels up to this len have their bin as a bitmap instead of a list of cels, 0 for none
 
 #define Rbinbuf 64 // Initial remote freelist
 #define Buffer_flush 256 // Item threshold to flush remote freelist
 
+// Remote free: 0 - buffer per sending heap, flush with trylock 1 - push directly on a per-region lock-free list
+#define Yal_remote_mpsc 0
+
+// -- per-thread magazine of small cells --
+#define Yal_enable_magazine 1 // serve small malloc / free from a per-thread cache without heap lock
+#define Magazine_len 256 // cache blocks below this len
+#define Magazine_cnt 32 // max cached cells per class
+#define Magazine_fill 16 // cells per refill
+
 // -- bump region (within heap) --
 #define Bumplen 0x4000
 #define Bumpmax 256
@@ -148,6 +267,8 @@ static const unsigned long Mmap_retainlimit = 1ul << 30; // directly release mem
 #define Dirmem_init 8
 #define Dirmem 16
 
+#define Regcache_len 64 // direct-mapped region lookup cache per heap, pwr2. 0 to disable
+
 // --- threading ---
 
 /* 0 - on-demand aka on contention heap creation
@@ -156,6 +277,13 @@ static const unsigned long Mmap_retainlimit = 1ul << 30; // directly release mem
  */
 #define Yal_enable_private 1
 
+/* Heap selection
+  0 - per thread : new or reassigned heap on contention
+  1 - per cpu : heap of the current cpu, picked per call via rseq or getcpu(). At most one heap per cpu. Implies Yal_enable_private 0
+ */
+#define Yal_percpu 0
+#define Maxcpu 1024 // pwr2. cpus above share heaps
+
 static const unsigned int Private_drop_threshold = 1024;
 static const unsigned int Private_interval = 0xff; // pwr2 - 1
 
@@ -169,8 +297,15 @@ static const unsigned int Private_interval = 0xff; // pwr2 - 1
 
 #define L1line 128
 
-// Install thread exit handler - nonportable
+// Install thread exit handler via pthread key: flush the heap and hand it over to new threads
 #define Yal_thread_exit 0
+#define Idleheaps 64 // heaps of exited threads offered first to new threads
+
+/* NUMA: prefer heaps created on the node of the acquiring thread's cpu, and bind their region memory to that node
+   Linux only, via getcpu() and mbind()
+ */
+#define Yal_enable_numa 0
+#define Numa_nodes 8 // nodes tracked in stats, as in struct yal_stats
 
 #define Contention 6 // create per-thread heap if contended * 1 << contention exceeds uncontended
 
@@ -194,6 +329,48 @@ static const unsigned int Private_interval = 0xff; // pwr2 - 1
 // --- extensions / compatibility ---
 #define Yal_enable_extensions 1
 
+// arenas as yal_arena_create() in malloc.h. Chunk len doubles from initial up to max
+#define Yal_enable_arena 1
+#define Arena_chunk 0x10000
+#define Arena_maxchunk 0x4000000
+#define Yal_arena_free 0 // free() of an arena block: 0 - ignore 1 - report as invalid free
+
+// typed pools as yal_pool_create() in malloc.h, each with a private heap
+#define Yal_enable_pool 1
+#define Poolregs 64 // regions per pool
+#define Poolheaps 16 // heaps of destroyed pools kept for reuse
+#define Pool_maxlen 0x10000
+
+/* slab regions built and prefaulted ahead of use, as yal_reserve() in malloc.h
+   Yal_reserve_envvar=<len>:<cnt>[,<len>:<cnt>...] reserves at creation of the first heap
+ */
+#define Yal_enable_reserve 1
+#define Yal_reserve_envvar "Yalloc_reserve"
+#define Reserve_envmax 16 // entries
+
+/* process-wide budget of mapped bytes. Past the soft limit heaps trim harder, see memlimit.h. Past the hard limit allocations fail
+   Yal_memlimit_envvar=<hard>[,<soft>] in bytes with k,m,g suffix, or yal_options(Yal_mem_limit,hard,soft)
+ */
+#define Yal_enable_memlimit 1
+#define Yal_memlimit_envvar "Yalloc_memlimit"
+#define Mem_soft_pct 80 // default soft limit as % of hard
+
+/* background thread for trim and remote free buffers, off the free() path. See bg.h
+   Yal_bg_envvar=<msecs> sets the interval, 0 for none
+ */
+#define Yal_enable_bg 1
+#define Yal_bg_envvar "Yalloc_bg"
+#define Bg_interval 0 // msecs default, 0 to start only when set
+#define Bg_maxlag 1024 // ageing ticks without a visit before free() trims inline again
+
+/* fork safety via pthread_atfork() handlers. See fork.h
+   Yal_fork_envvar=1 or Yal_fork_fresh 1 : the child starts with a new heap, leaving the inherited ones untouched
+ */
+#define Yal_enable_fork 1
+#define Yal_fork_envvar "Yalloc_fork"
+#define Yal_fork_fresh 0
+#define Fork_spin 1024 // lock attempts per heap before fork, after which it yields to let the holder finish its call
+
 #define Yal_psx_memalign 2 // 2 to include valloc
 
 #define Yal_reallocarray 1
@@ -188,17 +188,132 @@ static ub4 header(char *buf,ub4 len,cchar *name,cchar *desc,char *timestr)
   return pos;
 }
 
-static ub4 genclasses(char *buf,ub4 pos,ub4 blen)
+// size profile from configure -p : allocation counts per request length below Smalclas
+static size_t profcnts[Smalclas];
+static size_t proftotal;
+
+static ub4 dclas[Smalclas],dalen[Smalclas]; // default class and cell len per len
+static ub4 xclas[Smalclas],xalen[Smalclas]; // idem, from profile
+
+// read lines of '<len> [count]'. Other lines are ignored, e.g. '#' comments
+static ub4 readprofile(cchar *name)
+{
+  static char pbuf[1u << 20];
+  struct osstat st;
+  int fd;
+  long n;
+  ub4 lines = 0;
+  size_t len,cnt;
+  char *p,*end;
+
+  fd = osopen(name,&st);
+  if (fd == -1) return error(L,"cannot open profile %s: %m",name);
+  n = osread(fd,pbuf,sizeof(pbuf) - 1);
+  osclose(fd);
+  if (n <= 0) return error(L,"cannot read profile %s: %m",name);
+  if (n == sizeof(pbuf) - 1) warning(L,"profile %s truncated at %ld",name,n);
+
+  p = pbuf;
+  end = pbuf + n;
+  *end = '\n';
+  while (p < end) {
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p >= '0' && *p <= '9') {
+      len = cnt = 0;
+      while (*p >= '0' && *p <= '9') len = len * 10 + (size_t)(*p++ - '0');
+      while (*p == ' ' || *p == '\t') p++;
+      if (*p >= '0' && *p <= '9') {
+        while (*p >= '0' && *p <= '9') cnt = cnt * 10 + (size_t)(*p++ - '0');
+      } else cnt = 1;
+      if (len && len < Smalclas) {
+        profcnts[len] += cnt;
+        proftotal += cnt;
+      }
+      lines++;
+    }
+    while (*p != '\n') p++;
+    p++;
+  }
+  info(L,"  profile %s: %u lines %zu` allocs below %u",name,lines,proftotal,Smalclas);
+  if (proftotal == 0) return error(L,"profile %s has no lengths below %u",name,Smalclas);
+  return lines;
+}
+
+// internal waste in permille of requested bytes
+static ub4 waste(const ub4 *alens)
+{
+  size_t len,cnt,net = 0,gross = 0;
+
+  for (len = 1; len < Smalclas; len++) {
+    cnt = profcnts[len];
+    net += cnt * len;
+    gross += cnt * alens[len];
+  }
+  return net ? (ub4)((gross - net) * 1000 / net) : 0;
+}
+
+/* exact classes for hot lengths, and merge cold classes into the next one
+   class numbers stay ascending with length and the top class keeps its number, so the formula above Smalclas continues */
+static ub4 profclasses(void)
+{
+  static ub1 isbound[Smalclas + 1],ishot[Smalclas + 1];
+  static ub4 bclas[Smalclas + 1];
+  static size_t cnts[Smalclas];
+  size_t cnt,hicnt;
+  ub4 len,hilen,b,n,prv,hot,clas;
+  ub4 top = dalen[Smalclas - 1];
+  ub4 topclas = dclas[Smalclas - 1];
+
+  for (len = 1; len < Smalclas; len++) isbound[dalen[len]] = 1;
+
+  memcpy(cnts,profcnts,sizeof(cnts));
+  for (hot = 0; hot < Class_hotmax; hot++) {
+    hicnt = hilen = 0;
+    for (len = 1; len < Smalclas; len++) {
+      if (cnts[len] > hicnt) { hicnt = cnts[len]; hilen = len; }
+    }
+    if (hicnt * 1000 < proftotal * Class_hot_permille) break;
+    cnts[hilen] = 0;
+    b = hilen <= 16 ? dalen[hilen] : doalign4(hilen,Stdalign);
+    if (isbound[b] == 0) info(L,"  hot len %4u count %zu` class len %u",hilen,hicnt,b);
+    isbound[b] = ishot[b] = 1;
+  }
+
+  prv = 0;
+  for (b = 1; b < top; b++) {
+    if (isbound[b] == 0) continue;
+    if (b <= 16 || ishot[b] || (b & (b - 1)) == 0) { prv = b; continue; } // aligned alloc uses pwr2 classes
+    for (n = b + 1; isbound[n] == 0; n++) ;
+    cnt = 0;
+    for (len = prv + 1; len <= b; len++) cnt += profcnts[len];
+    if (cnt * 1000 < proftotal * Class_cold_permille && n * 2 <= prv * 3) {
+      verb(L,"merge class len %u into %u",b,n);
+      isbound[b] = 0;
+    } else prv = b;
+  }
+
+  clas = 0; // number ascending, top keeps its number
+  for (b = 1; b < top; b++) {
+    if (isbound[b]) bclas[b] = ++clas;
+  }
+  bclas[top] = topclas;
+  if (clas >= topclas) fatal(L,"profile needs %u classes below len %u, max %u",clas + 1,top,topclas);
+
+  for (len = 1; len < Smalclas; len++) {
+    for (b = len; isbound[b] == 0; b++) ;
+    xalen[len] = b;
+    xclas[len] = bclas[b];
+  }
+  return clas + 1;
+}
+
+// fill default classes per len below Smalclas
+static ub4 defclasses(void)
 {
   ub4 len,ord,cord,alen,clen,clasal;
-  ub4 clas,hiclas = 0,basclas = 0;
+  ub4 clas,basclas = 0;
   ub4 grain = class_grain;
   ub4 grain1 = class_grain1;
-  char comma;
-  static ub4 clas2len[Clascnt];
-
-  clas = 0; // reserve for len 0
-  pos += snprintf_mini(buf,pos,blen,"\nstatic const unsigned char len2clas[%u] = { // %u \n  %3u,",Smalclas,grain,clas);
 
   for (len = 1; len <  64; len++) {
     switch(len) {
@@ -221,12 +336,8 @@ static ub4 genclasses(char *buf,ub4 pos,ub4 blen)
   #error "Stdalign > 16 not supported"
 #endif
     }
-    // info(L,"class %u len %u / %u",clas,alen,clas2len[clas]);
-    if (clas2len[clas] == 0) clas2len[clas] = alen;
-    else if (alen != clas2len[clas]) fatal(L,"class %u len %u vs %u",clas,alen,clas2len[clas]);
-
-    pos += snprintf_mini(buf,pos,blen,"%3u,",clas);
-    if  ( (len & 3) == 3) pos += snprintf_mini(buf,pos,blen," // %3u - %3u\n  ",len & ~3u,len);
+    dclas[len] = clas;
+    dalen[len] = alen;
   }
 
   for (len = 64; len <  Smalclas; len++) {
@@ -239,15 +350,46 @@ static ub4 genclasses(char *buf,ub4 pos,ub4 blen)
       if (clen == 0) clen = 4;
       clas = ord * (grain + 1) + clen + basclas - 7 * grain1;
       verb(L,"clas %2u for len %5u ord %u.%u alen %u clen %x",clas,len,ord,cord,alen,clen);
-      if (clas2len[clas] == 0) clas2len[clas] = alen;
-      else if (alen != clas2len[clas]) fatal(L,"class %u len %u vs %u",clas,alen,clas2len[clas]);
     } else { // pwr2
       ord = ctz(len);
       clas = (ord + 1) * grain1 + basclas - 7 * grain1; // smal uses 8 and covers 6 * (grain + 1)
-      if (clas2len[clas] == 0) clas2len[clas] = len;
-      else if (len != clas2len[clas]) fatal(L,"class %u len %u vs %u",clas,len,clas2len[clas]);
+      alen = len;
       verb(L,"clas %2u for len %5u ord %u",clas,len,ord);
     }
+    dclas[len] = clas;
+    dalen[len] = alen;
+  }
+  return basclas;
+}
+
+static ub4 genclasses(char *buf,ub4 pos,ub4 blen)
+{
+  ub4 len,clas,hiclas = 0,basclas,clascnt;
+  ub4 dwaste,xwaste;
+  const ub4 *lclas = dclas,*lalen = dalen;
+  char comma;
+  static ub4 clas2len[Clascnt];
+
+  basclas = defclasses();
+  clascnt = dclas[Smalclas - 1];
+  dwaste = xwaste = waste(dalen);
+
+  if (proftotal) { // from profile
+    clascnt = profclasses();
+    xwaste = waste(xalen);
+    info(L,"  profile classes %u waste %u.%u%% default %u.%u%%",clascnt,xwaste / 10,xwaste % 10,dwaste / 10,dwaste % 10);
+    if (xwaste > dwaste) fatal(L,"profile classes increase waste from %u to %u permille",dwaste,xwaste);
+    lclas = xclas;
+    lalen = xalen;
+  }
+
+  clas = 0; // reserve for len 0
+  pos += snprintf_mini(buf,pos,blen,"\nstatic const unsigned char len2clas[%u] = { // %u \n  %3u,",Smalclas,class_grain,clas);
+
+  for (len = 1; len <  Smalclas; len++) {
+    clas = lclas[len];
+    if (clas2len[clas] == 0) clas2len[clas] = lalen[len];
+    else if (lalen[len] != clas2len[clas]) fatal(L,"class %u len %u vs %u",clas,lalen[len],clas2len[clas]);
     hiclas = max(clas,hiclas);
 
     comma = (len < Smalclas - 1) ? ',' : ' ';
@@ -257,15 +399,22 @@ static ub4 genclasses(char *buf,ub4 pos,ub4 blen)
 
   pos += snprintf_mini(buf,pos,blen,"}; // len2clas max %u \n\n",hiclas);
 
-  pos += snprintf_mini(buf,pos,blen,"\nstatic const unsigned char clas2len[%u] = { ",basclas + 1);
+  pos += snprintf_mini(buf,pos,blen,"\nstatic const unsigned short clas2len[%u] = { ",hiclas + 1);
 
-  for (clas = 0; clas <=  basclas; clas++) {
-    pos += snprintf_mini(buf,pos,blen,"%s%2u",clas ? "," : "",clas2len[clas]);
+  for (clas = 0; clas <= hiclas; clas++) {
+    pos += snprintf_mini(buf,pos,blen,"%s%u",clas ? "," : "",clas2len[clas]);
   }
   pos += snprintf_mini(buf,pos,blen," };\n\n");
 
   pos += snprintf_mini(buf,pos,blen,"#define Baseclass %u\n\n",basclas);
 
+  // tables used below this len, formula above
+  pos += snprintf_mini(buf,pos,blen,"#define Class_profile %u\n",proftotal != 0);
+  pos += snprintf_mini(buf,pos,blen,"#define Tabclas %u\n",proftotal ? Smalclas : 64);
+  pos += snprintf_mini(buf,pos,blen,"#define Class_count %u // in use below Smalclas\n",clascnt);
+  pos += snprintf_mini(buf,pos,blen,"#define Class_waste_base %u // permille for profile\n",dwaste);
+  pos += snprintf_mini(buf,pos,blen,"#define Class_waste %u\n\n",xwaste);
+
   return pos;
 }
 
@@ -368,7 +517,7 @@ static ub4 genconfig(cchar *name,ub4 pagebits,char *nowtim)
 }
 
 static int usage(void) {
-  info(0,"usage: configure <layout_file>");
+  info(0,"usage: configure [-v] [-p profile] <layout_file>");
   return 1;
 }
 
@@ -379,21 +528,27 @@ int main(int argc,char *argv[])
   time_t now;
   ub4 pagebits = 0;
   cchar *arg;
+  cchar *profile = nil;
   char c;
 
-  if (argc > 1) {
+  while (argc > 1 && argv[1][0] == '-') {
     arg = argv[1];
-    if (arg[0] == '-') {
-      c  = arg[1];
-      switch (c) {
-      case  'h': case '?': return usage();
-      case 'v': if (loglvl < Nolvl) loglvl++; break;
-      case '-':
-        if (strcmp(arg + 1,"help") == 0) return usage();
-        break;
-      }
+    c  = arg[1];
+    switch (c) {
+    case  'h': case '?': return usage();
+    case 'v': if (loglvl < Nolvl) loglvl++; break;
+    case 'p':
+      if (argc < 3) return usage();
+      profile = argv[2];
+      argc--; argv++;
+      break;
+    case '-':
+      if (strcmp(arg + 1,"help") == 0) return usage();
+      break;
     }
+    argc--; argv++;
   }
+  if (profile && readprofile(profile) == 0) return 1;
 
   info(0,"  generating config for yalloc %s",yal_version);
   now = time(NULL);
@@ -291,6 +291,7 @@ static inline void do_ypush(heapdesc*hd,enum Loc loc,ub4 fln)
  #define ypush(hb,loc,fln)
 #endif
 
+#if Yal_enable_trace
 /* diag file has an entry per line to override default for a single diag code or range
    -123   disable
    +123  enable
@@ -349,6 +350,7 @@ static Cold void diag_initrace(void)
     while (n < len && c && c != '\n') c = buf[n++];
   }
 }
+#endif
 
 static ub4 trace_enable(ub4 ena)
 {
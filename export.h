@@ -0,0 +1,318 @@
+/* export.h - machine-readable statistics
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   Write the fields of struct yal_stats for the totals and optionally each heap as JSON or Prometheus text exposition into a caller buffer.
+   Nothing is allocated, so a metrics thread can poll it. Heap stats are read without lock as for yal_mstats()
+   Optionally written periodically to a file, replaced atomically as expected by e.g. node exporter's textfile collector.
+   yal_stats_snap() copies only the counters kept live per heap and heap base, for polling at short intervals. yal_stats_delta() turns two into rates.
+*/
+
+#define Logfile Fexport
+
+struct expfield {
+  cchar *name;
+  ub4 ofs;
+  ub2 siz;
+  ub2 gauge;
+};
+
+#define Ec(f) { #f,offsetof(yalstats,f),sizeof(((yalstats *)0)->f),0 },
+#define Eg(f) { #f,offsetof(yalstats,f),sizeof(((yalstats *)0)->f),1 },
+
+static const struct expfield expfields[] = {
+  Ec(allocs) Ec(callocs) Ec(alloc0s) Ec(slaballocs) Ec(slabAllocs) Ec(mapallocs) Ec(mapAllocs)
+  Ec(reallocles) Ec(reallocgts) Ec(Reallocles) Ec(reallocruns) Ec(mreallocles) Ec(mreallocgts)
+  Ec(mrealinplace) Ec(mrealmoves) Ec(mrealcopies) Ec(mreserves)
+  Ec(miniallocs) Ec(bumpallocs) Ec(arenas) Ec(arenaallocs) Ec(arenabytes)
+  Ec(frees) Ec(free0s) Ec(freenils) Ec(slabfrees) Ec(mapfrees) Ec(slabxfrees) Ec(xslabfrees) Ec(mapxfrees) Ec(xmapfrees) Ec(minifrees) Ec(bumpfrees)
+  Ec(sizes) Ec(binallocs) Ec(mmaps) Ec(munmaps)
+  Ec(findregions) Ec(regcachehits) Ec(regcachemisses) Ec(locks) Ec(clocks)
+  Ec(xfreebuf) Ec(xfreebatch) Ec(xfreedropped) Ec(rbinallocs) Ec(xbufbytes)
+  Ec(invalid_frees) Ec(invalid_reallocs) Ec(errors)
+  Ec(newregions) Ec(useregions) Ec(delregions) Ec(newmpregions) Ec(usempregions) Ec(delmpregions)
+  Eg(region_cnt) Eg(freeregion_cnt) Eg(delregion_cnt) Eg(xregion_cnt)
+  Ec(decommits) Ec(decombytes) Ec(callocclear) Ec(calloczero)
+  Ec(newheaps) Ec(useheaps) Ec(getheaps) Ec(nogetheaps) Ec(nogetheap0s) Ec(idleheaps) Ec(handovers)
+  Ec(numalocal) Ec(numaremote) Ec(numafails)
+  Eg(frecnt) Eg(fresiz) Eg(fremapsiz) Eg(inuse) Eg(inusecnt) Eg(inmapuse) Eg(inmapusecnt)
+  Eg(slabmem) Eg(mapmem) Eg(hugemem) Eg(hugeregions)
+  Eg(minlen) Eg(maxlen) Eg(mapminlen) Eg(mapmaxlen)
+};
+
+#undef Ec
+#undef Eg
+
+#define Expfields (ub4)(sizeof(expfields) / sizeof(struct expfield))
+
+static size_t expval(const yalstats *sp,const struct expfield *fp)
+{
+  const char *p = (const char *)sp + fp->ofs;
+  size_t v;
+  ub4 u;
+
+  if (fp->siz == sizeof(size_t)) { memcpy(&v,p,sizeof(v)); return v; }
+  memcpy(&u,p,sizeof(u));
+  return u;
+}
+
+// one object per heap or totals
+static ub4 exp_json(char *buf,ub4 pos,ub4 len,const yalstats *sp,ub4 hid)
+{
+  ub4 f;
+
+  if (hid) pos += snprintf_mini(buf,pos,len,"{\"id\":%u",hid);
+  else pos += snprintf_mini(buf,pos,len,"{\"version\":\"%s\"",yal_version);
+  for (f = 0; f < Expfields && pos + 64 < len; f++) {
+    pos += snprintf_mini(buf,pos,len,",\"%s\":%zu",expfields[f].name,expval(sp,expfields + f));
+  }
+  buf[pos++] = '}';
+  return pos;
+}
+
+size_t Cold yal_stats_export(char *buf,size_t blen,ub4 opts,ub4 tag)
+{
+  yalstats sum;
+  const struct expfield *fp;
+  heap *hb,*heaps;
+  unsigned long pid = Atomget(global_pid,Monone);
+  ub4 len,pos = 0;
+  ub4 f,iter;
+  bool doheaps = (opts & Yal_export_heaps);
+  cchar *kind;
+
+  if (buf == nil || blen < 256) return 0;
+  len = (ub4)min(blen,Hi31) - 2; // room for nul
+
+  yal_mstats(&sum,Yal_stats_totals,tag,"export"); // also updates per-heap stats
+
+  heaps = Atomget(global_heaps,Moacq);
+
+  if (opts & Yal_export_prom) {
+    for (f = 0; f < Expfields; f++) {
+      fp = expfields + f;
+      kind = fp->gauge ? "gauge" : "counter";
+      pos += snprintf_mini(buf,pos,len,"# TYPE yalloc_%s %s\nyalloc_%s{pid=\"%lu\"} %zu\n",fp->name,kind,fp->name,pid,expval(&sum,fp));
+      if (doheaps == 0) { if (pos + 256 >= len) return 0; continue; }
+
+      pos += snprintf_mini(buf,pos,len,"# TYPE yalloc_heap_%s %s\n",fp->name,kind);
+      iter = 1000;
+      for (hb = heaps; hb && --iter; hb = hb->nxt) {
+        pos += snprintf_mini(buf,pos,len,"yalloc_heap_%s{pid=\"%lu\",heap=\"%u\"} %zu\n",fp->name,pid,hb->id,expval(&hb->stat,fp));
+        if (pos + 256 >= len) return 0;
+      }
+    }
+  } else { // json
+    pos = snprintf_mini(buf,0,len,"{\"pid\":%lu,\"tag\":%u,\"total\":",pid,tag);
+    pos = exp_json(buf,pos,len,&sum,0);
+    if (doheaps) {
+      pos += snprintf_mini(buf,pos,len,",\"heaps\":[");
+      iter = 1000;
+      for (hb = heaps; hb && --iter; hb = hb->nxt) {
+        if (hb != heaps) buf[pos++] = ',';
+        pos = exp_json(buf,pos,len,&hb->stat,hb->id);
+        if (pos + 256 >= len) return 0;
+      }
+      buf[pos++] = ']';
+    }
+    buf[pos++] = '}';
+    buf[pos++] = '\n';
+    if (pos + 64 >= len) return 0;
+  }
+  buf[pos] = 0;
+  return pos;
+}
+
+// -- snapshot --
+
+#define Snap_first offsetof(struct yal_snap,allocs)
+#define Snap_cnts ((offsetof(struct yal_snap,memrelieves) - Snap_first) / sizeof(size_t) + 1)
+
+size_t yal_stats_snap(struct yal_snap *snaps,size_t cnt)
+{
+  struct yal_snap *sp;
+  const yalstats *hs;
+  const struct hdstats *ds;
+  heap *hb;
+  heapdesc *hd;
+  unsigned long long now = osnsecs();
+  size_t n = 0;
+  ub4 t,iter;
+
+  if (snaps == nil) return 0;
+
+  iter = 1000;
+  for (hb = Atomget(global_heaps,Moacq); hb && n < cnt && --iter; hb = hb->nxt) { // read without lock, as yal_mstats()
+    sp = snaps + n++;
+    memset(sp,0,sizeof(struct yal_snap));
+    hs = &hb->stat;
+    sp->nsecs = now;
+    sp->id = hb->id;
+    sp->kind = Yal_snap_heap;
+    sp->heapfrees = hs->frees;
+    sp->xfrees = hs->xfreebuf;
+    sp->xfreebatch = hs->xfreebatch;
+    sp->mapallocs = hs->mapallocs + hs->mapAllocs;
+    sp->mapfrees = hs->mapfrees;
+    sp->mmaps = hs->mmaps;
+    for (t = 0; t < 8; t++) sp->trimregions += hs->trimregions[t];
+    sp->decommits = hs->decommits;
+    sp->decombytes = hs->decombytes;
+    sp->bgtrims = hs->bgtrims;
+    sp->memrelieves = hs->memrelieves;
+  }
+
+  iter = 1000;
+  for (hd = Atomget(global_heapdescs,Moacq); hd && n < cnt && --iter; hd = hd->nxt) {
+    sp = snaps + n++;
+    memset(sp,0,sizeof(struct yal_snap));
+    ds = &hd->stat;
+    sp->nsecs = now;
+    sp->id = hd->id;
+    sp->kind = Yal_snap_thread;
+    sp->allocs = ds->apiallocs;
+    sp->reallocs = ds->apireallocs;
+    sp->frees = ds->apifrees;
+    sp->magallocs = ds->magallocs;
+    sp->magfrees = ds->magfrees;
+    sp->getheaps = ds->getheaps;
+    sp->nogetheaps = ds->nogetheaps;
+    sp->munmaps = ds->munmaps;
+    sp->invalid_frees = ds->invalid_frees;
+    sp->ownerfrees = ds->ownerfrees;
+    sp->ownerbusy = ds->ownerbusy;
+  }
+  return n;
+}
+
+size_t yal_stats_delta(const struct yal_snap *prv,const struct yal_snap *cur,struct yal_snap *rate)
+{
+  struct yal_snap dif;
+  const char *a = (const char *)prv + Snap_first;
+  const char *b = (const char *)cur + Snap_first;
+  char *r = (char *)&dif + Snap_first;
+  unsigned long long usecs;
+  size_t x,y,frees,xfrees;
+  ub4 i;
+
+  if (prv == nil || cur == nil || rate == nil) return 0;
+  if (prv->id != cur->id || prv->kind != cur->kind || cur->nsecs <= prv->nsecs) return 0;
+  usecs = (cur->nsecs - prv->nsecs) / 1000;
+  if (usecs == 0) return 0;
+
+  xfrees = cur->xfrees - prv->xfrees;
+  frees = cur->heapfrees - prv->heapfrees + xfrees;
+
+  dif = *cur;
+  dif.nsecs = cur->nsecs - prv->nsecs;
+  dif.xpermille = frees ? (ub4)(xfrees * 1000 / frees) : 0;
+
+  for (i = 0; i < Snap_cnts; i++) { // read without lock, so not strictly monotonic
+    memcpy(&x,a + i * sizeof(size_t),sizeof(size_t));
+    memcpy(&y,b + i * sizeof(size_t),sizeof(size_t));
+    y = y >= x ? (size_t)((y - x) * 1000000ull / usecs) : 0;
+    memcpy(r + i * sizeof(size_t),&y,sizeof(size_t));
+  }
+  *rate = dif; // may be prv or cur
+  return (size_t)usecs;
+}
+
+// -- periodic --
+
+static ub4 global_export; // opts from Yal_export_envvar
+static ub4 global_export_secs;
+static _Atomic unsigned long global_export_due;
+static _Atomic ub4 global_export_req; // from signal
+static _Atomic ub4 global_export_busy;
+
+static void export_file(void)
+{
+  static char expbuf[1u << 18];
+  char fname[256],tname[256];
+  unsigned long pid = Atomget(global_pid,Monone);
+  ub4 opts = global_export;
+  cchar *ext = (opts & Yal_export_prom) ? ".prom" : ".json";
+  size_t len;
+  int fd;
+  ub4 zero = 0;
+
+  if (Cas(global_export_busy,zero,1) == 0) return;
+
+  len = yal_stats_export(expbuf,sizeof(expbuf),opts,Fln);
+  if (len == 0 && (opts & Yal_export_heaps)) len = yal_stats_export(expbuf,sizeof(expbuf),opts & ~Yal_export_heaps,Fln); // too many heaps
+
+  snprintf_mini(fname,0,255,"%.64s-%lu%s",Yal_export_file,pid,ext);
+  snprintf_mini(tname,0,255,"%.64s-%lu%s.tmp",Yal_export_file,pid,ext);
+
+  if (len) {
+    fd = oscreate(tname);
+    if (fd != -1) {
+      oswrite(fd,expbuf,len,Fln);
+      osclose(fd);
+      if (osrename(tname,fname)) do_ylog(Diagcode,Lstats,Fln,Warn,0,"cannot rename %s to %s - %m",tname,fname);
+    }
+  }
+  Atomset(global_export_busy,0,Morel);
+}
+
+// called at heap ageing ticks, outside heap lock
+static void export_tick(void)
+{
+  unsigned long now,due;
+  ub4 req;
+
+  if (likely(global_export == 0)) return;
+
+  req = Atomget(global_export_req,Monone);
+  if (req) {
+    if (Cas(global_export_req,req,0) == 0) return;
+  } else {
+    if (global_export_secs == 0) return;
+    now = ostime();
+    due = Atomget(global_export_due,Monone);
+    if (now < due) return;
+    if (Cas(global_export_due,due,now + global_export_secs) == 0) return; // another thread
+  }
+  export_file();
+}
+
+#if Yal_export_signal
+static void export_sig(int Unused sig)
+{
+  Atomset(global_export_req,1,Morel);
+}
+#endif
+
+// Yal_export_envvar=<opts>[,<secs>]
+static void init_export(void)
+{
+  cchar *envs = getenv(Yal_export_envvar);
+  ub4 opts;
+
+  if (envs == nil) return;
+  opts = atou(envs);
+  if ((opts & (Yal_export_json | Yal_export_prom)) == 0) return;
+
+  while (*envs >= '0' && *envs <= '9') envs++;
+  if (*envs == ',') global_export_secs = atou(envs + 1);
+
+  Atomset(global_export_due,ostime() + global_export_secs,Monone);
+  global_export = opts;
+
+#if Yal_export_signal
+  struct sigaction sa;
+
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler = export_sig;
+#ifdef SA_RESTART
+  sa.sa_flags = SA_RESTART;
+#endif
+  sigaction(SIGUSR2,&sa,nil);
+#endif
+  minidiag(Fln,Lnone,Vrb,0,"export %u every %u sec",opts,global_export_secs);
+}
+
+#undef Logfile
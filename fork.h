@@ -0,0 +1,159 @@
+/* fork.h - fork safety
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   pthread_atfork() handlers, registered at init.
+   Before fork, the forking thread takes the locks of all heaps on global_heaps, in list order, then the boot memory locks.
+   These are held for one call only, so it keeps trying, yielding after each Fork_spin attempts.
+   The private heap of another thread is never unlocked. Its calls mark the heap instead, see priv_enter(). Prepare waits until none is in progress.
+   After fork, the parent releases the taken locks. The child releases them as well, leaving heaps to the forking thread and to threads it creates,
+   as for heaps of exited threads. Only the forking thread's own heap remains assigned.
+   The child also unlocks private heaps of other threads, as these threads do not exist there. A private heap whose owner had entered a call again
+   just before fork stays locked, as its state cannot be trusted. While prepare holds the heaps, threads needing one wait in heap_new().
+   A heap still created after the walk started, e.g. for a pool, stays locked as well.
+   With Yal_fork_envvar=1 the child leaves the inherited heaps locked instead and starts with a new heap. The parent's pages then stay shared,
+   except for remote frees of inherited blocks, which are buffered in the new heap.
+   The background thread is not inherited and started again as needed.
+*/
+
+#include <pthread.h>
+
+#define Logfile Ffork
+
+enum Forkheld { Fork_none,Fork_locked,Fork_private };
+
+static heap *fork_heap0; // list head at prepare, heaps below are held
+static bool global_forkfresh;
+
+static void fork_lock(_Atomic ub4 *lock)
+{
+  ub4 zero = 0,iter = 0;
+
+  while (Casa(lock,&zero,1) == 0) {
+    if ((++iter % Fork_spin) == 0) osyield(); // let a preempted holder finish its call
+    else Pause
+    zero = 0;
+  }
+}
+
+// the heap is private to another thread
+static heapdesc *fork_owner(heap *hb,heapdesc *self)
+{
+  heapdesc *hd;
+
+  for (hd = Atomget(global_heapdescs,Moacq); hd; hd = hd->nxt) {
+    if (hd != self && hd->hb == hb && hd->tidstate == Ts_private) return hd;
+  }
+  return nil;
+}
+
+// lock the heap, or wait until its private owner is not in a call
+static enum Forkheld fork_hold(heap *hb,heapdesc *self)
+{
+  ub4 zero,iter = 0;
+
+  do {
+    zero = 0;
+    if (Casa(&hb->lock,&zero,1)) return Fork_locked;
+    if (Atomget(hb->incall,Moacq) == 0 && fork_owner(hb,self)) return Fork_private;
+    if ((++iter % Fork_spin) == 0) osyield();
+    else Pause
+  } while (1);
+}
+
+static void fork_prepare(void)
+{
+  heapdesc *hd = tid_gethd();
+  heap *hb,*own = nil;
+  ub4 i;
+
+  if (hd && hd->tidstate == Ts_private) own = hd->hb; // already held
+
+  Atomset(global_forking,1,Morel); // threads wait in heap_new() instead of adding heaps
+  hb = fork_heap0 = Atomget(global_heaps,Moacq);
+  while (hb) {
+    if (hb == own) hb->forkheld = Fork_none;
+    else {
+      hb->forkheld = fork_hold(hb,hd);
+      if (hb->forkheld == Fork_locked) { vg_drd_wlock_acq(hb) }
+    }
+    hb = hb->nxt;
+  }
+
+  // an owner may have given up its private state meanwhile, releasing the lock
+  for (hb = fork_heap0; hb; hb = hb->nxt) {
+    if (hb->forkheld == Fork_private && fork_owner(hb,hd) == nil) {
+      fork_lock(&hb->lock);
+      vg_drd_wlock_acq(hb)
+      hb->forkheld = Fork_locked;
+    }
+  }
+
+  // last, as a heap holder may need boot memory to finish its call
+  for (i = 0; i < Bootcnt; i++) fork_lock(&bootmems[i].lock);
+}
+
+// child: clear the private state of heaps whose owner thread is gone
+static void fork_unprivate(heap *hb)
+{
+  heapdesc *hd = fork_owner(hb,tid_gethd());
+
+  if (hd == nil || Atomget(hb->incall,Moacq)) return; // in a call at fork
+  hd->tidstate = Ts_mt;
+  hd->hb = nil;
+  Atomset(hb->lock,0,Morel);
+}
+
+static void fork_release(bool heaps,bool child)
+{
+  heap *hb;
+  ub4 i;
+
+  for (i = 0; i < Bootcnt; i++) Atomset(bootmems[i].lock,0,Morel);
+
+  for (hb = fork_heap0; hb; hb = hb->nxt) {
+    if (hb->forkheld == Fork_locked && heaps) {
+      Atomset(hb->lock,0,Morel);
+      vg_drd_wlock_rel(hb)
+    } else if (hb->forkheld == Fork_private && heaps && child) fork_unprivate(hb);
+    hb->forkheld = Fork_none;
+  }
+  fork_heap0 = nil;
+  Atomset(global_forking,0,Morel);
+}
+
+static void fork_parent(void)
+{
+  fork_release(1,0);
+}
+
+static void fork_child(void)
+{
+  heapdesc *hd = tid_gethd();
+  bool fresh = global_forkfresh;
+
+  Atomset(global_pid,ospid(),Monone);
+#if Yal_enable_bg
+  Atomset(global_bgstate,Bg_none,Morel);
+#endif
+
+  if (fresh && hd) hd->hb = nil; // next call creates a heap, as no inherited one can be locked
+  fork_release(fresh == 0,1);
+  ydbg1(Fln,Lnone,"fork child %lu %s heaps",Atomget(global_pid,Monone),fresh ? "new" : "inherited")
+}
+
+// Yal_fork_envvar=1 for a new heap in the child
+static void init_fork(void)
+{
+  cchar *envs = getenv(Yal_fork_envvar);
+  int rv;
+
+  global_forkfresh = envs ? (atou(envs) != 0) : Yal_fork_fresh;
+  rv = pthread_atfork(fork_prepare,fork_parent,fork_child);
+  if (rv) minidiag(Fln,Lnone,Warn,0,"cannot install fork handlers - error %d",rv);
+}
+
+#undef Logfile
@@ -62,13 +62,15 @@ static enum Status free_mmap(heapdesc *hd,heap *hb,mpregion *reg,size_t ap,size_
     if (align) setregion(hb,(xregion *)reg,ip + align,Pagesize,0,Lfree,Fln);
     reg->align = 0;
 
-    if (len >= Mmap_retainlimit) { // release directly
+    if (len >= Mmap_retainlimit || hb->mpcachelen + len > Mmap_cachelimit) { // release directly
       preg = hb->freemp0regs;
       hb->freemp0regs = reg;
       reg->frenxt = preg;
       reg->freprv = nil;
       if (preg) preg->freprv = reg;
-      osmunmap((void *)ip,len);
+      osmunmap((void *)ip,len + reg->rsvlen);
+      mem_uncharge(len);
+      reg->rsvlen = 0;
       hd->stat.munmaps++;
       reg->len = 0;
       reg->aged = 3;
@@ -80,6 +82,7 @@ static enum Status free_mmap(heapdesc *hd,heap *hb,mpregion *reg,size_t ap,size_
     reg->frenxt = preg;
     reg->freprv = nil;
     if (preg) preg->freprv = reg;
+    hb->mpcachelen += len;
 
     hb->stat.trimregions[5]++;
     Atomset(reg->age,2,Morel);
@@ -92,33 +95,101 @@ static enum Status free_mmap(heapdesc *hd,heap *hb,mpregion *reg,size_t ap,size_
   return St_ok;
 }
 
-// Mark empty regions for reuse, and free after a certain 'time'
-// returns lock state
-static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
+// explicit trim from yal_trim()
+struct trimctl {
+  size_t retain; // resident bytes of recycled regions
+  size_t pad; // retain to keep mapped
+  size_t rels; // released bytes
+};
+
+// empty slab region : remove from its class and add to the sized list for reuse. hb locked. returns 1 on error
+static bool slab_recycle(heapdesc Unused *hd,heap *hb,region *reg)
 {
-  region *reg,*startreg,*xreg,*nxreg,*nreg,*preg,**clasregs;
+  region Unused *xreg;
+  region *preg,**clasregs;
+  ub8 Unused uid = reg->uid;
+  ub4 order = reg->order;
+  ub4 clas,claspos,claseq;
+  Ub8 clasmsk,msk;
+  size_t used;
+
+  setregion(hb,(xregion *)reg,reg->user,reg->len,0,Lfree,Fln);
+
+  used = (size_t)reg->inipos * reg->cellen;
+#if Yal_trim_decommit
+  if (reg->dirty > used + Pagesize && reg->len >= Decommit_min && reg->huge == 0) { // tail from previous use
+    if (osdecom(hb,reg->user + used,doalign8(reg->dirty,Pagesize) - used)) reg->dirty = doalign8(used,Pagesize);
+  }
+#endif
+  reg->dirty = max(reg->dirty,used);
+
+  ycheck(1,0,reg->inuse == 0,"region %.01llu not in use",reg->uid)
+  reg->inuse = 0;
+
+  // add to sized list
+  ycheck(1,Lnone,order > Regorder,"region %.01llu order %u",uid,order)
+  preg = hb->freeregs[order];
+  hb->freeregs[order] = reg;
+  reg->frenxt = preg;
+  reg->freprv = nil;
+  if (preg) preg->freprv = reg;
+
+  // remove from class list
+  clas = reg->clas;
+  claspos = reg->claspos;
+  clasregs = hb->clasregs + clas * Clasregs;
+  xreg = clasregs[claspos];
+  ycheck(1,Lnone,xreg != reg,"empty region %.01llu vs %u clas %u pos %u",uid,xreg ? xreg->id : 0,clas,claspos)
+  clasregs[claspos] = nil;
+  clasmsk = hb->clasinf[clas].msk;
+  msk = 1ul << claspos;
+  clasmsk &= ~msk;
+  if (claspos == hb->clasinf[clas].pos) { // active ?
+    claspos = clasmsk ? ctzl(clasmsk) : 0;
+    ycheck(1,0,claspos >= Clasregs,"reg %u clas %u pos %u",xreg->id,clas,claspos)
+    hb->clasinf[clas].pos = (ub2)claspos;
+  }
+  ydbg3(Lnone,"reg %.01lu clas %u pos %u msk %lx",uid,clas,claspos,clasmsk);
+  hb->clasinf[clas].msk = clasmsk;
+  hb->clasinf[clas].fremsk |= msk;
+  claseq = hb->clasinf[clas].regcnt;
+  if (claseq) hb->clasinf[clas].regcnt = (ub2)(claseq - 1);
+  hb->clasinf[clas].smal = nil;
+  hb->stat.trimregions[1]++;
+  reg->aged = 1;
+#if Yal_clas_adapt
+  clas_demote(hd,hb,clas);
+#endif
+  return 0;
+}
+
+/* Mark empty regions for reuse, and free after a certain 'time'
+   If tc is set, age at effort pace and release while retained mem exceeds pad
+   returns lock state
+ */
+static bool free_trim_(heapdesc *hd,heap *hb,ub4 tick,struct trimctl *tc)
+{
+  region *reg,*startreg,*nxreg,*nreg,*preg;
   mpregion *mreg,*mpstartreg,*mpnxreg,*nmreg,*pmreg;
   ub4 hid;
   ub4 rid;
-  ub8 uid;
+  ub8 Unused uid;
   ub4 order;
-  ub4 claspos,claseq;
-  ub4 clas;
   bool isempty,small;
   ub4 age,aged,lim;
   ub4 set;
-  Ub8 clasmsk,msk;
   ub4 iter,rbpos=0,i;
   yalstats *sp = &hb->stat;
   ub4 curregs;
   ub4 from;
-  ub4 ref;
+  ub4 Unused ref;
   bool didcas;
-  size_t base;
-  size_t bases[Trim_scan+1];
-  ub4 *metas[Trim_scan+1];
-  size_t lens[Trim_scan+1];
-  size_t metalens[Trim_scan+1];
+  size_t base,decom = hb->stat.decombytes;
+  // slab and mmap region scans each add up to Trim_scan
+  size_t bases[Trim_scan * 2 + 1];
+  ub4 *metas[Trim_scan * 2 + 1];
+  size_t lens[Trim_scan * 2 + 1];
+  size_t metalens[Trim_scan * 2 + 1];
   ub4 *ages;
   static ub4 effort_ages[] = { 2,3,4 };
   enum Tidstate tidstate = hd->tidstate;
@@ -127,7 +198,7 @@ static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
   hid = hb->id;
 
   // trim empty regions 'periodically'
-  if (sometimes(tick,0xffff)) ages = effort_ages;
+  if (tc || sometimes(tick,0xffff) || mem_soft()) ages = effort_ages;
   else ages = Trim_ages;
 
   openregs(hb)
@@ -180,62 +251,39 @@ static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
         continue;
       }
 
-      setregion(hb,(xregion *)reg,reg->user,reg->len,0,Lfree,Fln);
-
-      ycheck(1,0,reg->inuse == 0,"region %.01llu not in use",reg->uid)
-      reg->inuse = 0;
-
-      // add to sized list
-      ycheck(1,Lnone,order > Regorder,"region %u order %u",rid,order)
-      preg = hb->freeregs[order];
-      hb->freeregs[order] = reg;
-      reg->frenxt = preg;
-      reg->freprv = nil;
-      if (preg) preg->freprv = reg;
-
-      // remove from class list
-      clas = reg->clas;
-      claspos = reg->claspos;
-      clasregs = hb->clasregs + clas * Clasregs;
-      xreg = clasregs[claspos];
-      ycheck(1,Lnone,xreg != reg,"empty region %.01llu vs %u clas %u pos %u",uid,xreg ? xreg->id : 0,clas,claspos)
-      clasregs[claspos] = nil;
-      clasmsk = hb->clasmsk[clas];
-      msk = 1ul << claspos;
-      clasmsk &= ~msk;
-      if (claspos == hb->claspos[clas]) { // active ?
-        claspos = clasmsk ? ctzl(clasmsk) : 0;
-       ycheck(1,0,claspos >= Clasregs,"reg %u clas %u pos %u",xreg->id,clas,claspos)
-        hb->claspos[clas] = (ub2)claspos;
-      }
-      ydbg3(Lnone,"reg %.01lu clas %u pos %u msk %lx",uid,clas,claspos,clasmsk);
-      hb->clasmsk[clas] = clasmsk;
-      hb->cfremsk[clas] |= msk;
-      claseq = hb->clasregcnt[clas];
-      if (claseq) hb->clasregcnt[clas] = (ub2)(claseq - 1);
-      hb->smalclas[clas] = nil;
-      hb->stat.trimregions[1]++;
-      reg->aged = 1;
+      if (tc) tc->retain += reg->len;
+      if (slab_recycle(hd,hb,reg)) return 1;
     }
 
-    if (age >= ages[1] && aged == 1) { // todo
+    if (age >= ages[1] && aged == 1 && (tc == nil || Yal_trim_decommit == 0 || tc->retain > tc->pad)) { // release pages, keep mapped and listed for reuse
+#if Yal_trim_decommit
+      if (tc) tc->retain -= min(tc->retain,reg->len);
+      if (reg->dirty) {
+        if (osdecom(hb,reg->user,reg->huge ? reg->len : min(doalign8(reg->dirty,Pagesize),reg->len))) reg->dirty = 0;
+      }
+#endif
       hb->stat.trimregions[2]++;
       reg->aged = 2;
     }
 
     lim = ages[2];
     small = (reg->len <= 0x10000 && reg->metalen <= 0x8000);
-    if (small) lim *= 4;
+    if (small && tc == nil) lim *= 4;
     curregs = (ub4)(sp->useregions + sp->noregions);
     if (sometimes(curregs,Region_interval)) sp->curnoregions = 0;
-    if (sp->curnoregions > Region_alloc) lim = 1024; // reduce trim if too much redo happens
-    if (age >= lim && aged == 2) { // trim : delete user and meta
+    if (sp->curnoregions > Region_alloc && tc == nil) lim = 1024; // reduce trim if too much redo happens
+    if (age >= lim && aged == 2 && Yal_trim_decommit < 2 && (tc == nil || Yal_trim_decommit || tc->retain > tc->pad)) { // trim : delete user and meta
     isempty = (reg->binpos == reg->inipos);
     ycheck(1,Lnone,isempty == 0,"region %.01llu age %u.%u not  empty bin %u ini %u",uid,age,reg->aged,reg->binpos,reg->inipos)
 
-      if (sp->noregions > Region_alloc) { // avoid too frequent trim-alloc cycles
+      if (sp->noregions > Region_alloc && tc == nil) { // avoid too frequent trim-alloc cycles
         break;
       }
+      if (tc && Yal_trim_decommit) tc->rels += reg->metalen; // user pages were returned at decommit
+      else if (tc) {
+        tc->retain -= min(tc->retain,reg->len);
+        tc->rels += reg->len + reg->metalen;
+      }
       ydbg2(Fln,Lfree,"trim slab region %.01llu gen %u.%u.%u len %zu",uid,reg->gen,hid,rid,reg->len);
       ycheck(1,Lnone,reg->aged < 2,"region %.01llu age %u not  recycling %u",uid,age,reg->aged)
 
@@ -285,7 +333,7 @@ static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
             1 - just freed
   */
 
-  if (sometimes(tick,0xffff)) ages = effort_ages;
+  if (tc || sometimes(tick,0xffff) || mem_soft()) ages = effort_ages;
   else ages = Trim_Ages;
 
   mreg = mpstartreg = hb->mpregtrim;
@@ -335,17 +383,26 @@ static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
       mreg->frenxt = pmreg;
       mreg->freprv = nil;
       if (pmreg) pmreg->freprv = mreg;
+      hb->mpcachelen += mreg->len;
 
+      if (tc) tc->retain += mreg->len;
       hb->stat.trimregions[5]++;
       mreg->aged = 1;
+      if (hb->mpcachelen > Mmap_cachelimit) { aged = 2; age = ages[2]; } // over budget: release below
     }
 
-    if (aged == 1 && age >= ages[1]) { // todo
+    if (aged == 1 && age >= ages[1]) { // release pages, keep mapped and listed for reuse
+#if Yal_trim_decommit && Yal_decommit_zero
+      if (mreg->clr && osdecom(hb,base,mreg->len)) {
+        if (tc) tc->retain -= min(tc->retain,mreg->len);
+        mreg->clr = 0; // known zero for calloc()
+      }
+#endif
       hb->stat.trimregions[6]++;
       mreg->aged = 2;
     }
 
-    if (aged == 2 && age >= ages[2]) { // trim
+    if (aged == 2 && age >= ages[2] && (tc == nil || tc->retain > tc->pad)) { // trim
       ydbg1(Fln,Lfree,"trim mmap region %u.%u ord %u",hid,rid,order);
       from = 2;
       didcas = Cas(mreg->set,from,0);
@@ -357,9 +414,15 @@ static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
       bases[rbpos] = base;
       metas[rbpos] = nil;
       lens[rbpos] = mreg->len;
-      metalens[rbpos++] = 0;
+      metalens[rbpos++] = mreg->rsvlen; // reserved tail, not counted as mapped
+      mreg->rsvlen = 0;
       hb->stat.delmpregions++;
+      if (tc && mreg->clr) { // else pages were returned at decommit
+        tc->retain -= min(tc->retain,mreg->len);
+        tc->rels += mreg->len;
+      }
       mreg->prvlen = mreg->len;
+      hb->mpcachelen -= min(hb->mpcachelen,mreg->len);
       mreg->len = 0;
 
       // move from sized to zerosized list
@@ -390,6 +453,8 @@ static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
 
   hb->mpregtrim = mreg ? mreg : hb->mpreglst;
 
+  if (tc) tc->rels += hb->stat.decombytes - decom;
+
   // actual munmap is unlocked
   if (tidstate != Ts_private) {
     Atomset(hb->lock,0,Morel);
@@ -400,12 +465,99 @@ static bool free_trim(heapdesc *hd,heap *hb,ub4 tick)
   for (i = 0; i < rbpos; i++) {
     if (lens[i]) osunmem(Fln,hd,(void *)bases[i],lens[i],"trim");
     //coverity[uninit_use_in_call]
-    if (metalens[i]) osunmem(Fln,hd,metas[i],metalens[i],"trim");
+    if (metalens[i] == 0) continue;
+    if (metas[i]) osunmem(Fln,hd,metas[i],metalens[i],"trim");
+    else osmunmap((void *)(bases[i] + lens[i]),metalens[i]);
   }
 
   return rv;
 }
 
+static inline bool free_trim(heapdesc *hd,heap *hb,ub4 tick,struct trimctl *tc)
+{
+  Latstart
+  bool locked = free_trim_(hd,hb,tick,tc);
+  Latend(hd->stat,Yal_lat_trim) // heap may be unlocked
+  return locked;
+}
+
+#if Yal_enable_memlimit
+// at the hard limit, unmap empty regions until len fits. As trim does, without waiting for ageing. heap locked, see mem_drop()
+static void mem_drop_(heap *hb,size_t len)
+{
+  heapdesc *hd = getheapdesc(Lnone);
+  region *reg,*nreg,*preg;
+  mpregion *mreg,*nmreg,*pmreg;
+  ub4 order,from;
+  bool didcas;
+
+  // cached mmap regions, largest first
+  for (order = Vmbits; order && mem_room(len) == 0; order--) {
+    mreg = hb->freempregs[order];
+    while (mreg && mem_room(len) == 0) {
+      nmreg = mreg->frenxt;
+      from = 2;
+      didcas = Cas(mreg->set,from,0);
+      if (didcas == 0) { error(Lnone,"mmap region %u.%u set %u",hb->id,mreg->id,from) return; }
+      ydbg1(Fln,Lnone,"drop mmap region %u.%u len %zu` for %zu`",hb->id,mreg->id,mreg->len,len);
+
+      osunmem(Fln,hd,(void *)mreg->user,mreg->len,"memlimit");
+      if (mreg->rsvlen) osmunmap((void *)(mreg->user + mreg->len),mreg->rsvlen); // reserved tail, not counted as mapped
+      mreg->rsvlen = 0;
+      hb->stat.delmpregions++;
+      mreg->prvlen = mreg->len;
+      hb->mpcachelen -= min(hb->mpcachelen,mreg->len);
+      mreg->len = 0;
+
+      // move from sized to zerosized list
+      hb->freempregs[order] = nmreg;
+      if (nmreg) nmreg->freprv = nil;
+      pmreg = hb->freemp0regs;
+      hb->freemp0regs = mreg;
+      mreg->frenxt = pmreg;
+      mreg->freprv = nil;
+      if (pmreg) pmreg->freprv = mreg;
+      mreg->aged = 3;
+      mreg = nmreg;
+    }
+  }
+
+  // empty slab regions, also those not yet recycled by trim
+  openregs(hb)
+  for (reg = hb->reglst; reg; reg = reg->nxt) {
+    if (reg->aged || reg->age == 0 || reg->binpos != reg->inipos || Atomget(reg->remref,Moacq)) continue;
+    if (slab_recycle(hd,hb,reg)) break;
+  }
+  for (order = Regorder; order && mem_room(len) == 0; order--) {
+    reg = hb->freeregs[order];
+    while (reg && mem_room(len) == 0) {
+      nreg = reg->frenxt;
+      ydbg1(Fln,Lnone,"drop slab region %.01llu len %zu` for %zu`",reg->uid,reg->len,len);
+
+      osunmem(Fln,hd,(void *)reg->user,reg->len,"memlimit");
+      osunmem(Fln,hd,reg->meta,reg->metalen,"memlimit");
+      hb->stat.delregions++;
+      reg->prvlen = reg->len;
+      reg->prvmetalen = reg->metalen;
+      reg->len = reg->metalen = 0;
+      reg->user = 0;
+      reg->meta = nil;
+
+      hb->freeregs[order] = nreg;
+      if (nreg) nreg->freprv = nil;
+      preg = hb->freeregs[0];
+      hb->freeregs[0] = reg;
+      reg->frenxt = preg;
+      reg->freprv = nil;
+      if (preg) preg->freprv = reg;
+      reg->aged = 3;
+      reg = nreg;
+    }
+  }
+  closeregs(hb)
+}
+#endif
+
 /* First, find region. If not found, check remote heaps
    For slab, put in bin.
    For mmap, age or directly delete
@@ -429,10 +581,23 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
   enum Status rv;
   ub4 from;
   bool didcas,local;
+  heap *fhb; // heap to free into
+  bool owner = 0;
+  bool found = 0;
+  xregion *magreg = nil;
+
+#if Yal_enable_magazine
+  if (hd->magip == ip) { // looked up by mag_free()
+    found = 1;
+    magreg = hd->magreg;
+    hd->magip = 0;
+  }
+#endif
 
   // common: regular local heap
   if (likely(hb != nil)) {
-    reg = findregion(hb,ip,loc); // search page dir
+    if (magreg && magreg->hb == hb) reg = magreg;
+    else reg = findregion(hb,ip,loc); // search page dir
   } else {
     reg = nil;
   } // nil hb
@@ -477,7 +642,8 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
     // remote ?
     ydbg3(loc,"+free(%zx) from heap %u",ip,hd->id)
 
-    reg = findgregion(loc,ip); // locate ptr in global directory
+    if (found) reg = magreg;
+    else reg = findgregion(loc,ip); // locate ptr in global directory
 
     if (unlikely(reg == nil)) {
       hd->stat.invalid_frees++;
@@ -489,7 +655,15 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
 
     ytrace(1,hd,loc,tag,0,"free(%zx)",ip)
 
-    // try to acquire owner heap
+#if Yal_enable_pool
+    if (unlikely(reg->typ == Rslab && reg->hb && reg->hb->pool)) { // never local
+      len4 = pool_rfree(hd,(region *)reg,ip,tag,loc); // -V1027 PVS unrelated obj cast
+      return len4 ? len4 : Nolen;
+    }
+#endif
+
+    /* try to acquire owner heap. For slab, free into it and keep our own heap, else take it over
+       Only when busy, buffer as remote */
     local = 0;
     xhb = reg->hb;
     if (xhb && hd->tidstate != Ts_private) { // no mini
@@ -498,16 +672,24 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
       if (didcas) {
         vg_drd_wlock_acq(xhb)
         local = 1;
-        if (hb) {
+        if (hb && reg->typ == Rslab) {
           ycheck(Nolen,loc,hb == xhb,"hb %u equal for reg %u",hb->id,reg->id)
-          Atomset(hb->lock,0,Morel); // release orig
-          vg_drd_wlock_rel(hb)
+          owner = 1;
+          ystats(hd->stat.ownerfrees)
+        } else {
+          if (hb) {
+            ycheck(Nolen,loc,hb == xhb,"hb %u equal for reg %u",hb->id,reg->id)
+            Atomset(hb->lock,0,Morel); // release orig
+            vg_drd_wlock_rel(hb)
+          }
+          hd->hb = hb = xhb;
+          hd->locked = 1;
         }
-        hd->hb = hb = xhb;
-        hd->locked = 1;
+      } else if (reg->typ == Rslab) {
+        ystats(hd->stat.ownerbusy)
       } // lock owner or new
     }
-    if (local == 0 && hb == nil && reg->typ == Rslab) { // need to buffer
+    if (local == 0 && hb == nil && reg->typ == Rslab && Yal_remote_mpsc == 0) { // need to buffer
       hb = heap_new(hd,loc,Fln);
       if (hb == nil) return Nolen;
       hd->hb = hb;
@@ -522,7 +704,7 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
 
   typ = reg->typ;
   if (likely(reg->typ == Rslab)) {
-    ycheck(Nolen,loc,hb == nil,"nil hb for reg %u",reg->id)
+    ycheck(Nolen,loc,hb == nil && (local || Yal_remote_mpsc == 0),"nil hb for reg %u",reg->id)
     creg = (region *)reg; // -V1027 PVS unrelated obj cast
     vg_mem_def(creg,sizeof(region))
     vg_mem_def(creg->meta,creg->metalen)
@@ -530,23 +712,28 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
     cellen = creg->cellen;
     celcnt = creg->celcnt;
     if (likely(local != 0)) {
-      ycheck(Nolen,loc,hb != reg->hb,"hb %u vs %u for reg %u",hb->id,reg->hb->id,reg->id)
+      fhb = owner ? xhb : hb;
+      ycheck(Nolen,loc,fhb != reg->hb,"hb %u vs %u for reg %u",fhb->id,reg->hb->id,reg->id)
       ytrace(1,hd,loc,tag,creg->stat.frees,"ptr+%zx len %u",ip,cellen)
 
-      bincnt = slab_free(hb,creg,ip,cellen,celcnt,tag); // put in recycling bin
-      if (unlikely(bincnt == 0)) {
-        return Nolen; // error
-      }
+      bincnt = slab_free(fhb,creg,ip,cellen,celcnt,tag); // put in recycling bin
 
       if (unlikely(bincnt == 1) && creg->inipos == celcnt) { // was probably full
         clas = creg->clas;
         claspos = creg->claspos;
         ycheck(Nolen,loc,claspos >= 32,"reg %u clas %u pos %u",creg->id,clas,claspos)
-        clasmsk = hb->clasmsk[clas];
+        clasmsk = fhb->clasinf[clas].msk;
         clasmsk |= (1ul << claspos); // re-include in alloc candidate list
         ydbg3(loc,"reg %.01lu clas %u pos %u msk %lx",creg->uid,clas,claspos,clasmsk);
-        hb->clasmsk[clas] = clasmsk;
-        hb->claspos[clas] = (ub2)claspos;
+        fhb->clasinf[clas].msk = clasmsk;
+        fhb->clasinf[clas].pos = (ub2)claspos;
+      }
+      if (owner) {
+        Atomset(xhb->lock,0,Morel);
+        vg_drd_wlock_rel(xhb)
+      }
+      if (unlikely(bincnt == 0)) {
+        return Nolen; // error
       }
       vg_mem_noaccess(creg->meta,creg->metalen)
       vg_mem_noaccess(creg,sizeof(region))
@@ -569,6 +756,10 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
       return Nolen;
   } // slab
 
+#if Yal_enable_arena
+  if (unlikely(typ == Rarena)) return arena_free(hd,(aregion *)reg,ip,loc,tag); // -V1027 PVS unrelated obj cast
+#endif
+
   // mini or bump
   if (unlikely(typ == Rbump || typ == Rmini)) {
     ytrace(1,hd,loc,tag,0,"ptr+%zx",ip)
@@ -601,17 +792,131 @@ static Hot size_t free_heap(heapdesc *hd,heap *hb,void *p,size_t reqlen,enum Loc
   return Nolen;
 } // free_heap
 
+#if Yal_enable_memlimit
+// new pressure round: return cached and buffered cells, for trim to find empty regions. heap locked
+static Cold void mem_relieve(heapdesc Unused *hd,heap *hb,enum Loc loc)
+{
+  ub4 iter = 4;
+
+  hb->pressure = Atomget(global_pressure,Monone);
+
+#if Yal_enable_magazine
+  mag_return(hd,hb,hd->mag);
+#endif
+  while (hb->remask && hb->stat.xfreebuf != hb->stat.xfreebatch && iter--) slab_unbuffer(hb,loc,0);
+  hb->stat.memrelieves++;
+}
+#endif
+
+// unbuffer and trim after regfree_interval frees. hb locked, unlocked unless private
+static void free_tick(heapdesc *hd,heap *hb,size_t frees,enum Loc loc)
+{
+  size_t bufs,batch,left;
+  ub4 from;
+  bool locked;
+  ub4 iter;
+  enum Tidstate tidstate = hd->tidstate;
+
+  from = Atomget(hb->lock,Moacq);
+  if (unlikely(from != 1)) { error(loc,"heap %u unlock %u",hb->id,from) return; }
+
+  hb->trimcnt++;
+
+#if Yal_enable_memlimit
+  if (unlikely(hb->pressure != Atomget(global_pressure,Monone))) mem_relieve(hd,hb,loc);
+#endif
+
+  if (bg_recent(hb)) { // left to the background thread
+    if (tidstate != Ts_private) {
+      Atomset(hb->lock,0,Morel);
+      vg_drd_wlock_rel(hb)
+    } else priv_leave(hb)
+    return;
+  }
+
+  bufs = hb->stat.xfreebuf;
+  batch = hb->stat.xfreebatch;
+
+  if (bufs - batch > Buffer_flush) {
+    iter = 1;
+    do {
+      left = slab_unbuffer(hb,loc,(ub4)frees);
+    } while (left > Buffer_flush && --iter);
+    ywarn(loc,left > (1ul << 18),"heap %u unbuffer left %zu from %zu - %zu",hb->id,left,bufs,batch)
+  }
+
+  locked = free_trim(hd,hb,(ub4)frees,nil); // normally unlocks
+  ydbg2(Fln,loc,"heap %u lock %u",hb->id,locked)
+  if (tidstate == Ts_private) {
+    priv_leave(hb)
+    return;
+  }
+  if (likely(locked == 0)) return;
+
+  Atomset(hb->lock,0,Morel);
+  vg_drd_wlock_rel(hb)
+  ydbg2(Fln,loc,"unlock heap %u",hb->id)
+}
+
+#if Yal_thread_exit
+/* thread exit: return cached cells, flush buffered remote frees, release private state and offer the heap to new threads
+   Later calls from this thread get a new descriptor
+ */
+static void thread_cleaner(void *arg)
+{
+  heapdesc *prv,*hd = (heapdesc *)arg;
+  heap *hb = hd->hb;
+  ub4 from,iter;
+  bool didcas;
+
+  tid_sethd(nil);
+
+  if (hb) {
+    didcas = 1;
+    if (hd->tidstate != Ts_private) {
+      iter = 1000;
+      do {
+        from = 0; didcas = Cas(hb->lock,from,1);
+        if (didcas) break;
+        Pause
+      } while (--iter);
+    } else priv_enter(hb)
+    if (didcas) {
+      vg_drd_wlock_acq(hb)
+#if Yal_enable_magazine
+      mag_return(hd,hb,hd->mag);
+#endif
+      iter = 4;
+      while (hb->remask && hb->stat.xfreebuf != hb->stat.xfreebatch && iter--) slab_unbuffer(hb,Lfree,0);
+      hb->stat.handovers++;
+      priv_leave(hb)
+      Atomset(hb->lock,0,Morel);
+      vg_drd_wlock_rel(hb)
+      if (Yal_percpu == 0) heap_idle(hb);
+    }
+    // else busy : left as is, reassigned via global_heaps
+  }
+  hd->tidstate = Ts_mt;
+  hd->hb = nil;
+
+  iter = 20;
+  do {
+    prv = Atomget(global_freehds,Moacq);
+    hd->frenxt = prv;
+    didcas = Cas(global_freehds,prv,hd);
+  } while (didcas == 0 && --iter);
+}
+#endif
+
 // lock heap if present. nil ptr handled
-static Hot size_t yfree_heap(heapdesc *hd,void *p,size_t reqlen,enum Loc loc,ub4 tag)
+static Hot size_t yfree_heap_(heapdesc *hd,void *p,size_t reqlen,enum Loc loc,ub4 tag)
 {
   size_t retlen;
-  size_t bufs,batch,left;
   heap *hb = hd->hb;
   ub4 from;
   bool didcas = 0;
-  bool totrim,locked;
+  bool totrim;
   size_t frees;
-  ub4 iter;
   enum Tidstate tidstate = hd->tidstate;
 
   // common: regular local heap
@@ -635,6 +940,7 @@ static Hot size_t yfree_heap(heapdesc *hd,void *p,size_t reqlen,enum Loc loc,ub4
       from = Atomget(hb->lock,Moacq);
       ycheck(Nolen,loc,from != 1,"heap %u unlock %u",hb->id,from)
 #endif
+      priv_enter(hb)
     }
   } // nil hb
   hd->locked = didcas;
@@ -664,34 +970,47 @@ static Hot size_t yfree_heap(heapdesc *hd,void *p,size_t reqlen,enum Loc loc,ub4
       Atomset(hb->lock,0,Morel);
       ydbg2(Fln,loc,"unlock heap %u",hb->id)
       vg_drd_wlock_rel(hb)
-    }
+    } else priv_leave(hb)
     return retlen;
   }
 
-  from = Atomget(hb->lock,Moacq);
-  ycheck(Nolen,loc,from != 1,"heap %u unlock %u",hb->id,from)
-
-  bufs = hb->stat.xfreebuf;
-  batch = hb->stat.xfreebatch;
-
-  if (bufs - batch > Buffer_flush) {
-    iter = 1;
-    do {
-      left = slab_unbuffer(hb,loc,(ub4)frees);
-    } while (left > Buffer_flush && --iter);
-    ywarn(loc,left > (1ul << 18),"heap %u unbuffer left %zu from %zu - %zu",hb->id,left,bufs,batch)
-  }
+  free_tick(hd,hb,frees,loc);
+  export_tick();
+  mem_tick();
+  bg_tick(hd);
+  return retlen;
+}
 
-  locked = free_trim(hd,hb,(ub4)frees); // normally unlocks
-  ydbg2(Fln,loc,"heap %u lock %u",hb->id,locked)
-  if (likely(locked == 0 || tidstate == Ts_private)) return retlen;
+static Hot size_t yfree_heap(heapdesc *hd,void *p,size_t reqlen,enum Loc loc,ub4 tag)
+{
+  Latstart
+  size_t len = yfree_heap_(hd,p,reqlen,loc,tag);
+  Latend(hd->stat,Yal_lat_free)
+  return len;
+}
 
-  Atomset(hb->lock,0,Morel);
-  vg_drd_wlock_rel(hb)
-  ydbg2(Fln,loc,"unlock heap %u",hb->id)
+#if Yal_enable_magazine
+// magazine frees bypass the heap's free count. Run its tick as free does, every regfree_interval of them
+static void mag_tick(heapdesc *hd,struct magazine *mg)
+{
+  heap *hb = mg->hb;
+  ub4 frees = mg->frees++;
+  ub4 from;
+  bool didcas;
 
-  return retlen;
+  if (likely(sometimes(frees,regfree_interval) == 0)) return;
+
+  if (hd->tidstate == Ts_mt) {
+    from = 0; didcas = Cas(hb->lock,from,1);
+    if (didcas == 0) { mg->frees--; return; } // retry at next
+    vg_drd_wlock_acq(hb)
+  } else priv_enter(hb)
+  free_tick(hd,hb,hb->stat.frees + frees,Lfree); // unlocks
+  export_tick();
+  mem_tick();
+  bg_tick(hd);
 }
+#endif
 
 // main entry
 static Hot inline void yfree(void *p,size_t len,ub4 tag)
@@ -702,9 +1021,347 @@ static Hot inline void yfree(void *p,size_t len,ub4 tag)
     ystats(hd->stat.freenils)
     return;
   }
+  ystats(hd->stat.apifrees)
+  hist_free(hd,p);
+  prof_free(p);
+#if Yal_enable_magazine
+  struct magazine *mg = hd->mag;
+
+  if (likely(mg != nil) && mag_free(hd,mg,p,tag)) {
+    mag_tick(hd,mg);
+    return;
+  }
+#endif
   ypush(hd,Lfree | Lapi,Fln)
   yfree_heap(hd,p,len,Lfree,tag);
   ypush(hd,Lfree | Lapi,Fln)
 }
 
+/* sized free: locate slab via the regions of the size class, or the next one for realloc headroom.
+   hb is locked. returns 0 if not found
+ */
+static Hot bool free_clas(heapdesc Unused *hd,heap *hb,size_t ip,ub4 len,ub4 tag)
+{
+  region *reg,**clasregs;
+  Ub8 msk;
+  ub4 clas,pos,bincnt,claspos;
+  ub4 iter = 2;
+
+  clas = len2clas[len];
+
+  do {
+    reg = hb->clasinf[clas].smal; // most likely
+    if (reg && (ip < reg->user || ip >= reg->user + reg->len)) reg = nil;
+
+    if (reg == nil) {
+      clasregs = hb->clasregs + clas * Clasregs;
+      msk = ~hb->clasinf[clas].fremsk & Hi32; // used slots
+      while (msk) {
+        pos = ctzl(msk);
+        msk &= ~(1ul << pos);
+        reg = clasregs[pos];
+        if (reg && ip >= reg->user && ip < reg->user + reg->len) break;
+        reg = nil;
+      }
+    }
+    if (reg) break;
+  } while (--iter && ++clas < Clascnt);
+
+  if (reg == nil) return 0;
+
+  ycheck(0,Lfree,reg->hb != hb,"region %.01llu heap %u vs %u",reg->uid,reg->hb->id,hb->id)
+  vg_mem_def(reg,sizeof(region))
+  vg_mem_def(reg->meta,reg->metalen)
+
+#if Yal_enable_check
+  ub4 cellen = reg->cellen,cel = (ub4)((ip - reg->user) / cellen);
+  ub4 ulen = (cellen > Cel_nolen && cel < reg->celcnt) ? slab_getlen(reg,cel,cellen) : cellen;
+
+  if (unlikely(len > ulen)) do_ylog(Diagcode,Lfree,Fln,Warn,1,"free_sized(%zx) block in heap %u had size %u, not %u",ip,hb->id,ulen,len);
+#endif
+
+  ytrace(1,hd,Lfree,tag,reg->stat.frees,"ptr+%zx len %u sized",ip,reg->cellen)
+  bincnt = slab_free(hb,reg,ip,reg->cellen,reg->celcnt,tag);
+  if (unlikely(bincnt == 0)) return 1; // reported in slab_free()
+  if (unlikely(bincnt == 1) && reg->inipos == reg->celcnt) { // was full, re-include in alloc candidate list
+    claspos = reg->claspos;
+    hb->clasinf[clas].msk |= (1ul << claspos);
+    hb->clasinf[clas].pos = (ub2)claspos;
+  }
+  vg_mem_noaccess(reg->meta,reg->metalen)
+  vg_mem_noaccess(reg,sizeof(region))
+  return 1;
+}
+
+// free with size given, as for free_sized() and c++ sized delete
+static Hot void yfree_sized(void *p,size_t len,ub4 tag)
+{
+  heapdesc *hd;
+  heap *hb;
+  size_t frees;
+  ub4 from;
+  bool didcas,rv;
+  enum Tidstate tidstate;
+
+  if (unlikely(len == 0 || len >= Smalclas || p == nil)) {
+    yfree(p,len,tag);
+    return;
+  }
+
+  hd = getheapdesc(Lfree);
+  hb = hd->hb;
+  ystats(hd->stat.apifrees)
+  hist_free(hd,p);
+  prof_free(p);
+
+#if Yal_enable_magazine
+  struct magazine *mg = hd->mag;
+
+  if (len < Magazine_len && mg != nil) {
+    if (mag_free(hd,mg,p,tag)) {
+      mag_tick(hd,mg);
+      return;
+    }
+    hd->magip = 0; // free_clas() below does not take the lookup
+  }
+#endif
+
+  if (unlikely(hb == nil)) {
+    yfree_heap(hd,p,len,Lfree,tag);
+    return;
+  }
+
+  tidstate = hd->tidstate;
+  if (tidstate == Ts_mt) {
+    from = 0; didcas = Cas(hb->lock,from,1);
+    if (unlikely(didcas == 0)) {
+      yfree_heap(hd,p,len,Lfree,tag);
+      return;
+    }
+    vg_drd_wlock_acq(hb)
+  } else priv_enter(hb)
+
+  ypush(hd,Lfree | Lapi,Fln)
+  rv = free_clas(hd,hb,(size_t)p,(ub4)len,tag);
+
+  if (unlikely(rv == 0)) { // miss: directory
+    hd->locked = 1;
+    free_heap(hd,hb,p,len,Lfree,Fln,tag);
+    hb = hd->hb; // may have changed
+  }
+
+  frees = hb->stat.frees;
+  hb->stat.frees = frees + 1;
+
+  if (unlikely(sometimes((ub4)frees,regfree_interval))) {
+    free_tick(hd,hb,frees,Lfree);
+    export_tick();
+    mem_tick();
+    bg_tick(hd);
+  } else if (tidstate != Ts_private) {
+    Atomset(hb->lock,0,Morel);
+    vg_drd_wlock_rel(hb)
+  } else priv_leave(hb)
+  ypush(hd,Lfree | Lapi,Fln)
+}
+
+/* free cnt blocks. Lock heap once and lookup region once per run of blocks within the same local slab.
+   Others are freed as single */
+static void yfree_batch(void **ptrs,size_t cnt,ub4 tag)
+{
+  heapdesc *hd = getheapdesc(Lfree);
+  heap *hb = hd->hb;
+  xregion *xreg;
+  region *reg = nil;
+  void *p;
+  size_t ip,lo = 0,hi = 0;
+  size_t i,n = 0,frees;
+  ub4 bincnt,clas,claspos;
+  ub4 from;
+  bool didcas;
+  enum Tidstate tidstate = hd->tidstate;
+
+  ypush(hd,Lfree | Lapi,Fln)
+
+  if (unlikely(hb == nil)) didcas = 0;
+  else if (tidstate == Ts_mt) {
+    from = 0; didcas = Cas(hb->lock,from,1);
+  } else {
+    didcas = 1;
+    priv_enter(hb)
+  }
+
+  if (unlikely(didcas == 0)) { // as single
+    for (i = 0; i < cnt; i++) yfree(ptrs[i],0,tag);
+    return;
+  }
+  vg_drd_wlock_acq(hb)
+  hd->locked = 1;
+
+  ytrace(0,hd,Lfree,tag,0,"+ free_batch(%zu)",cnt)
+
+  for (i = 0; i < cnt; i++) {
+    p = ptrs[i];
+    if (unlikely(p == nil)) {
+      ystats(hd->stat.freenils)
+      continue;
+    }
+    hist_free(hd,p);
+    prof_free(p);
+    ip = (size_t)p;
+
+    if (ip < lo || ip >= hi) { // next run
+      if (reg) {
+        vg_mem_noaccess(reg->meta,reg->metalen)
+        vg_mem_noaccess(reg,sizeof(region))
+      }
+      reg = nil;
+      xreg = findregion(hb,ip,Lfree);
+      if (likely(xreg != nil && xreg->typ == Rslab)) {
+        reg = (region *)xreg; // -V1027 PVS unrelated obj cast
+        vg_mem_def(reg,sizeof(region))
+        vg_mem_def(reg->meta,reg->metalen)
+        lo = reg->user;
+        hi = lo + (size_t)reg->celcnt * reg->cellen;
+      } else lo = hi = 0;
+    }
+
+    if (unlikely(reg == nil)) { // not in a local slab
+      free_heap(hd,hb,p,0,Lfree,Fln,tag);
+      hb = hd->hb; // may have changed
+      n++;
+      continue;
+    }
+
+    ytrace(1,hd,Lfree,tag,reg->stat.frees,"ptr+%zx len %u",ip,reg->cellen)
+    bincnt = slab_free(hb,reg,ip,reg->cellen,reg->celcnt,tag);
+    if (unlikely(bincnt == 0)) continue; // reported in slab_free()
+    if (unlikely(bincnt == 1) && reg->inipos == reg->celcnt) { // was full, re-include in alloc candidate list
+      clas = reg->clas;
+      claspos = reg->claspos;
+      hb->clasinf[clas].msk |= (1ul << claspos);
+      hb->clasinf[clas].pos = (ub2)claspos;
+    }
+    n++;
+  }
+  if (reg) {
+    vg_mem_noaccess(reg->meta,reg->metalen)
+    vg_mem_noaccess(reg,sizeof(region))
+  }
+
+  frees = hb->stat.frees;
+  hb->stat.frees = frees + n;
+
+  if (unlikely( (frees & ~(size_t)regfree_interval) != ((frees + n) & ~(size_t)regfree_interval) )) {
+    free_tick(hd,hb,frees + n,Lfree);
+    mem_tick();
+    bg_tick(hd);
+  } else if (tidstate != Ts_private) {
+    Atomset(hb->lock,0,Morel);
+    vg_drd_wlock_rel(hb)
+  } else priv_leave(hb)
+  ypush(hd,Lfree | Lapi,Fln)
+}
+
+// explicit trim of a heap if lockable. Release empty regions beyond pad, at effort ageing rounds. returns bytes released
+static size_t trim_heap(heapdesc *hd,heap *hb,ub4 effort,size_t pad)
+{
+  struct trimctl tc;
+  region *reg;
+  mpregion *mreg;
+  ub4 order,regcnt = 0,mpregcnt = 0;
+  ub4 pass,passes = 0;
+  ub4 from;
+  bool didcas,locked;
+  bool own = (hb == hd->hb && hd->tidstate == Ts_private);
+
+  if (own == 0) {
+    from = 0; didcas = Cas(hb->lock,from,1);
+    if (didcas == 0) return 0; // busy or private to another thread
+    vg_drd_wlock_acq(hb)
+  } else priv_enter(hb)
+  if (hb->pool) { // regions owned by pool
+    if (own == 0) { Atomset(hb->lock,0,Morel); vg_drd_wlock_rel(hb) }
+    else priv_leave(hb)
+    return 0;
+  }
+
+  tc.retain = tc.rels = 0;
+  tc.pad = pad;
+
+  for (order = 1; order <= Regorder; order++) {
+    for (reg = hb->freeregs[order]; reg; reg = reg->frenxt) {
+      if (reg->aged == 1 || Yal_trim_decommit == 0) tc.retain += reg->len; // not yet decommitted
+    }
+  }
+  for (order = 0; order <= Vmbits; order++) {
+    for (mreg = hb->freempregs[order]; mreg; mreg = mreg->frenxt) tc.retain += mreg->len;
+  }
+  for (reg = hb->reglst; reg; reg = reg->nxt) regcnt++;
+  for (mreg = hb->mpreglst; mreg; mreg = mreg->nxt) mpregcnt++;
+
+#if Yal_trim_decommit
+  bregion *breg;
+  size_t end,decom = hb->stat.decombytes;
+  ub4 r,frees;
+
+  // bump regions are not recycled. Return pages below pos if all blocks are freed
+  for (r = 0; r < Bumpregions; r++) {
+    breg = hb->bumpregs + r;
+    if (breg->user == 0 || breg->allocs == 0) continue; // allocs are counted with full stats only
+    frees = Atomget(breg->frees,Moacq);
+    if (frees != breg->allocs) continue;
+    end = breg->pos & ~Pagesize1;
+    if (end <= breg->trimpos) continue;
+    osdecom(hb,breg->user + breg->trimpos,end - breg->trimpos);
+    breg->trimpos = (ub4)end;
+  }
+  tc.rels += hb->stat.decombytes - decom;
+#endif
+
+#if Trim_scan
+  passes = effort * ((max(regcnt,mpregcnt) + Trim_scan - 1) / Trim_scan);
+#endif
+  ydbg2(Fln,Lfree,"trim heap %u regions %u,%u retain %zu` passes %u",hb->id,regcnt,mpregcnt,tc.retain,passes)
+
+  for (pass = 0; pass < passes; pass++) {
+    locked = free_trim(hd,hb,0,&tc); // normally unlocks
+    if (own) continue;
+    if (locked) {
+      Atomset(hb->lock,0,Morel);
+      vg_drd_wlock_rel(hb)
+    }
+    if (pass + 1 == passes) return tc.rels;
+    from = 0; didcas = Cas(hb->lock,from,1);
+    if (didcas == 0) return tc.rels;
+    vg_drd_wlock_acq(hb)
+  }
+
+  if (own == 0) {
+    Atomset(hb->lock,0,Morel);
+    vg_drd_wlock_rel(hb)
+  } else priv_leave(hb)
+  return tc.rels;
+}
+
+// trim all heaps or heap hid. returns bytes released
+static size_t ytrim(ub4 hid,ub4 effort,size_t pad,ub4 Unused tag)
+{
+  heapdesc *hd = getheapdesc(Lfree);
+  heap *hb;
+  size_t rels = 0;
+  ub4 iter = 1000;
+
+  ytrace(0,hd,Lfree,tag,0,"+ trim(%u,%u,%zu)",hid,effort,pad)
+
+  hb = Atomget(global_heaps,Moacq);
+  while (hb && --iter) {
+    if (hid == 0 || hb->id == hid) rels += trim_heap(hd,hb,effort,pad);
+    hb = hb->nxt;
+  }
+
+  ytrace(0,hd,Lfree,tag,0,"- trim(%u) = %zu`",hid,rels)
+  return rels;
+}
+
 #undef Logfile
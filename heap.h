@@ -15,6 +15,8 @@
 static void heap_init(heap *hb)
 {
   static_assert(Clascnt < 65536,"Clascnt < 64K");
+  static_assert(Class_waste <= Class_waste_base,"profile classes add internal waste");
+  static_assert(Tabclas == 64 || Tabclas == Smalclas,"Tabclas");
   static_assert(Page + Dir1 + Dir2 + Dir3 == Vmbits,"VM size not covered by dir");
   static_assert( (Rmeminc & (Rmeminc - 1)) == 0,"Rmeminc not power of two");
 
@@ -64,6 +66,7 @@ static heap *newheap(heapdesc *hd,enum Loc loc,ub4 fln)
   static_assert(Stdalign < Pagesize,"Stdalign < Pagesize");
   static_assert(Mmap_max_threshold < 31,"Mmap_max_threshold < 31");
   static_assert(Mmap_threshold <= Mmap_max_threshold,"Mmap_threshold < max");
+  static_assert(Numa_nodes <= 8 && (Numa_nodes & (Numa_nodes - 1)) == 0,"Numa_nodes pwr2 <= 8");
 
   len = hlen + rlen + rxlen;
   len += (dlen + llen) * sizeof(void *);
@@ -102,6 +105,11 @@ static heap *newheap(heapdesc *hd,enum Loc loc,ub4 fln)
   ycheck(nil,loc,base - (size_t)vbase > len,"len %zu above %u",base - (size_t)vbase,len)
 
   hb->id = hid;
+#if Yal_enable_numa
+  hb->node = osnode();
+  hb->stat.nodeheaps[hb->node & (Numa_nodes - 1)] = 1;
+  hb->stat.numalocal = 1;
+#endif
 
   heap_init(hb);
   hb->stat.mmaps = 1;
@@ -126,41 +134,158 @@ static heap *newheap(heapdesc *hd,enum Loc loc,ub4 fln)
   return hb;
 }
 
-// create new heap or reassign an existing one
-static heap *heap_new(heapdesc *hd,enum Loc loc,ub4 fln)
+#if Yal_thread_exit
+static heap * _Atomic global_idleheaps[Idleheaps];
+
+// offer the heap of an exiting thread to new threads. If full, it stays on global_heaps for reassign
+static void heap_idle(heap *hb)
 {
-  heap *hb,*ohb = nil;
-  bool didcas;
-  ub4 zero;
+  heap *nohb;
+  ub4 i;
 
-  hb = Atomget(global_heaps,Moacq);
+  for (i = 0; i < Idleheaps; i++) {
+    nohb = nil;
+    if (Atomget(global_idleheaps[i],Monone) == nil && Cas(global_idleheaps[i],nohb,hb)) return;
+  }
+}
 
-  while (hb) {
+// lock a heap left by an exited thread
+static heap *heap_getidle(void)
+{
+  heap *hb;
+  ub4 i,zero;
+
+  for (i = 0; i < Idleheaps; i++) {
+    hb = Atomget(global_idleheaps[i],Moacq);
+    if (hb == nil || Cas(global_idleheaps[i],hb,nil) == 0) continue;
     zero = 0;
-    didcas = Cas(hb->lock,zero,1);
-#if 1
-    if (unlikely(didcas == 0)) {
-      Pause
-      zero = 0;
-      didcas = Cas(hb->lock,zero,1);
-    }
+    if (Cas(hb->lock,zero,1)) return hb; // else taken via global_heaps
+  }
+  return nil;
+}
 #endif
+
+#if Yal_percpu
+// lock the heap of the current cpu, creating it if needed
+static heap *heap_cpu(heapdesc *hd,enum Loc loc,ub4 fln)
+{
+  heap * _Atomic *chp = global_cpuheaps + cpu_id();
+  heap *hb,*nhb;
+  bool didcas;
+  ub4 zero,iter = 0;
+
+  hb = Atomgeta(chp,Moacq);
+  if (hb == nil) {
+    nhb = newheap(hd,loc,fln); // locked
+    if (nhb == nil) return nil;
+    didcas = Casa(chp,&hb,nhb);
     if (didcas) {
-      vg_drd_wlock_acq(hb)
-      Atomset(hb->locfln,Fln,Morel);
-      // heap_reset(hb);
-      hd->stat.useheaps++;
-      ydbg1(fln,Lnone,"use next heap %u for %u %zx",hb->id,hd->id,(size_t)hb);
-      return hb;
+      hd->stat.newheaps++;
+      return nhb;
     }
+    Atomset(nhb->lock,0,Morel); // lost race, leave unused
+    vg_drd_wlock_rel(nhb)
+  }
+
+  zero = 0;
+  didcas = Cas(hb->lock,zero,1);
+  while (didcas == 0) { // held briefly, unless by a thread preempted on this cpu
+    hd->stat.nogetheap0s++;
+    if ((++iter & 0x3f) == 0) osyield();
+    else Pause
+    zero = 0;
+    didcas = Cas(hb->lock,zero,1);
+  }
+  vg_drd_wlock_acq(hb)
+  Atomset(hb->locfln,Fln,Morel);
+  hd->stat.useheaps++;
+  return hb;
+}
+#endif
+
+// lock if seen unlocked, after one pause. Locked heaps are only read, not cas'ed
+static bool heap_trylock(heap *hb)
+{
+  ub4 zero = 0;
+
+  if (Atomget(hb->lock,Monone) != 0) {
+    Pause
+    if (Atomget(hb->lock,Monone) != 0) return 0;
+  }
+  return Cas(hb->lock,zero,1);
+}
+
+/* create new heap or reassign an existing one. With numa, first try heaps of the current node
+   Scan all heaps once, starting after the last one taken, to spread contending threads
+ */
+static heap *heap_new(heapdesc *hd,enum Loc loc,ub4 fln)
+{
+  heap *hb,*first,*ohb = nil;
+  bool didcas,wrap;
+  ub4 node = Yal_enable_numa ? osnode() : 0;
+  ub4 pass = Yal_enable_numa ? 0 : 1;
+
+#if Yal_percpu
+  return heap_cpu(hd,loc,fln);
+#endif
+
+#if Yal_thread_exit
+  hb = heap_getidle();
+  if (hb) {
+    vg_drd_wlock_acq(hb)
+    Atomset(hb->locfln,Fln,Morel);
+    hd->stat.useheaps++;
+    hb->stat.idleheaps++;
+    ydbg1(fln,Lnone,"use idle heap %u for %u",hb->id,hd->id);
+    return hb;
+  }
+#endif
+
+  for (; pass < 2; pass++) {
+  first = Atomget(global_heaphint,Monone);
+  if (first == nil) first = Atomget(global_heaps,Moacq);
+  hb = first;
+  wrap = 0;
+
+  while (hb) {
+    // skip private to a pool, and other node in pass 0, same node in pass 1
+    if (hb->poolheap == 0 && (Yal_enable_numa == 0 || (hb->node == node) != pass)) {
+      didcas = heap_trylock(hb);
+      if (didcas) {
+        vg_drd_wlock_acq(hb)
+        Atomset(hb->locfln,Fln,Morel);
+        Atomset(global_heaphint,hb->nxt,Monone);
+        // heap_reset(hb);
+        hd->stat.useheaps++;
+        if (Yal_enable_numa) {
+          if (pass) hb->stat.numaremote++;
+          else hb->stat.numalocal++;
+        }
+        ydbg1(fln,Lnone,"use next heap %u for %u %zx",hb->id,hd->id,(size_t)hb);
+        return hb;
+      }
 #if Yal_dbg_level > 1
-    do_ylog(Diagcode,loc,fln,Debug,0,"no next heap %u for %u",hb->id,hd->id);
-    do_ylog(Diagcode,loc,Atomget(hb->locfln,Moacq),Debug,0,"no next heap %u for %u",hb->id,hd->id);
+      do_ylog(Diagcode,loc,fln,Debug,0,"no next heap %u for %u",hb->id,hd->id);
+      do_ylog(Diagcode,loc,Atomget(hb->locfln,Moacq),Debug,0,"no next heap %u for %u",hb->id,hd->id);
 #endif
-    hd->stat.nogetheap0s++;
+      hd->stat.nogetheap0s++;
+    }
     hb = hb->nxt;
+    if (hb == nil && wrap == 0) { // continue from head
+      wrap = 1;
+      hb = Atomget(global_heaps,Moacq);
+    }
+    if (wrap && hb == first) break;
+  }
   }
 
+#if Yal_enable_fork
+  if (unlikely(Atomget(global_forking,Moacq))) { // all heaps are held for fork, wait instead of adding one
+    while (Atomget(global_forking,Moacq)) osyield();
+    return heap_new(hd,loc,fln);
+  }
+#endif
+
   ohb = newheap(hd,loc,fln);
   hd->stat.newheaps++;
 
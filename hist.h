@@ -0,0 +1,282 @@
+/* hist.h - sampled allocation histograms
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   One in Hist_interval + 1 malloc and free calls of a thread is sampled into its heap descriptor, without atomics or heap lock.
+   Lengths are binned in 4 steps per pwr2. Sampled blocks are followed in a small direct-mapped table : a free by the same thread
+   yields the lifetime in calls of that thread. A block freed by another thread leaves a stale entry, replaced by a later sample.
+   Frees are counted per size class of the block, and as cross-thread if from another heap.
+   Merged over all threads at Yal_stats() and written as '<len> <count>' lines usable as configure profile.
+*/
+
+#define Logfile Fhist
+
+static_assert(Clascnt <= Hist_clas - 2,"Clascnt <= Hist_clas - 2");
+static_assert(Hist_lens == sizeof(((struct yal_stats *)0)->reqlens) / sizeof(size_t),"Hist_lens matches yal_stats");
+static_assert(Hist_clas == sizeof(((struct yal_stats *)0)->clasfrees) / sizeof(size_t),"Hist_clas matches yal_stats");
+static_assert(Hist_tags == sizeof(((struct yal_stats *)0)->histtags) / sizeof(ub4),"Hist_tags matches yal_stats");
+static_assert((Hist_track & (Hist_track - 1)) == 0,"Hist_track pwr2");
+
+// 4 steps per pwr2
+static ub4 hist_bin(size_t len)
+{
+  ub4 ord,bin;
+
+  if (len < 4) return (ub4)len;
+  ord = 63 - clzl(len);
+  bin = ord * 4 + (ub4)((len >> (ord - 2)) & 3) - 4;
+  return bin < Hist_lens ? bin : Hist_lens - 1;
+}
+
+// highest len in bin
+static size_t hist_binlen(ub4 bin)
+{
+  ub4 ord;
+
+  if (bin < 4) return bin;
+  ord = (bin + 4) >> 2;
+  return ((size_t)(5 + ((bin + 4) & 3)) << (ord - 2)) - 1;
+}
+
+// pseudo-random 1 in Hist_interval + 1, not aliasing with periodic call patterns
+static inline bool hist_sample(size_t cnt)
+{
+  return cnt * 0x9e3779b97f4a7c15ul < Hi64 / (Hist_interval + 1);
+}
+
+static struct hdhist *hist_new(heapdesc *hd)
+{
+  struct hdhist *hs = osmem(Fln,hd->id,sizeof(struct hdhist),"histogram");
+
+  hd->hist = hs;
+  return hs;
+}
+
+static Cold void hist_asample(heapdesc *hd,void *p,size_t len,Unused ub4 tag)
+{
+  struct hdhist *hs = hd->hist;
+  xregion *xreg;
+  size_t ip = (size_t)p;
+  size_t glen;
+  ub4 h;
+
+  if (p == nil || len == 0) return;
+  if (unlikely(hs == nil) && (hs = hist_new(hd)) == nil) return;
+
+  xreg = findgregion(Lalloc,ip);
+  if (xreg == nil) return;
+
+  switch (xreg->typ) {
+    case Rslab: glen = ((region *)xreg)->cellen; break;
+    case Rmmap: glen = xreg->len; break;
+    default: glen = len;
+  }
+  hs->allocs++;
+  hs->reqlens[hist_bin(len)]++;
+  hs->grantlens[hist_bin(glen)]++;
+
+  h = (ub4)(ip >> 4) & (Hist_track - 1);
+  hs->trkips[h] = ip;
+  hs->trkticks[h] = hd->histallocs + hd->histfrees;
+
+#if Yal_enable_tag
+  ub4 t;
+
+  for (t = 0; t < Hist_tags - 1; t++) {
+    if (hs->tags[t] == tag || hs->tagcnts[t] == 0) break;
+  }
+  if (t == Hist_tags - 1) tag = Hi32; // other
+  hs->tags[t] = tag;
+  hs->tagcnts[t]++;
+  hs->tagbytes[t] += len;
+#endif
+}
+
+static Cold void hist_fsample(heapdesc *hd,size_t ip)
+{
+  struct hdhist *hs = hd->hist;
+  xregion *xreg;
+  ub4 clas;
+  bool remote;
+
+  if (unlikely(hs == nil) && (hs = hist_new(hd)) == nil) return;
+
+  xreg = findgregion(Lfree,ip);
+  if (xreg == nil) return;
+
+  switch (xreg->typ) {
+    case Rslab: clas = ((region *)xreg)->clas; remote = xreg->hb != hd->hb; break;
+    case Rmmap: clas = Hist_clas - 1; remote = xreg->hb != hd->hb; break;
+    case Rmini: clas = Hist_clas - 2; remote = (bregion *)xreg != hd->mhb; break;
+    default: clas = Hist_clas - 2; remote = xreg->hb != hd->hb;
+  }
+  hs->frees++;
+  hs->clasfrees[clas]++;
+  if (remote) hs->clasxfrees[clas]++;
+}
+
+static Cold void hist_life(heapdesc *hd,struct hdhist *hs,ub4 h)
+{
+  size_t dt = hd->histallocs + hd->histfrees - hs->trkticks[h];
+  ub4 bin = dt ? 64 - clzl(dt) : 0;
+
+  hs->trkips[h] = 0;
+  hs->lives++;
+  hs->lifetimes[bin < Hist_lives ? bin : Hist_lives - 1]++;
+}
+
+static Hot inline void hist_alloc(heapdesc *hd,void *p,size_t len,ub4 tag)
+{
+  size_t allocs = ++hd->histallocs;
+
+  if (unlikely(hist_sample(allocs))) hist_asample(hd,p,len,tag);
+}
+
+static Hot inline void hist_free(heapdesc *hd,void *p)
+{
+  struct hdhist *hs = hd->hist;
+  size_t ip = (size_t)p;
+  size_t frees = ++hd->histfrees;
+  ub4 h;
+
+  if (likely(hs != nil)) {
+    h = (ub4)(ip >> 4) & (Hist_track - 1);
+    if (unlikely(hs->trkips[h] == ip)) hist_life(hd,hs,h);
+  }
+  if (unlikely(hist_sample(frees))) hist_fsample(hd,ip);
+}
+
+// add thread's histograms to sum
+static void hist_merge(yalstats *sum,heapdesc *hd)
+{
+  struct hdhist *hs = hd->hist;
+  ub4 i,t,tag;
+
+  if (hs == nil) return;
+
+  sum->histallocs += hs->allocs;
+  sum->histfrees += hs->frees;
+  sum->histlives += hs->lives;
+  for (i = 0; i < Hist_lens; i++) {
+    sum->reqlens[i] += hs->reqlens[i];
+    sum->grantlens[i] += hs->grantlens[i];
+  }
+  for (i = 0; i < Hist_lives; i++) sum->lifetimes[i] += hs->lifetimes[i];
+  for (i = 0; i < Hist_clas; i++) {
+    sum->clasfrees[i] += hs->clasfrees[i];
+    sum->clasxfrees[i] += hs->clasxfrees[i];
+  }
+  for (i = 0; i < Hist_tags && hs->tagcnts[i]; i++) {
+    tag = hs->tags[i];
+    for (t = 0; t < Hist_tags - 1; t++) {
+      if (sum->histtags[t] == tag || sum->histtagcnts[t] == 0) break;
+    }
+    if (t == Hist_tags - 1) tag = Hi32;
+    sum->histtags[t] = tag;
+    sum->histtagcnts[t] += hs->tagcnts[i];
+    sum->histtagbytes[t] += hs->tagbytes[i];
+  }
+}
+
+static Cold void hist_print(int fd,yalstats *sp)
+{
+  char buf[4096];
+  ub4 pos,len = 4094;
+  ub4 i,t,top;
+  size_t n,x,sumbytes = 0;
+  ub4 done[Hist_tags];
+
+  pos = snprintf_mini(buf,0,len,"\n-- sampled histograms 1 in %u calls : %zu` allocs %zu` frees %zu` lifetimes --\n",Hist_interval + 1,sp->histallocs,sp->histfrees,sp->histlives);
+
+  pos += snprintf_mini(buf,pos,len,"\n  len <=   requested    granted\n");
+  for (i = 0; i < Hist_lens; i++) {
+    if ((sp->reqlens[i] | sp->grantlens[i]) == 0) continue;
+    pos += snprintf_mini(buf,pos,len,"  %-9zu` %-10zu` %-10zu`\n",hist_binlen(i),sp->reqlens[i],sp->grantlens[i]);
+    if (pos > 3800) { oswrite(fd,buf,pos,Fln); pos = 0; }
+  }
+
+  if (sp->histlives) {
+    pos += snprintf_mini(buf,pos,len,"\n  lifetime <= calls    count\n");
+    for (i = 0; i < Hist_lives; i++) {
+      if (sp->lifetimes[i]) pos += snprintf_mini(buf,pos,len,"  %-17zu` %zu`\n",i ? (1ul << i) - 1 : 0,sp->lifetimes[i]);
+    }
+  }
+  oswrite(fd,buf,pos,Fln); pos = 0;
+
+  if (sp->histfrees) {
+    pos += snprintf_mini(buf,pos,len,"\n  clas      free     xfree  xfree%%\n");
+    for (i = 0; i < Hist_clas; i++) {
+      n = sp->clasfrees[i];
+      if (n == 0) continue;
+      x = sp->clasxfrees[i];
+      if (i == Hist_clas - 1) pos += snprintf_mini(buf,pos,len,"  mmap ");
+      else if (i == Hist_clas - 2) pos += snprintf_mini(buf,pos,len,"  bump ");
+      else pos += snprintf_mini(buf,pos,len,"  %-4u ",i);
+      pos += snprintf_mini(buf,pos,len,"%-9zu` %-9zu` %3zu\n",n,x,x * 100 / n);
+      if (pos > 3800) { oswrite(fd,buf,pos,Fln); pos = 0; }
+    }
+  }
+
+  for (t = 0; t < Hist_tags; t++) sumbytes += sp->histtagbytes[t];
+  if (sumbytes) { // callsites by bytes, estimated as sampled * interval
+    pos += snprintf_mini(buf,pos,len,"\n  tag        bytes     allocs   bytes%%\n");
+    memset(done,0,sizeof(done));
+    for (;;) {
+      top = Hist_tags;
+      for (t = 0; t < Hist_tags; t++) {
+        if (done[t] || sp->histtagcnts[t] == 0) continue;
+        if (top == Hist_tags || sp->histtagbytes[t] > sp->histtagbytes[top]) top = t;
+      }
+      if (top == Hist_tags) break;
+      done[top] = 1;
+      if (sp->histtags[top] == Hi32) pos += snprintf_mini(buf,pos,len,"  other ");
+      else pos += snprintf_mini(buf,pos,len,"  %-5x ",sp->histtags[top]);
+      n = sp->histtagbytes[top];
+      pos += snprintf_mini(buf,pos,len,"%-10zu` %-10zu` %3zu\n",n * (Hist_interval + 1),sp->histtagcnts[top] * (Hist_interval + 1),n * 100 / sumbytes);
+    }
+  }
+  buf[pos++] = '\n';
+  oswrite(fd,buf,pos,Fln);
+}
+
+// write as '<len> <count>' lines for configure -p, other histograms with a leading keyword
+static Cold void hist_dump(yalstats *sp,ub4 id,unsigned long pid)
+{
+  char buf[4096];
+  ub4 pos,len = 4094;
+  ub4 i;
+  int fd;
+
+  static cchar *name[] = { Yal_hist_file,".txt" };
+
+  fd = newlogfile(name,"",id,pid);
+  if (fd == 2) return;
+
+  pos = snprintf_mini(buf,0,len,"# yalloc %s histograms, sampled 1 in %u\n# requested <len> <count>, usable as configure -p profile\n",yal_version,Hist_interval + 1);
+  for (i = 0; i < Hist_lens; i++) {
+    if (sp->reqlens[i]) pos += snprintf_mini(buf,pos,len,"%zu %zu\n",hist_binlen(i),sp->reqlens[i]);
+    if (pos > 3900) { oswrite(fd,buf,pos,Fln); pos = 0; }
+  }
+  for (i = 0; i < Hist_lens; i++) {
+    if (sp->grantlens[i]) pos += snprintf_mini(buf,pos,len,"grant %zu %zu\n",hist_binlen(i),sp->grantlens[i]);
+    if (pos > 3900) { oswrite(fd,buf,pos,Fln); pos = 0; }
+  }
+  for (i = 0; i < Hist_lives; i++) {
+    if (sp->lifetimes[i]) pos += snprintf_mini(buf,pos,len,"life %zu %zu\n",i ? (1ul << i) - 1 : 0,sp->lifetimes[i]);
+  }
+  if (pos) { oswrite(fd,buf,pos,Fln); pos = 0; }
+  for (i = 0; i < Hist_clas; i++) {
+    if (sp->clasfrees[i]) pos += snprintf_mini(buf,pos,len,"clas %u %zu %zu\n",i,sp->clasfrees[i],sp->clasxfrees[i]);
+    if (pos > 3900) { oswrite(fd,buf,pos,Fln); pos = 0; }
+  }
+  for (i = 0; i < Hist_tags; i++) {
+    if (sp->histtagcnts[i]) pos += snprintf_mini(buf,pos,len,"tag %u %zu %zu\n",sp->histtags[i],sp->histtagbytes[i],sp->histtagcnts[i]);
+  }
+  if (pos) oswrite(fd,buf,pos,Fln);
+  osclose(fd);
+}
+
+#undef Logfile
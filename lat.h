@@ -0,0 +1,85 @@
+/* lat.h - cycle-count latency histograms
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   Time selected internal calls in cycles via rdtsc or cntvct into pwr2 buckets, per heap descriptor or per heap under its lock
+   Entries as enum Yal_lat_ops, summed and printed with the statistics
+*/
+
+#define Logfile Flat
+
+#define Lat_bins 32 // as in struct yal_stats
+
+static_assert(Yal_lat_count <= 8,"yal_stats lats");
+
+#if defined __x86_64__ || defined __i386__
+ static inline ub8 lat_cycles(void) { return __builtin_ia32_rdtsc(); }
+#elif defined __aarch64__
+ static inline ub8 lat_cycles(void)
+ {
+   ub8 t;
+
+   __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (t));
+   return t;
+ }
+#else
+ static inline ub8 lat_cycles(void) { return 0; }
+#endif
+
+static inline void lat_add(size_t *bins,ub8 t0)
+{
+  ub8 dt = lat_cycles() - t0;
+  ub4 b = dt ? 64 - (ub4)__builtin_clzll(dt) : 0;
+
+  bins[min(b,Lat_bins - 1)]++;
+}
+
+#define Latstart ub8 lat_t0 = lat_cycles();
+#define Latend(sp,op) lat_add((sp).lats[op],lat_t0);
+
+static void lat_merge(yalstats *sum,size_t lats[][Lat_bins])
+{
+  ub4 op,b;
+
+  for (op = 0; op < Yal_lat_count; op++) {
+    for (b = 0; b < Lat_bins; b++) sum->lats[op][b] += lats[op][b];
+  }
+}
+
+static cchar * const latnames[Yal_lat_count] = { "alloc","free","realloc","newregion","trim","unbuffer" };
+
+// percentiles as upper bucket bound, and nonempty buckets
+static void lat_print(int fd,yalstats *sp)
+{
+  char buf[4096];
+  ub4 pos = 0,len = 4000;
+  size_t cnt,cum,*bins;
+  ub4 op,b,p50,p99,p999;
+
+  pos = snprintf_mini(buf,0,len,"\n  latency   %-9s %7s  %-5s %-5s %-5s  cycles 2^n:count\n","op","calls","p50","p99","p999");
+  for (op = 0; op < Yal_lat_count; op++) {
+    bins = sp->lats[op];
+    cnt = 0;
+    for (b = 0; b < Lat_bins; b++) cnt += bins[b];
+    if (cnt == 0) continue;
+    cum = 0; p50 = p99 = p999 = Hi32;
+    for (b = 0; b < Lat_bins; b++) {
+      cum += bins[b];
+      if (p50 == Hi32 && cum * 2 >= cnt) p50 = b;
+      if (p99 == Hi32 && cum * 100 >= cnt * 99) p99 = b;
+      if (p999 == Hi32 && cum * 1000 >= cnt * 999) p999 = b;
+    }
+    pos += snprintf_mini(buf,pos,len,"  latency   %-9s %7zu`  2^%-3u 2^%-3u 2^%-3u ",latnames[op],cnt,p50,p99,p999);
+    for (b = 0; b < Lat_bins; b++) {
+      if (bins[b]) pos += snprintf_mini(buf,pos,len," %u:%zu`",b,bins[b]);
+    }
+    buf[pos++] = '\n';
+    if (pos > 3000) { oswrite(fd,buf,pos,Fln); pos = 0; }
+  }
+  oswrite(fd,buf,pos,Fln);
+}
+
+#undef Logfile
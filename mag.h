@@ -0,0 +1,251 @@
+/* mag.h - per-thread magazine of small cells
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   A heap descriptor may hold a magazine : a small LIFO of ready cells per small size class, all from slab regions of one heap.
+   malloc() and free() of small blocks on the owning thread are served from it without heap lock and class lookup.
+   Cells move between magazine and region bins in batches, with the heap locked.
+   Cached cells are marked 4 in the binset. A double free of such a cell is thus detected as for a binned one.
+*/
+
+#define Logfile Fmag
+
+static struct magazine *mag_new(heapdesc *hd,heap *hb)
+{
+  struct magazine *mg;
+
+  static_assert(Magazine_len <= Cel_nolen,"Magazine_len <= Cel_nolen");
+  static_assert(Magazine_fill <= Magazine_cnt,"Magazine_fill <= Magazine_cnt");
+
+  mg = osmem(Fln,hb->id,sizeof(struct magazine),"magazine");
+  if (mg == nil) return nil;
+  hb->stat.mmaps++;
+
+  ydbg2(Fln,Lalloc,"new magazine for %u in heap %u len %u`",hd->id,hb->id,(ub4)sizeof(struct magazine))
+
+  mg->hb = hb;
+  hd->mag = mg;
+  return mg;
+}
+
+// move the oldest cnt cells of a class back to their bins. hb is locked and owns the cells
+static void mag_drain(heap *hb,struct magazine *mg,ub4 clas,ub4 cnt)
+{
+  struct magcel *mc = mg->cels[clas];
+  region *reg;
+  ub4 c,cel,bincnt,claspos;
+  ub4 left = mg->cnts[clas] - cnt;
+  bool rv;
+
+  for (c = 0; c < cnt; c++) {
+    reg = mc[c].reg;
+    cel = mc[c].cel;
+    rv = slab_markused(reg,cel,4,Fln);
+    if (unlikely(rv != 0)) continue;
+    bincnt = slab_frecel(hb,reg,cel,reg->cellen,reg->celcnt,0);
+    if (unlikely(bincnt == 1) && reg->inipos == reg->celcnt) { // was full, re-include in alloc candidate list
+      claspos = reg->claspos;
+      hb->clasinf[clas].msk |= (1ul << claspos);
+      hb->clasinf[clas].pos = (ub2)claspos;
+    }
+  }
+  if (left) memmove(mc,mc + cnt,left * sizeof(struct magcel));
+  mg->cnts[clas] = left;
+  mg->cnt -= cnt;
+}
+
+// heap changed : return all cells to their owner. hb is locked and not the owner
+static void mag_flush(heapdesc *hd,heap *hb,struct magazine *mg)
+{
+  heap *xhb = mg->hb;
+  struct magcel *mc;
+  region *reg;
+  size_t ip;
+  ub4 clas,c,cnt;
+  ub4 from;
+  bool didcas;
+
+  from = 0; didcas = Cas(xhb->lock,from,1);
+  if (didcas) { vg_drd_wlock_acq(xhb) }
+
+  for (clas = 0; clas < Magclas; clas++) {
+    cnt = mg->cnts[clas];
+    if (cnt == 0) continue;
+    if (didcas) {
+      mag_drain(xhb,mg,clas,cnt);
+      continue;
+    }
+    mc = mg->cels[clas];
+    for (c = 0; c < cnt; c++) { // as remote free
+      reg = mc[c].reg;
+      if (slab_markused(reg,mc[c].cel,4,Fln)) continue;
+      ip = reg->user + (size_t)mc[c].cel * reg->cellen;
+      slab_free_rheap(hd,hb,reg,ip,0,Lfree);
+    }
+    mg->cnts[clas] = 0;
+  }
+  mg->cnt = 0;
+
+  if (didcas) {
+    Atomset(xhb->lock,0,Morel);
+    vg_drd_wlock_rel(xhb)
+  }
+  ystats(hd->stat.magflushes)
+}
+
+// return all cached cells to their bins, as at thread exit. hb is locked
+static void mag_return(heapdesc *hd,heap *hb,struct magazine *mg)
+{
+  ub4 clas;
+
+  if (mg == nil || mg->cnt == 0) return;
+  if (mg->hb == hb) {
+    for (clas = 0; clas < Magclas; clas++) {
+      if (mg->cnts[clas]) mag_drain(hb,mg,clas,mg->cnts[clas]);
+    }
+  } else mag_flush(hd,hb,mg);
+}
+
+// malloc from locked heap, as slab_malloc, and refill magazine from the same region
+static Hot void *mag_fill(heapdesc *hd,heap *hb,region *reg,ub4 clas,ub4 len,ub4 tag)
+{
+  struct magazine *mg = hd->mag;
+  struct magcel *mc;
+  void *p;
+  ub4 c,cel,cnt,cellen;
+
+  p = slab_malloc(reg,len,tag);
+  if (unlikely(p == nil || clas >= Magclas)) return p;
+
+  if (unlikely(mg == nil)) {
+    mg = mag_new(hd,hb);
+    if (mg == nil) return p;
+  } else if (unlikely(mg->hb != hb)) {
+    if (mg->cnt) mag_flush(hd,hb,mg);
+    mg->hb = hb;
+  }
+
+  cnt = mg->cnts[clas];
+  mc = mg->cels[clas];
+  cellen = reg->cellen;
+
+  for (c = 0; c < Magazine_fill && cnt < Magazine_cnt; c++) {
+    cel = slab_newcel(reg,Lalloc);
+    if (cel == Nocel) break;
+    if (unlikely(markfree(reg,cel,cellen,4,Fln,0))) break;
+    mc[cnt].reg = reg;
+    mc[cnt++].cel = cel;
+  }
+  mg->cnt += cnt - mg->cnts[clas];
+  mg->cnts[clas] = cnt;
+  ystats(hd->stat.magfills)
+  return p;
+}
+
+// malloc from magazine. len below Magazine_len, heap unlocked
+static Hot void *mag_alloc(heapdesc Unused *hd,struct magazine *mg,ub4 len,ub4 Unused tag)
+{
+  struct magcel *mc;
+  region *reg;
+  ub4 clas = len2clas[len];
+  ub4 cnt = mg->cnts[clas];
+  ub4 cel;
+  void *p;
+  bool rv;
+
+  if (unlikely(cnt == 0)) return nil;
+
+  cnt--;
+  mc = mg->cels[clas] + cnt;
+  reg = mc->reg;
+  cel = mc->cel;
+  mg->cnts[clas] = cnt;
+  mg->cnt--;
+
+  rv = slab_markused(reg,cel,4,Fln);
+  if (unlikely(rv != 0)) return nil;
+
+#if Yal_enable_tag
+  ub4 *tags = reg->meta + reg->tagorg;
+
+  tags[cel] = tag;
+#endif
+
+  p = (void *)(reg->user + (size_t)cel * reg->cellen);
+  vg_mem_undef(p,len)
+
+  ystats(hd->stat.magallocs)
+  ytrace(0,hd,Lalloc,tag,0,"alloc %u = %zx mag",len,(size_t)p)
+  return p;
+}
+
+/* free into magazine if owned by its heap. heap unlocked
+   returns 0 if not handled
+ */
+static Hot bool mag_free(heapdesc *hd,struct magazine *mg,void *p,ub4 tag)
+{
+  heap *hb = mg->hb;
+  size_t ip = (size_t)p;
+  xregion *xreg;
+  region *reg;
+  struct magcel *mc;
+  ub4 clas,cel,cnt,cellen;
+  ub4 from;
+  bool didcas,rv;
+  enum Tidstate tidstate = hd->tidstate;
+
+  if (unlikely(hb != hd->hb || p == global_zeroblock || ip < Pagesize || ip >= Vmsize)) return 0;
+
+  xreg = findgregion(Lfree,ip); // as remote free, no lock needed
+  hd->magip = ip; // spare free_heap() the lookup if not taken here
+  hd->magreg = xreg;
+  if (unlikely(xreg == nil || xreg->typ != Rslab || xreg->hb != hb)) return 0;
+
+  reg = (region *)xreg; // -V1027 PVS unrelated obj cast
+  clas = reg->clas;
+  if (clas > len2clas[Magazine_len - 1] || clas >= Magclas) return 0;
+
+  cnt = mg->cnts[clas];
+  if (unlikely(cnt == Magazine_cnt)) { // full: return oldest half to bins
+    if (tidstate == Ts_mt) {
+      from = 0; didcas = Cas(hb->lock,from,1);
+      if (didcas == 0) return 0;
+      vg_drd_wlock_acq(hb)
+    } else priv_enter(hb)
+    mag_drain(hb,mg,clas,Magazine_cnt / 2);
+    if (tidstate == Ts_mt) {
+      Atomset(hb->lock,0,Morel);
+      vg_drd_wlock_rel(hb)
+    } else priv_leave(hb)
+    ystats(hd->stat.magdrains)
+    cnt = mg->cnts[clas];
+  }
+
+  cellen = reg->cellen;
+  cel = slab_cel(reg,ip,cellen,reg->celcnt,Lfree);
+  hd->magip = 0;
+  if (unlikely(cel == Nocel)) {
+    hd->stat.invalid_frees++;
+    return 1;
+  }
+  rv = markfree(reg,cel,cellen,4,Fln,tag);
+  if (unlikely(rv != 0)) {
+    hd->stat.invalid_frees++;
+    return 1;
+  }
+
+  mc = mg->cels[clas] + cnt;
+  mc->reg = reg;
+  mc->cel = cel;
+  mg->cnts[clas] = cnt + 1;
+  mg->cnt++;
+
+  ystats(hd->stat.magfrees)
+  ytrace(0,hd,Lfree,tag,0,"free(%zx) mag",ip)
+  return 1;
+}
+
+#undef Logfile
@@ -23,8 +23,17 @@ struct yal_stats {
 
   // conditional stats - summable
   size_t allocs,Allocs,callocs,alloc0s,slaballocs,slabAllocs,mapallocs,mapAllocs;
-  size_t reallocles,reallocgts,Reallocles,mreallocles,mreallocgts;
+  size_t reallocles,reallocgts,Reallocles,reallocruns,mreallocles,mreallocgts;
+  size_t mrealinplace,mrealmoves,mrealcopies,mreserves;
   size_t miniallocs,bumpallocs;
+  size_t arenas,arenachunks,arenaallocs,arenabytes,arenafrees;
+  size_t callocclear,calloczero; // calloc bytes cleared, known zero
+  size_t rsvregions,rsvcels,rsvbytes; // yal_reserve
+  size_t clas2slab,clas2bump; // Yal_clas_adapt
+  size_t memrelieves; // Yal_enable_memlimit pressure rounds handled
+  size_t bgtrims; // Yal_enable_bg heap visits
+  size_t alclasallocs; // aligned_alloc from a class aligned by construction
+  size_t ownerfrees,ownerbusy; // remote slab frees done in the owner heap, or buffered as it was busy
   size_t frees,free0s,freenils,slabfrees,mapfrees,slabxfrees,xslabfrees,mapxfrees,xmapfrees,minifrees,bumpfrees;
   size_t sizes;
   size_t bumpalbytes;
@@ -33,6 +42,7 @@ struct yal_stats {
   size_t mmaps,munmaps;
 
   size_t findregions;
+  size_t regcachehits,regcachemisses;
   size_t locks,clocks;
   size_t xfreebuf; // unconditional
   size_t xfreesum,xfreebatch,xfreebatch1,xfreedropped,rbinallocs,xbufbytes;
@@ -43,12 +53,28 @@ struct yal_stats {
 
   size_t newregions,useregions,noregions,curnoregions; // unconditional
   size_t delregions,region_cnt,freeregion_cnt,delregion_cnt,noregion_cnt;
-  size_t newmpregions,usempregions,delmpregions,nompregions,curnompregions;
+  size_t newmpregions,usempregions,delmpregions,nompregions,curnompregions,splitmpregions;
   size_t xregion_cnt,slab_cnt,mmap_cnt;
   size_t trimregions[8];
+  size_t decommits,decombytes;
 
   unsigned int newheaps,useheaps;
   size_t getheaps,nogetheaps,nogetheap0s;
+  size_t idleheaps,handovers; // heaps taken over from and handed over by exited threads
+
+  // numa: heap acquisitions from the heap's own node or another, memory bound per node
+  size_t numalocal,numaremote,numafails;
+  size_t nodeheaps[8],nodebytes[8];
+
+  // sampled histograms, see Yal_stats_hist. lengths in 4 steps per pwr2, lifetime in pwr2 of calls by the allocating thread
+  size_t histallocs,histfrees,histlives;
+  size_t reqlens[160],grantlens[160];
+  size_t lifetimes[32];
+  size_t clasfrees[128],clasxfrees[128]; // per size class, 126 bump and mini, 127 mmap
+  unsigned int histtags[32]; // callsites by sampled bytes, if Yal_enable_tag
+  size_t histtagbytes[32],histtagcnts[32];
+
+  size_t lats[8][32]; // cycles per call in pwr2 buckets, as enum Yal_lat_ops. see Yal_enable_lat
 
   // stats - unsummable
   unsigned int minlen,maxlen;
@@ -58,6 +84,9 @@ struct yal_stats {
 
   size_t  frecnt,fresiz,fremapsiz,inuse,inusecnt,inmapuse,inmapusecnt;
   size_t slabmem,mapmem;
+  size_t metalist,metamap,celslist,celsmap; // slab metadata as required and cels, per bin format
+  size_t lenskips; // net len writes saved, see Yal_lazy_len
+  size_t hugemem,hugeregions; // slab regions on huge pages
   size_t xmaxbin;
 
   size_t minalign,maxalign;
@@ -68,13 +97,58 @@ struct yal_stats {
 };
 
 // print and/or return statistics
-enum Yal_stats_opts { Yal_stats_sum = 1, Yal_stats_detail = 2, Yal_stats_totals = 4, Yal_stats_state = 8, Yal_stats_print = 16, Yal_stats_cfg = 32  };
+enum Yal_stats_opts { Yal_stats_sum = 1, Yal_stats_detail = 2, Yal_stats_totals = 4, Yal_stats_state = 8, Yal_stats_print = 16, Yal_stats_cfg = 32, Yal_stats_hist = 64 };
 
 extern size_t yal_mstats(struct yal_stats *sp,unsigned int opts,unsigned int tag,const char *desc);
 
+enum Yal_lat_ops { Yal_lat_alloc, Yal_lat_free, Yal_lat_realloc, Yal_lat_newregion, Yal_lat_trim, Yal_lat_unbuffer, Yal_lat_count };
+
+// export above for totals and optionally each heap as text into buf, without allocating. returns len written, 0 if buf too small
+enum Yal_export_opts { Yal_export_json = 1, Yal_export_prom = 2, Yal_export_heaps = 4 };
+extern size_t yal_stats_export(char *buf,size_t len,unsigned int opts,unsigned int tag);
+
+// live counters per heap and per thread, copied without region walk or formatting. Counters are as of Yal_enable_stats
+enum Yal_snap_kind { Yal_snap_heap = 1, Yal_snap_thread = 2 };
+struct yal_snap {
+  unsigned long long nsecs; // monotonic. for yal_stats_delta() the interval
+  unsigned int id; // heap id or heap base id
+  unsigned int kind; // as enum Yal_snap_kind
+  unsigned int xpermille; // yal_stats_delta() only: remote frees per 1000 frees into the heap
+
+  // thread
+  size_t allocs,reallocs,frees; // api calls
+  size_t magallocs,magfrees,getheaps,nogetheaps,munmaps,invalid_frees;
+  size_t ownerfrees,ownerbusy; // remote frees done in the owner heap or buffered
+
+  // heap
+  size_t heapfrees,xfrees,xfreebatch; // local frees, remote frees received and merged
+  size_t mapallocs,mapfrees,mmaps;
+  size_t trimregions,decommits,decombytes,bgtrims,memrelieves;
+};
+
+// fill up to cnt snaps, heaps first then threads. returns count filled
+extern size_t yal_stats_snap(struct yal_snap *snaps,size_t cnt);
+
+// per second rates of cur over prv for the same heap or thread into rate. returns interval in usec, 0 if not comparable
+extern size_t yal_stats_delta(const struct yal_snap *prv,const struct yal_snap *cur,struct yal_snap *rate);
+
+// binary event record as written with Yal_enable_rec, see rec.h
+enum Yal_rec_op { Yal_rec_none, Yal_rec_malloc, Yal_rec_calloc, Yal_rec_realloc, Yal_rec_align, Yal_rec_free, Yal_rec_count };
+#define Yal_rec_magic 0x31636572616c79ull // "ylarec1"
+struct yal_rec {
+  unsigned long long tick; // global order
+  unsigned long long ptr; // result, or block to free
+  unsigned long long arg; // realloc: org block, align: alignment
+  unsigned long long len;
+  unsigned int op,tid,tag,filler;
+};
+
+// write sampled heap profile in pprof heap_v2 text format to fd, or to a file if -1. returns stacks written. See Yal_enable_prof
+extern size_t yal_heapprofile(int fd);
+
 // diags and control
 enum Yal_diags { Yal_diag_none, Yal_diag_dblfree, Yal_diag_oom,Yal_diag_ill,Yal_diag_count };
-enum Yal_options { Yal_logmask, Yal_diag_enable, Yal_stats_enable, Yal_trace_enable, Yal_trace_name };
+enum Yal_options { Yal_logmask, Yal_diag_enable, Yal_stats_enable, Yal_trace_enable, Yal_trace_name, Yal_mem_limit };
 extern unsigned int yal_options(enum Yal_options opt,size_t arg1,size_t arg2);
 
 // provide callsite info
@@ -85,6 +159,35 @@ extern void * yal_realloc(void *p,size_t oldsize,size_t newsize,unsigned int tag
 extern void *yal_aligned_alloc(size_t align, size_t len,unsigned int tag);
 extern size_t yal_getsize(void *p,unsigned int tag);
 
+// allocate cnt blocks of size into ptrs, returns count allocated. free any set of blocks
+extern size_t yal_alloc_batch(size_t size,void **ptrs,size_t cnt,unsigned int tag);
+extern void yal_free_batch(void **ptrs,size_t cnt,unsigned int tag);
+
+// arena: bump allocate blocks that are released together by destroy. free() of an arena block is ignored, see Yal_arena_free
+typedef struct yal_arena yal_arena;
+extern yal_arena *yal_arena_create(size_t len,unsigned int tag);
+extern void *yal_arena_alloc(yal_arena *arena,size_t len,size_t align,unsigned int tag);
+extern void yal_arena_destroy(yal_arena *arena,unsigned int tag);
+
+// typed pool: fixed-size cells from slab regions of its own. free() works as well. destroy releases all cells
+enum Yal_pool_flags { Yal_pool_zero = 1 };
+typedef struct yal_pool yal_pool;
+extern yal_pool *yal_pool_create(size_t cellen,size_t align,unsigned int flags);
+extern void *yal_pool_alloc(yal_pool *pool,unsigned int tag);
+extern void yal_pool_free(yal_pool *pool,void *p,unsigned int tag);
+extern void yal_pool_destroy(yal_pool *pool,unsigned int tag);
+
+// release empty regions of all heaps (hid 0) or the given heap, keeping pad bytes resident per heap. Heaps in use are skipped
+// effort is the number of ageing rounds, 4 releases all. returns bytes released
+extern size_t yal_trim(unsigned int hid,unsigned int effort,size_t pad,unsigned int tag);
+
+// build slab regions for cnt blocks of size ahead of use and prefault them. returns bytes reserved. See also Yal_reserve_envvar
+extern size_t yal_reserve(size_t size,size_t cnt,unsigned int tag);
+
+// memory budget as yal_options(Yal_mem_limit,hard,soft) or Yal_memlimit_envvar. fn is called once per pressure round, outside locks
+typedef void yal_mem_pressure(size_t used,size_t limit,void *arg);
+extern void yal_mem_callback(yal_mem_pressure *fn,void *arg);
+
 #define Yal_sftag(file) (((file) << 16) | (__LINE__ & 0xffff)) // basic callsite identification
 
 // bump allocation from small static pool. Compatible with jemalloc.
@@ -0,0 +1,125 @@
+/* memlimit.h - process-wide memory budget
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   Mapped bytes are counted at each mmap and munmap of user memory and metadata, next to global_mapadd and global_mapdel
+   Address space reserved for realloc is not counted until grown into.
+   A mapping that would exceed the hard limit is not made. The heap first unmaps its empty regions, see mem_drop_() in free.h
+   If still over, the caller fails with ENOMEM via oom(), reported as a warning : not a fault of yalloc or the program
+   Crossing the soft limit upwards, or hitting the hard limit, starts a pressure round :
+   each heap at its next ageing tick flushes remote buffers and its magazine, and trims at effort_ages pace while above soft.
+   The callback set with yal_mem_callback() is then called once per round, outside heap locks, for the application to shed its caches.
+   Yal_memlimit_envvar=<hard>[,<soft>] in bytes, with k,m or g suffix. Soft defaults to Mem_soft_pct of hard. yal_options(Yal_mem_limit,hard,soft) idem.
+*/
+
+#define Logfile Fmemlimit
+
+static _Atomic size_t global_mapbytes;
+static size_t global_memhard,global_memsoft; // 0 if no limit
+static _Atomic ub4 global_pressure; // pressure round
+static _Atomic ub4 global_memcbround; // round for which callback was called
+static _Atomic ub4 global_memfails;
+static yal_mem_pressure * _Atomic global_memcb;
+static void * _Atomic global_memcbarg;
+
+static _Thread_local bool mem_overlimit; // last charge of this thread failed
+
+// count len to be mapped. 0 if over limit
+static bool mem_charge(size_t len)
+{
+  size_t use,hard = global_memhard;
+
+  use = Atomad(global_mapbytes,len,Monone) + len;
+  if (likely(hard == 0)) return 1;
+
+  if (unlikely(use > hard)) {
+    mem_overlimit = 1;
+    Atomsub(global_mapbytes,len,Monone);
+    Atomad(global_memfails,1,Monone);
+    Atomad(global_pressure,1,Morel);
+    ydbg1(Fln,Lnone,"mem limit %zu` reached at %zu` + %zu`",hard,use - len,len)
+    return 0;
+  }
+  if (use >= global_memsoft && use - len < global_memsoft) Atomad(global_pressure,1,Morel);
+  mem_overlimit = 0;
+  return 1;
+}
+
+static inline void mem_uncharge(size_t len)
+{
+  Atomsub(global_mapbytes,len,Monone);
+}
+
+// len would fit
+static inline bool mem_room(size_t len)
+{
+  return global_memhard == 0 || Atomget(global_mapbytes,Monone) + len <= global_memhard;
+}
+
+// above soft limit
+static inline bool mem_soft(void)
+{
+  return global_memsoft && Atomget(global_mapbytes,Monone) >= global_memsoft;
+}
+
+// called at heap ageing ticks, outside heap lock. Once per pressure round
+static void mem_tick(void)
+{
+  ub4 cbround,round = Atomget(global_pressure,Moacq);
+  yal_mem_pressure *cb;
+
+  if (likely(round == 0)) return;
+  cbround = Atomget(global_memcbround,Monone);
+  if (cbround == round || Cas(global_memcbround,cbround,round) == 0) return;
+
+  cb = Atomget(global_memcb,Moacq);
+  if (cb) cb(Atomget(global_mapbytes,Monone),global_memhard,Atomget(global_memcbarg,Monone));
+}
+
+static void mem_setlimit(size_t hard,size_t soft)
+{
+  if (soft == 0 || soft > hard) soft = hard / 100 * Mem_soft_pct;
+  global_memsoft = soft;
+  global_memhard = hard;
+  minidiag(Fln,Lnone,Vrb,0,"mem limit %zu` soft %zu`",hard,soft);
+}
+
+static cchar *mem_envlen(cchar *s,size_t *plen)
+{
+  size_t x = 0;
+
+  while (*s >= '0' && *s <= '9') x = x * 10 + (size_t)(*s++ - '0');
+  switch (*s | 0x20) {
+    case 'k': x <<= 10; s++; break;
+    case 'm': x <<= 20; s++; break;
+    case 'g': x <<= 30; s++; break;
+    default: break;
+  }
+  *plen = x;
+  return s;
+}
+
+// Yal_memlimit_envvar=<hard>[,<soft>]
+static void init_memlimit(void)
+{
+  cchar *envs = getenv(Yal_memlimit_envvar);
+  size_t hard,soft = 0;
+
+  if (envs == nil) return;
+
+  envs = mem_envlen(envs,&hard);
+  if (*envs == ',') envs = mem_envlen(envs + 1,&soft);
+  if (*envs) minidiag(Fln,Lnone,Warn,0,"%s: expected <hard>[,<soft>] at '%.16s'",Yal_memlimit_envvar,envs);
+  if (hard) mem_setlimit(hard,soft);
+}
+
+void yal_mem_callback(yal_mem_pressure *fn,void *arg)
+{
+  Atomset(global_memcbarg,arg,Morel);
+  Atomset(global_memcb,fn,Morel);
+}
+
+#undef Logfile
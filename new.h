@@ -1,7 +1,14 @@
 // new.h - yalloc header for c++ new / delete
 
+#if __cpp_aligned_new
+ #include <new> // std::align_val_t
+#endif
+
 extern "C" void *malloc(unsigned long);
+extern "C" void *aligned_alloc(unsigned long,unsigned long);
 extern "C" void free(void *);
+extern "C" void free_sized(void *,unsigned long);
+extern "C" void free_aligned_sized(void *,unsigned long,unsigned long);
 
 void * operator new(unsigned long size) {
   return malloc(size);
@@ -11,5 +18,26 @@ void * operator new[](unsigned long size) {
   return malloc(size);
 }
 
+#if __cpp_aligned_new
+void * operator new(unsigned long size,std::align_val_t align) {
+  return aligned_alloc((unsigned long)align,size);
+}
+
+void * operator new[](unsigned long size,std::align_val_t align) {
+  return aligned_alloc((unsigned long)align,size);
+}
+#endif
+
 void operator delete(void* ptr) { free(ptr); }
 void operator delete[](void* ptr) { free(ptr); }
+
+// sized : locate without directory lookup
+void operator delete(void* ptr,unsigned long size) { free_sized(ptr,size); }
+void operator delete[](void* ptr,unsigned long size) { free_sized(ptr,size); }
+
+#if __cpp_aligned_new
+void operator delete(void* ptr,std::align_val_t align) { free_aligned_sized(ptr,(unsigned long)align,0); }
+void operator delete[](void* ptr,std::align_val_t align) { free_aligned_sized(ptr,(unsigned long)align,0); }
+void operator delete(void* ptr,unsigned long size,std::align_val_t align) { free_aligned_sized(ptr,(unsigned long)align,size); }
+void operator delete[](void* ptr,unsigned long size,std::align_val_t align) { free_aligned_sized(ptr,(unsigned long)align,size); }
+#endif
@@ -76,6 +76,13 @@ Vis void osclose(int fd)
   close(fd);
 }
 
+ #include <stdio.h> // rename
+
+Vis int osrename(const char *from,const char *to)
+{
+  return rename(from,to);
+}
+
 Vis long osread(int fd,char *buf,size_t len)
 {
   ssize_t nn = read(fd,buf,len);
@@ -141,6 +148,25 @@ Vis unsigned int oswrite(int fd,const char *buf,size_t len,unsigned int fln)
   } while (1);
 }
 
+// as above for binary data, without checks. returns 0 on error
+Vis int osbwrite(int fd,const void *buf,size_t len)
+{
+  const char *p = buf;
+  ssize_t nw;
+
+  while (len) {
+    nw = write(fd,p,len);
+    if (nw < 0) {
+      if (errno == EINTR) continue;
+      return 0;
+    }
+    if (nw == 0) return 0;
+    p += nw;
+    len -= (size_t)nw;
+  }
+  return 1;
+}
+
 static const int reserve = 1;
 
 #if defined __unix__ || defined __HAIKU__ || (defined __APPLE__ && defined __MACH__)
@@ -175,6 +201,8 @@ Vis void *osmmap(size_t len)
   return adr;
 }
 
+Vis void *oshugemap(size_t len,unsigned int order,int hugetlb) { return osmmap(len); }
+
 #else
 
 #ifdef __FreeBSD__
@@ -210,21 +238,53 @@ Vis void *osmmap(size_t len)
 #endif
   return p;
 }
+
+// as osmmap, aligned to 1 << order. Request huge pages, either reserved or transparent
+Vis void *oshugemap(size_t len,unsigned int order,int hugetlb)
+{
+  size_t align = (size_t)1 << order;
+  size_t xlen = len + align;
+  char *p,*ap,*end;
+
+#ifdef MAP_HUGETLB
+  if (hugetlb && (len & (align - 1)) == 0) {
+    p = mmap(NULL,len,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANON | MAP_HUGETLB,-1,0);
+    if (p != MAP_FAILED) return p;
+  }
+#else
+  (void)hugetlb;
 #endif
 
-#ifndef __linux__
- #include <string.h> // memcpy
+  p = osmmap(xlen);
+  if (p == NULL) return p;
+
+  ap = (char *)(((size_t)p + align - 1) & ~(align - 1));
+  end = ap + len;
+  if (ap > p) munmap(p,(size_t)(ap - p));
+  if (end < p + xlen) munmap(end,(size_t)(p + xlen - end));
+
+#ifdef MADV_HUGEPAGE
+  madvise(ap,len,MADV_HUGEPAGE);
+#endif
+  return ap;
+}
 #endif
 
+#include <string.h> // memcpy
+
+// mremap covers a single mapping only. A block grown by osmgrow() can span two, when its head was moved in by osmremapto()
 Vis void *osmremap(void *p,size_t orglen,size_t ulen,size_t newlen)
 {
   void *np;
 #ifdef __linux__
   if (ulen == 0) return NULL; // won't occur
   np = mremap(p,orglen,newlen,MREMAP_MAYMOVE);
-  if (np == MAP_FAILED) {
-    return NULL;
-  }
+  if (np != MAP_FAILED) return np;
+  if (errno != EFAULT) return NULL;
+  np = osmmap(newlen);
+  if (np == NULL) return NULL;
+  memcpy(np,p,ulen < newlen ? ulen : newlen);
+  munmap(p,orglen);
 #else // :-(
   if (newlen) {
     np = osmmap(newlen);
@@ -240,6 +300,92 @@ Vis int osmunmap(void *p,size_t len)
   return munmap(p,len);
 }
 
+// release pages, keep mapping
+Vis int osdecommit(void *p,size_t len)
+{
+#if defined MADV_FREE
+  return madvise(p,len,MADV_FREE);
+#elif defined MADV_DONTNEED
+  return madvise(p,len,MADV_DONTNEED);
+#else
+  return 0;
+#endif
+}
+
+// idem, pages read as zero after. -1 if not available
+Vis int osdecommitz(void *p,size_t len)
+{
+#if defined MADV_DONTNEED
+  return madvise(p,len,MADV_DONTNEED);
+#else
+  return -1;
+#endif
+}
+
+// populate pages ahead of use. -1 if not available
+Vis int osprefault(void *p,size_t len)
+{
+#if defined MADV_POPULATE_WRITE
+  if (madvise(p,len,MADV_POPULATE_WRITE) == 0) return 0;
+#endif
+#if defined MADV_WILLNEED
+  return madvise(p,len,MADV_WILLNEED);
+#else
+  return -1;
+#endif
+}
+
+// map len + rsvlen of address space, accessible for len only
+Vis void *osmreserve(size_t len,size_t rsvlen)
+{
+#if defined MAP_NORESERVE && defined PROT_NONE
+  void *p = mmap(NULL,len + rsvlen,PROT_NONE,MAP_PRIVATE | MAP_ANON | MAP_NORESERVE,-1,0);
+
+  if (p == MAP_FAILED) return NULL;
+  if (len && mprotect(p,len,PROT_READ | PROT_WRITE)) {
+    munmap(p,len + rsvlen);
+    return NULL;
+  }
+  return p;
+#else
+  return NULL;
+#endif
+}
+
+// grow into the reservation directly after. Committed in place, as an unmapped tail could be taken by another thread's mmap
+Vis int osmgrow(void *p,size_t len,size_t newlen)
+{
+  return mprotect((char *)p + len,newlen - len,PROT_READ | PROT_WRITE);
+}
+
+// return to reserved, discarding contents
+Vis int osmuncommit(void *p,size_t len)
+{
+#if defined MAP_NORESERVE && defined MAP_FIXED
+  void *np = mmap(p,len,PROT_NONE,MAP_PRIVATE | MAP_ANON | MAP_NORESERVE | MAP_FIXED,-1,0);
+
+  return np == MAP_FAILED ? -1 : 0;
+#else
+  return -1;
+#endif
+}
+
+// move pages to np, replacing a reservation there. Zero-copy, linux only. Copied if p spans mappings, see osmremap()
+Vis void *osmremapto(void *p,size_t orglen,void *np,size_t newlen)
+{
+#if defined __linux__ && defined MREMAP_FIXED
+  void *ap = mremap(p,orglen,newlen,MREMAP_MAYMOVE | MREMAP_FIXED,np);
+
+  if (ap != MAP_FAILED) return ap;
+  if (errno != EFAULT || mprotect(np,newlen,PROT_READ | PROT_WRITE)) return NULL;
+  memcpy(np,p,orglen < newlen ? orglen : newlen);
+  munmap(p,orglen);
+  return np;
+#else
+  return NULL;
+#endif
+}
+
 Vis unsigned long ospid(void)
 {
   pid_t pid = getpid();
@@ -267,27 +413,113 @@ Vis void *osmmap(size_t len)
   return p;
 }
 
+Vis void *oshugemap(size_t len,unsigned int order,int hugetlb) { return osmmap(len); }
+
 Vis int osmunmap(void *p,size_t len)
 {
   return VirtualFree(p,len);
 }
 
+Vis int osdecommit(void *p,size_t len)
+{
+  return VirtualAlloc(p,len,MEM_RESET,PAGE_READWRITE) == nil;
+}
+
+Vis int osdecommitz(void *p,size_t len)
+{
+  if (VirtualFree(p,len,MEM_DECOMMIT) == 0) return -1;
+  return VirtualAlloc(p,len,MEM_COMMIT,PAGE_READWRITE) == nil;
+}
+
+Vis int osprefault(void *p,size_t len)
+{
+  WIN32_MEMORY_RANGE_ENTRY ent = { p, len };
+
+  return PrefetchVirtualMemory(GetCurrentProcess(),1,&ent,0) ? 0 : -1;
+}
+
+Vis void *osmreserve(size_t len,size_t rsvlen) { return nil; }
+Vis int osmgrow(void *p,size_t len,size_t newlen) { return -1; }
+Vis int osmuncommit(void *p,size_t len) { return -1; }
+Vis void *osmremapto(void *p,size_t orglen,void *np,size_t newlen) { return nil; }
+
 #else
 
 Vis unsigned int ospagesize(void) { return 4096; } // a too-low pagesize never harms
 
 Vis void *osmmap(size_t len) { return (void *)0; }
+Vis void *oshugemap(size_t len,unsigned int order,int hugetlb) { return (void *)0; }
 Vis void *osmremap(void *p,size_t orglen,size_t ulen,size_t newlen)
 {
   return p;
 }
 
 Vis int osmunmap(void *p,size_t len) { return 0; }
+Vis int osdecommit(void *p,size_t len) { return 0; }
+Vis int osdecommitz(void *p,size_t len) { return -1; }
+Vis int osprefault(void *p,size_t len) { return -1; }
+Vis void *osmreserve(size_t len,size_t rsvlen) { return (void *)0; }
+Vis int osmgrow(void *p,size_t len,size_t newlen) { return -1; }
+Vis int osmuncommit(void *p,size_t len) { return -1; }
+Vis void *osmremapto(void *p,size_t orglen,void *np,size_t newlen) { return (void *)0; }
 
   #error "no mmap"
 
 #endif // unix or windows
 
+#ifdef __linux__
+
+ #include <sys/syscall.h>
+
+// numa node of the current cpu, 0 if unknown
+Vis unsigned int osnode(void)
+{
+  unsigned int cpu,node = 0;
+
+#ifdef SYS_getcpu
+  if (syscall(SYS_getcpu,&cpu,&node,NULL)) return 0;
+#endif
+  return node;
+}
+
+// current cpu, 0 if unknown
+Vis unsigned int oscpu(void)
+{
+  unsigned int cpu = 0,node;
+
+#ifdef SYS_getcpu
+  if (syscall(SYS_getcpu,&cpu,&node,NULL)) return 0;
+#endif
+  return cpu;
+}
+
+Vis void osyield(void)
+{
+  syscall(SYS_sched_yield);
+}
+
+// prefer node for pages of p not yet touched
+Vis int osmbind(void *p,size_t len,unsigned int node)
+{
+#ifdef SYS_mbind
+  unsigned long mask[256 / (8 * sizeof(unsigned long))] = {0};
+  unsigned int bits = 8 * sizeof(unsigned long);
+
+  if (node >= 256) return -1;
+  mask[node / bits] = 1ul << (node % bits);
+  return (int)syscall(SYS_mbind,p,len,1 /* MPOL_PREFERRED */,mask,256ul,0u);
+#else
+  return -1;
+#endif
+}
+
+#else
+Vis unsigned int osnode(void) { return 0; }
+Vis unsigned int oscpu(void) { return 0; }
+Vis void osyield(void) { }
+Vis int osmbind(void *p,size_t len,unsigned int node) { return -1; }
+#endif
+
 #if defined (__linux__) || (defined (__APPLE__) && defined (__MACH__))
 
  #include <sys/time.h>
@@ -310,6 +542,35 @@ Vis int osrusage(struct osrusage *usg)
 
   return 0;
 }
+
+ #include <time.h>
+
+// monotonic seconds
+Vis unsigned long ostime(void)
+{
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC,&ts)) return 0;
+  return (unsigned long)ts.tv_sec;
+}
+
+// monotonic nanoseconds
+Vis unsigned long long osnsecs(void)
+{
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC,&ts)) return 0;
+  return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+Vis void ossleep(unsigned int msecs)
+{
+  struct timespec ts;
+
+  ts.tv_sec = msecs / 1000;
+  ts.tv_nsec = (long)(msecs % 1000) * 1000000l;
+  while (nanosleep(&ts,&ts) && errno == EINTR) ;
+}
 #else
 Vis int osrusage(struct osrusage *usg)
 {
@@ -318,4 +579,8 @@ Vis int osrusage(struct osrusage *usg)
   return 0;
 }
 
+Vis unsigned long ostime(void) { return 0; }
+Vis unsigned long long osnsecs(void) { return 0; }
+Vis void ossleep(unsigned int msecs) { }
+
 #endif
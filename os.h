@@ -18,13 +18,30 @@ struct osrusage {
 extern int osopen(const char *name,struct osstat *sp);
 extern int oscreate(const char *name);
 extern void osclose(int fd);
+extern int osrename(const char *from,const char *to);
 extern long osread(int fd,char *buf,size_t len);
 extern unsigned int oswrite(int fd,const char *buf,size_t len,unsigned int fln);
+extern int osbwrite(int fd,const void *buf,size_t len);
 
 extern void *osmmap(size_t len);
+extern void *oshugemap(size_t len,unsigned int order,int hugetlb);
 extern int osmunmap(void *p,size_t len);
+extern int osdecommit(void *p,size_t len);
+extern int osdecommitz(void *p,size_t len);
+extern int osprefault(void *p,size_t len);
 extern void *osmremap(void *p,size_t orglen,size_t ulen,size_t newlen);
+extern void *osmreserve(size_t len,size_t rsvlen);
+extern int osmgrow(void *p,size_t len,size_t newlen);
+extern int osmuncommit(void *p,size_t len);
+extern void *osmremapto(void *p,size_t orglen,void *np,size_t newlen);
+extern unsigned int osnode(void);
+extern unsigned int oscpu(void);
+extern void osyield(void);
+extern int osmbind(void *p,size_t len,unsigned int node);
 extern unsigned int ospagesize(void);
 extern unsigned long ospid(void);
 
 extern int osrusage(struct osrusage *usg);
+extern unsigned long ostime(void);
+extern unsigned long long osnsecs(void);
+extern void ossleep(unsigned int msecs);
@@ -0,0 +1,234 @@
+/* pool.h - typed fixed-size object pools
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   A pool has a private heap whose slab regions all have the pool's cel len, at pseudo-class Pool_clas outside the class lists.
+   Alloc and free go straight to the slab cells under the pool heap's lock, without size class lookup or magazine.
+   The pool heap is never taken by a thread, so free() from any thread is remote. It locks the pool heap instead of buffering.
+   Cel state is kept as for other slabs, thus double and invalid free are detected. Stats show up per pool heap.
+   Destroy unlists all regions at once and keeps them with the heap, for the next pool.
+*/
+
+#define Logfile Fpool
+
+#define Pool_clas Clascnt // beyond class lists, cannot be selected by size
+
+struct st_pool {
+  heap *hb;
+  region *regs[Poolregs];
+  ub4 regcnt,cur;
+  ub4 cellen,align,flags;
+  ub4 id;
+};
+typedef struct st_pool pool;
+
+static heap * _Atomic global_poolheaps[Poolheaps]; // of destroyed pools
+static _Atomic ub4 global_poolid;
+
+static void pool_lock(heap *hb)
+{
+  ub4 zero = 0,iter = 0;
+  bool didcas = Cas(hb->lock,zero,1);
+
+  while (didcas == 0) { // held for one alloc or free
+    if ((++iter & 0x3f) == 0) osyield();
+    else Pause
+    zero = 0;
+    didcas = Cas(hb->lock,zero,1);
+  }
+  vg_drd_wlock_acq(hb)
+}
+
+static void pool_unlock(heap *hb)
+{
+  Atomset(hb->lock,0,Morel);
+  vg_drd_wlock_rel(hb)
+}
+
+// free cel of pool region. pool heap locked. returns cel len or 0 on error
+static ub4 pool_frecel(heapdesc *hd,heap *hb,region *reg,size_t ip,ub4 tag,enum Loc loc)
+{
+  ub4 bincnt;
+
+  if (unlikely(hb->pool == nil || reg->hb != hb || reg->aged)) {
+    hd->stat.invalid_frees++;
+    error(loc,"ptr %zx in region %.01llu of destroyed pool tag %.01u",ip,reg->uid,tag)
+    return 0;
+  }
+  bincnt = slab_free(hb,reg,ip,reg->cellen,reg->celcnt,tag); // checks state
+  if (unlikely(bincnt == 0)) return 0;
+  return reg->cellen;
+}
+
+// free() or realloc() of a pool cel, as found in the global dir
+static ub4 pool_rfree(heapdesc *hd,region *reg,size_t ip,ub4 tag,enum Loc loc)
+{
+  heap *hb = reg->hb;
+  ub4 len;
+
+  ytrace(1,hd,loc,tag,0,"pool ptr+%zx len %u",ip,reg->cellen)
+  pool_lock(hb);
+  len = pool_frecel(hd,hb,reg,ip,tag,loc);
+  pool_unlock(hb);
+  return len;
+}
+
+static heap *pool_heap(heapdesc *hd)
+{
+  heap *hb;
+  ub4 i,zero;
+
+  for (i = 0; i < Poolheaps; i++) {
+    hb = Atomget(global_poolheaps[i],Moacq);
+    if (hb == nil || Cas(global_poolheaps[i],hb,nil) == 0) continue;
+    zero = 0;
+    if (Cas(hb->lock,zero,1)) { vg_drd_wlock_acq(hb) hd->stat.useheaps++; return hb; }
+  }
+  hb = newheap(hd,Lalloc,Fln); // locked
+  if (hb == nil) return nil;
+  hb->poolheap = 1; // never taken by heap_new()
+  hd->stat.newheaps++;
+  return hb;
+}
+
+yal_pool *yal_pool_create(size_t cellen,size_t align,unsigned int flags)
+{
+  heapdesc *hd = getheapdesc(Lalloc);
+  heap *hb;
+  pool *pl;
+
+  if (align < Stdalign) align = Stdalign;
+  if (unlikely(align & (align - 1)) || align > Pagesize || cellen == 0 || cellen > Pool_maxlen) {
+    error(Lalloc,"pool len %zu align %zu not supported",cellen,align)
+    return nil;
+  }
+
+  pl = osmmap(sizeof(pool));
+  if (pl == nil) return nil;
+
+  hb = pool_heap(hd);
+  if (hb == nil) { osmunmap(pl,sizeof(pool)); return nil; }
+
+  pl->hb = hb;
+  pl->cellen = (ub4)doalign8(cellen,align);
+  pl->align = (ub4)align;
+  pl->flags = flags;
+  pl->id = Atomad(global_poolid,1,Monone) + 1;
+  hb->pool = pl;
+  pool_unlock(hb);
+
+  ytrace(0,hd,Lalloc,0,0,"pool %u len %u heap %u",pl->id,pl->cellen,hb->id)
+  return (yal_pool *)pl;
+}
+
+// current region full: any with space, else a new one
+static Cold region *pool_region(pool *pl)
+{
+  heap *hb = pl->hb;
+  region *reg;
+  ub4 r,cnt = pl->regcnt;
+
+  for (r = 0; r < cnt; r++) {
+    reg = pl->regs[r];
+    if (reg->binpos || reg->inipos < reg->celcnt) { pl->cur = r; return reg; }
+  }
+  if (cnt == Poolregs) {
+    error(Lalloc,"pool %u full at %u regions",pl->id,cnt)
+    return nil;
+  }
+  reg = newslab(hb,pl->cellen,Pool_clas,cnt);
+  if (reg == nil) return nil;
+  pl->regs[cnt] = reg;
+  pl->regcnt = cnt + 1;
+  pl->cur = cnt;
+  return reg;
+}
+
+Hot void *yal_pool_alloc(yal_pool *ypl,unsigned int tag)
+{
+  pool *pl = (pool *)ypl;
+  heap *hb = pl->hb;
+  region *reg;
+  void *p = nil;
+
+  pool_lock(hb);
+  if (likely(pl->regcnt != 0)) {
+    reg = pl->regs[pl->cur];
+    p = slab_malloc(reg,pl->cellen,tag);
+  }
+  if (unlikely(p == nil)) {
+    reg = pool_region(pl);
+    if (reg) p = slab_malloc(reg,pl->cellen,tag);
+  }
+  ystats(hb->stat.allocs)
+  pool_unlock(hb);
+
+  if (unlikely(p == nil)) return oom(nil,Fln,Lalloc,pl->cellen,0);
+  if (pl->flags & Yal_pool_zero) memset(p,0,pl->cellen);
+  return p;
+}
+
+void yal_pool_free(yal_pool *ypl,void *p,unsigned int tag)
+{
+  heapdesc *hd = getheapdesc(Lfree);
+  pool *pl = (pool *)ypl;
+  heap *hb = pl->hb;
+  xregion *xreg;
+  size_t ip = (size_t)p;
+
+  if (unlikely(p == nil)) { ystats(hd->stat.freenils) return; }
+
+  pool_lock(hb);
+  xreg = findregion(hb,ip,Lfree);
+  if (likely(xreg != nil)) pool_frecel(hd,hb,(region *)xreg,ip,tag,Lfree); // -V1027 PVS unrelated obj cast
+  pool_unlock(hb);
+  if (xreg == nil) {
+    hd->stat.invalid_frees++;
+    error2(Lfree,Fln,"ptr %zx not in pool %u tag %.01u",ip,pl->id,tag)
+  }
+}
+
+// release all cels. Regions are recycled as trim does, without class list
+void yal_pool_destroy(yal_pool *ypl,unsigned int Unused tag)
+{
+  heapdesc Unused *hd = getheapdesc(Lfree);
+  pool *pl = (pool *)ypl;
+  heap *hb = pl->hb;
+  region *reg,*preg;
+  ub4 r,i,order;
+  heap *nohb;
+
+  ytrace(0,hd,Lfree,tag,0,"pool %u destroy %u regions",pl->id,pl->regcnt)
+
+  pool_lock(hb);
+  for (r = 0; r < pl->regcnt; r++) {
+    reg = pl->regs[r];
+    setregion(hb,(xregion *)reg,reg->user,reg->len,0,Lfree,Fln);
+    reg->dirty = max(reg->dirty,(size_t)reg->inipos * reg->cellen);
+    reg->binpos = reg->inipos; // as empty
+    reg->inuse = 0;
+    reg->age = 2;
+    reg->aged = 1;
+
+    order = reg->order;
+    preg = hb->freeregs[order];
+    hb->freeregs[order] = reg;
+    reg->frenxt = preg;
+    reg->freprv = nil;
+    if (preg) preg->freprv = reg;
+    hb->stat.trimregions[1]++;
+  }
+  hb->pool = nil;
+  pool_unlock(hb);
+  osmunmap(pl,sizeof(pool));
+
+  for (i = 0; i < Poolheaps; i++) { // else left for trim
+    nohb = nil;
+    if (Atomget(global_poolheaps[i],Monone) == nil && Cas(global_poolheaps[i],nohb,hb)) return;
+  }
+}
+
+#undef Logfile
@@ -0,0 +1,278 @@
+/* prof.h - sampling heap profiler
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   Each thread counts down allocated bytes to its next sample, at geometrically distributed intervals of mean Prof_rate, as in tcmalloc.
+   A sampled block gets a backtrace, aggregated per distinct stack, and an entry in a global table by address.
+   A counting filter by address lets free() skip the table lookup for the unsampled common case. Realloc ends a sample.
+   yal_heapprofile() writes live and cumulative samples per stack in the gperftools heap_v2 text format, as read by pprof.
+   Tables are mapped at first sample. A full table drops samples, counted in the profile header.
+*/
+
+#define Logfile Fprof
+
+#ifndef Backtrace
+ #error "Yal_enable_prof needs backtrace(), see build.sh -b"
+#endif
+
+static_assert((Prof_samples & (Prof_samples - 1)) == 0,"Prof_samples pwr2");
+static_assert((Prof_stacks & (Prof_stacks - 1)) == 0,"Prof_stacks pwr2");
+
+#define Prof_map 0x4000 // filter counters
+#define Prof_probe 16
+
+struct profstack {
+  _Atomic size_t hash; // 0 free
+  _Atomic ub4 depth; // 0 while being filled
+  ub4 filler;
+  _Atomic size_t allocs,bytes,lives,livebytes;
+  size_t pcs[Prof_depth];
+};
+
+struct profsample {
+  _Atomic size_t ip; // 0 free
+  size_t len;
+  ub4 stk;
+  ub4 filler;
+};
+
+struct profmem {
+  struct profstack stacks[Prof_stacks];
+  struct profsample samples[Prof_samples];
+};
+
+static struct profmem * _Atomic global_prof;
+static _Atomic ub2 global_profmap[Prof_map];
+static size_t global_profrate = Prof_rate; // from Yal_prof_envvar
+static _Atomic size_t global_profdrops;
+
+static inline ub4 prof_hash(size_t ip)
+{
+  return (ub4)((ip >> 4) ^ (ip >> 20));
+}
+
+// bytes until next sample: -ln(u) * rate, with ln from a quadratic log2 of the mantissa
+static long prof_next(heapdesc *hd,size_t rate)
+{
+  ub8 x = hd->profrnd;
+  ub8 bits;
+  double q,m,lg;
+  long e;
+
+  if (x == 0) x = ((size_t)hd | 1) * 0x9e3779b97f4a7c15ul;
+  x ^= x << 13; x ^= x >> 7; x ^= x << 17; // xorshift64
+  hd->profrnd = x;
+
+  q = (double)((x >> 11) + 1) * 0x1p-53; // (0,1]
+  memcpy(&bits,&q,sizeof(bits));
+  e = (long)((bits >> 52) & 0x7ff) - 1023;
+  bits = (bits & 0xfffffffffffffull) | 0x3ff0000000000000ull;
+  memcpy(&m,&bits,sizeof(m));
+  m -= 1.0;
+  lg = (double)e + m * (1.3466 - 0.3466 * m); // log2(q) <= 0
+
+  return (long)(-lg * 0.6931471805599453 * (double)rate) + 1;
+}
+
+static struct profmem *prof_mem(void)
+{
+  struct profmem *pm = Atomget(global_prof,Moacq),*org = nil;
+
+  if (likely(pm != nil)) return pm;
+  pm = osmmap(sizeof(struct profmem));
+  if (pm == nil) return nil;
+  if (Cas(global_prof,org,pm)) return pm;
+  osmunmap(pm,sizeof(struct profmem));
+  return org;
+}
+
+// find or add stack
+static struct profstack *prof_stack(struct profmem *pm,size_t *pcs,ub4 depth,ub4 *pidx)
+{
+  struct profstack *sp;
+  size_t h = 0xcbf29ce484222325ul,org;
+  ub4 i,d,probe;
+
+  for (d = 0; d < depth; d++) h = (h ^ pcs[d]) * 0x100000001b3ul;
+  h |= 1;
+
+  for (probe = 0; probe < Prof_probe; probe++) {
+    i = (ub4)(h + probe) & (Prof_stacks - 1);
+    sp = pm->stacks + i;
+    org = Atomget(sp->hash,Moacq);
+    if (org == 0) {
+      if (Cas(sp->hash,org,h)) {
+        memcpy(sp->pcs,pcs,depth * sizeof(size_t));
+        Atomset(sp->depth,depth,Morel);
+        *pidx = i;
+        return sp;
+      }
+    }
+    if (org == h && Atomget(sp->depth,Moacq) == depth && memcmp(sp->pcs,pcs,depth * sizeof(size_t)) == 0) {
+      *pidx = i;
+      return sp;
+    }
+  }
+  return nil;
+}
+
+// end sample at slot
+static void prof_end(struct profmem *pm,struct profsample *ps,size_t ip)
+{
+  struct profstack *sp = pm->stacks + ps->stk;
+  size_t len = ps->len;
+
+  if (Cas(ps->ip,ip,0) == 0) return;
+  Atomsub(sp->lives,1,Moacqrel);
+  Atomsub(sp->livebytes,len,Moacqrel);
+  Atomsub(global_profmap[prof_hash(ip) & (Prof_map - 1)],1,Moacqrel);
+}
+
+static Cold void prof_sample(heapdesc *hd,void *p,size_t len)
+{
+  struct profmem *pm;
+  struct profstack *sp;
+  struct profsample *ps;
+  void *bt[Prof_depth + 1];
+  size_t pcs[Prof_depth];
+  size_t ip = (size_t)p,org;
+  size_t rate = global_profrate;
+  ub4 h,i,d,depth,stk = 0,probe;
+
+  if (rate == 0) { hd->profleft = LONG_MAX; return; }
+  hd->profleft = prof_next(hd,rate);
+
+  if (p == nil || len == 0 || hd->inprof) return;
+  hd->inprof = 1; // backtrace() may allocate at first use
+
+  pm = prof_mem();
+  if (pm == nil) { hd->inprof = 0; return; }
+
+  depth = (ub4)backtrace(bt,Prof_depth + 1);
+  depth = depth > 1 ? depth - 1 : 0; // skip self
+  for (d = 0; d < depth; d++) pcs[d] = (size_t)bt[d + 1];
+
+  sp = prof_stack(pm,pcs,depth,&stk);
+  if (sp == nil) { Atomad(global_profdrops,1,Monone); hd->inprof = 0; return; }
+
+  Atomad(sp->allocs,1,Moacqrel);
+  Atomad(sp->bytes,len,Moacqrel);
+
+  h = prof_hash(ip);
+  for (probe = 0; probe < Prof_probe; probe++) {
+    i = (h + probe) & (Prof_samples - 1);
+    ps = pm->samples + i;
+    org = Atomget(ps->ip,Moacq);
+    if (org == ip) prof_end(pm,ps,ip); // freed unseen e.g. via realloc
+    org = 0;
+    if (Cas(ps->ip,org,ip)) {
+      ps->len = len;
+      ps->stk = stk;
+      Atomad(sp->lives,1,Moacqrel);
+      Atomad(sp->livebytes,len,Moacqrel);
+      Atomad(global_profmap[h & (Prof_map - 1)],1,Morel);
+      hd->inprof = 0;
+      return;
+    }
+  }
+  Atomad(global_profdrops,1,Monone);
+  hd->inprof = 0;
+}
+
+static Cold void prof_remove(size_t ip)
+{
+  struct profmem *pm = Atomget(global_prof,Moacq);
+  struct profsample *ps;
+  ub4 h = prof_hash(ip);
+  ub4 probe;
+
+  if (pm == nil) return;
+  for (probe = 0; probe < Prof_probe; probe++) {
+    ps = pm->samples + ((h + probe) & (Prof_samples - 1));
+    if (Atomget(ps->ip,Moacq) == ip) { prof_end(pm,ps,ip); return; }
+  }
+}
+
+static Hot inline void prof_alloc(heapdesc *hd,void *p,size_t len)
+{
+  long left = hd->profleft - (long)len;
+
+  hd->profleft = left;
+  if (unlikely(left < 0)) prof_sample(hd,p,len);
+}
+
+static Hot inline void prof_free(void *p)
+{
+  size_t ip = (size_t)p;
+
+  if (unlikely(Atomget(global_profmap[prof_hash(ip) & (Prof_map - 1)],Monone) != 0)) prof_remove(ip);
+}
+
+// Yal_prof_envvar=<rate>, 0 disables
+static void init_prof(void)
+{
+  cchar *envs = getenv(Yal_prof_envvar);
+
+  if (envs) global_profrate = atoul(envs);
+}
+
+// write profile to fd, or to Yal_prof_file-<pid>.heap if -1. returns stacks written
+size_t Cold yal_heapprofile(int fd)
+{
+  struct profmem *pm = Atomget(global_prof,Moacq);
+  struct profstack *sp;
+  char buf[4096];
+  ub4 pos = 0,len = 4000;
+  ub4 i,d,depth;
+  size_t lives = 0,livebytes = 0,allocs = 0,bytes = 0,cnt = 0;
+  unsigned long pid = Atomget(global_pid,Monone);
+  bool didopen = 0;
+  long n;
+  int mfd;
+
+  if (fd == -1) {
+    snprintf_mini(buf,0,255,"%.64s-%lu.heap",Yal_prof_file,pid);
+    fd = oscreate(buf);
+    if (fd == -1) return 0;
+    didopen = 1;
+  }
+
+  if (pm) {
+    for (i = 0; i < Prof_stacks; i++) {
+      sp = pm->stacks + i;
+      if (Atomget(sp->depth,Moacq) == 0) continue;
+      lives += Atomget(sp->lives,Monone); livebytes += Atomget(sp->livebytes,Monone);
+      allocs += Atomget(sp->allocs,Monone); bytes += Atomget(sp->bytes,Monone);
+    }
+  }
+  pos = snprintf_mini(buf,0,len,"heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",lives,livebytes,allocs,bytes,global_profrate);
+
+  for (i = 0; pm && i < Prof_stacks; i++) {
+    sp = pm->stacks + i;
+    depth = Atomget(sp->depth,Moacq);
+    if (depth == 0) continue;
+    pos += snprintf_mini(buf,pos,len,"%zu: %zu [%zu: %zu] @",Atomget(sp->lives,Monone),Atomget(sp->livebytes,Monone),Atomget(sp->allocs,Monone),Atomget(sp->bytes,Monone));
+    for (d = 0; d < depth; d++) pos += snprintf_mini(buf,pos,len," 0x%zx",sp->pcs[d]);
+    buf[pos++] = '\n';
+    cnt++;
+    if (pos > 3000) { oswrite(fd,buf,pos,Fln); pos = 0; }
+  }
+  n = (long)Atomget(global_profdrops,Monone);
+  if (n) pos += snprintf_mini(buf,pos,len,"# dropped %ld samples\n",n);
+
+  pos += snprintf_mini(buf,pos,len,"\nMAPPED_LIBRARIES:\n");
+  oswrite(fd,buf,pos,Fln);
+
+  mfd = osopen("/proc/self/maps",nil);
+  if (mfd != -1) {
+    while ( (n = osread(mfd,buf,sizeof(buf))) > 0) oswrite(fd,buf,(size_t)n,Fln);
+    osclose(mfd);
+  }
+  if (didopen) osclose(fd);
+  return cnt;
+}
+
+#undef Logfile
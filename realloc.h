@@ -30,6 +30,78 @@ static void real_copy(void *p,void *np,size_t ulen,size_t alen)
   memcpy(np,p,len);
 }
 
+#if Yal_mmap_reserve
+/* resize within reserved address space, or move pages into a new reservation. local only
+   returns new base or 0 if not done. An unused reservation is then released for mremap
+ */
+static size_t real_reserve(heap Unused *hb,mpregion *reg,size_t newlen)
+{
+  size_t ip = reg->user;
+  size_t len = reg->len;
+  size_t rsvlen = reg->rsvlen;
+  size_t nrsv;
+  void *np;
+
+  if (newlen <= len) { // shrink
+    if (rsvlen == 0) return 0;
+    if (newlen < len && osmuncommit((void *)(ip + newlen),len - newlen)) return 0;
+    mem_uncharge(len - newlen);
+    reg->len = newlen;
+    reg->rsvlen = rsvlen + len - newlen;
+    return ip;
+  }
+
+  if (newlen <= len + rsvlen) { // grow in place
+    if (mem_charge(newlen - len)) {
+      if (osmgrow((void *)ip,len,newlen) == 0) {
+        reg->len = newlen;
+        reg->rsvlen = len + rsvlen - newlen;
+        return ip;
+      }
+      mem_uncharge(newlen - len);
+    }
+  } else if (newlen >= (1ul << Mmap_reserve_order)) { // move into new reservation
+    nrsv = mmap_rsvlen(newlen);
+    np = osmreserve(0,newlen + nrsv);
+    if (np && mem_charge(newlen - len) == 0) {
+      osmunmap(np,newlen + nrsv);
+      np = nil;
+    }
+    if (np) {
+      if (osmremapto((void *)ip,len,np,newlen)) {
+        if (rsvlen) osmunmap((void *)(ip + len),rsvlen);
+        reg->user = (size_t)np;
+        reg->len = newlen;
+        reg->rsvlen = nrsv;
+        ystats(hb->stat.mreserves)
+        return (size_t)np;
+      }
+      mem_uncharge(newlen - len);
+      osmunmap(np,newlen + nrsv);
+    }
+  }
+
+  if (rsvlen) { // let mremap handle it
+    osmunmap((void *)(ip + len),rsvlen);
+    reg->rsvlen = 0;
+  }
+  return 0;
+}
+#endif
+
+// mremap, counting the size change for the memory limit
+static size_t real_remap(size_t ip,size_t len,size_t ulen,size_t newlen)
+{
+  size_t nip;
+
+  if (newlen > len && mem_charge(newlen - len) == 0) return 0;
+  nip = (size_t)osmremap((void *)ip,len,ulen,newlen);
+  if (nip == 0) {
+    if (newlen > len) mem_uncharge(newlen - len);
+  } else if (newlen < len) mem_uncharge(len - newlen);
+  return nip;
+}
+
 static size_t real_mmap(heapdesc *hd,heap *hb,bool local,mpregion *reg,size_t newlen,size_t newulen)
 {
   xregion *xreg = (xregion *)reg;
@@ -53,9 +125,13 @@ static size_t real_mmap(heapdesc *hd,heap *hb,bool local,mpregion *reg,size_t ne
 
     if (local) {
 
-      np = osmremap((void *)ip,oldlen,ulen,newlen + align);
-      nip = (size_t)np;
+      nip = 0;
+#if Yal_mmap_reserve
+      nip = real_reserve(hb,reg,newlen + align);
+#endif
+      if (nip == 0) nip = real_remap(ip,oldlen,ulen,newlen + align);
       if (nip == 0) return 0;
+      np = (void *)nip;
       ycheck(0,Lreal,nip & Pagesize1,"mmap %zx not page aligned",nip)
 
       reg->len = newlen + align;
@@ -63,10 +139,12 @@ static size_t real_mmap(heapdesc *hd,heap *hb,bool local,mpregion *reg,size_t ne
 
       naip = nip + align;
       if (nip == ip) {
+        ystats(hb->stat.mrealinplace)
         vg_mem_noaccess(np,newlen + align)
         vg_mem_def((void *)naip,newulen)
-        return ip;
+        return naip;
       }
+      ystats(hb->stat.mrealmoves)
 
       setregion(hb,xreg,ip,Pagesize,0,Lreal,Fln);
       setregion(hb,xreg,aip,Pagesize,0,Lreal,Fln);
@@ -88,6 +166,7 @@ static size_t real_mmap(heapdesc *hd,heap *hb,bool local,mpregion *reg,size_t ne
 
       real_copy((void *)aip,(void *)nip,newulen,ulen);
       free_mmap(hd,nil,reg,ip,0,Lreal,Fln,Fln);
+      ystats(hb->stat.mrealcopies)
       vg_mem_def((void *)nip,newulen)
       return nip;
     }
@@ -98,16 +177,22 @@ static size_t real_mmap(heapdesc *hd,heap *hb,bool local,mpregion *reg,size_t ne
   ydbg2(Fln,Lreal,"reg %u.%u remap %zu -> %zu,%zu local %u",hb->id,reg->id,orglen,newlen,newulen,local)
 
   if (local) {
-    np = osmremap((void *)ip,reg->len,ulen,newlen);
-    nip = (size_t)np;
+    nip = 0;
+#if Yal_mmap_reserve
+    nip = real_reserve(hb,reg,newlen);
+#endif
+    if (nip == 0) nip = real_remap(ip,reg->len,ulen,newlen);
     if (nip == 0) return 0;
+    np = (void *)nip;
     reg->len = newlen;
     reg->ulen = newulen;
     if (nip == ip) {
+      ystats(hb->stat.mrealinplace)
       vg_mem_noaccess(np,newlen)
       vg_mem_def(np,newulen)
       return ip;
     }
+    ystats(hb->stat.mrealmoves)
     ycheck(0,Lreal,nip & Pagesize1,"mmap %zx not page aligned",nip)
     setregion(hb,xreg,ip,Pagesize,0,Lreal,Fln);
     setregion(hb,xreg,nip,Pagesize,1,Lreal,Fln);
@@ -119,6 +204,7 @@ static size_t real_mmap(heapdesc *hd,heap *hb,bool local,mpregion *reg,size_t ne
     ycheck(0,Lreal,nip & Pagesize1,"mmap %zx not page aligned",nip)
     real_copy((void *)ip,np,newulen,ulen);
     free_mmap(hd,nil,reg,ip,oldlen,Lreal,Fln,Fln);
+    ystats(hb->stat.mrealcopies)
   }
 
   vg_mem_noaccess(np,newlen)
@@ -138,7 +224,7 @@ static void *real_heap(heapdesc *hd,heap *hb,void *p,size_t alen,size_t newulen,
   enum Rtype typ;
   void *np;
   size_t aip,ip = (size_t)p;
-  size_t ulen,flen,newlen = newulen;
+  size_t ulen,flen,hlen,newlen = newulen;
   ub4 cellen;
   bool local;
 
@@ -232,14 +318,30 @@ static void *real_heap(heapdesc *hd,heap *hb,void *p,size_t alen,size_t newulen,
     newlen = doalign8(newulen,Stdalign);
 
     if (likely(typ == Rslab)) {
-      np = alloc_heap(hd,hb,newulen,1,Lreal,tag);
-      if (unlikely(np == nil)) return (void *)__LINE__;
       reg = (region *)xreg; // -V1027 PVS unrelated obj cast
       openreg(reg)
       cellen = reg->cellen;
+
+      if (Realloc_runmax > 1 && cellen > Cel_nolen && local) { // into following never-allocated cels
+        if (slab_grow(reg,pi->cel,cellen,newulen)) {
+          ystats(hb->stat.reallocruns)
+          closereg(reg)
+          vg_mem_def(p,newulen)
+          pi->fln = Fln;
+          return p;
+        }
+      }
+
+      // headroom for small blocks reallocated before. Larger ones store their len
+      hlen = newulen + (newulen >> 2);
+      if (Realloc_headroom == 0 || reg->real == 0 || hlen > Cel_nolen / 2) hlen = newulen; // class len stays within Cel_nolen
+
+      np = alloc_heap(hd,hb,hlen,1,Lreal,tag);
+      if (unlikely(np == nil)) return (void *)__LINE__;
+      openreg(reg) // newregion may close it
       ulen = cellen > Cel_nolen ? slab_getlen(reg,pi->cel,cellen) : cellen;
       ycheck((void *)__LINE__,Lreal,ulen == 0,"region %u cel %u ulen 0 for %u",reg->id,pi->cel,cellen)
-      ycheck((void *)__LINE__,Lreal,ulen > cellen,"region %u cel %u ulen %zu above %u",reg->id,pi->cel,ulen,cellen)
+      ycheck((void *)__LINE__,Lreal,ulen > alen,"region %u cel %u ulen %zu above %zu",reg->id,pi->cel,ulen,alen)
       real_copy(p,np,ulen,newulen);
 
       if (likely(local != 0)) {
@@ -253,6 +355,10 @@ static void *real_heap(heapdesc *hd,heap *hb,void *p,size_t alen,size_t newulen,
         error(Lreal,"invalid free(%zx) tag %.01u",ip,tag)
         return (void *)__LINE__;
       } else {
+#if Yal_enable_pool
+        if (unlikely(reg->hb->pool != nil)) flen = pool_rfree(hd,reg,ip,tag,Lreal);
+        else
+#endif
         flen = slab_free_rheap(hd,hb,reg,ip,tag,Lreal);
         if (likely(flen != 0)) {
           closereg(reg)
@@ -285,7 +391,7 @@ static void *real_heap(heapdesc *hd,heap *hb,void *p,size_t alen,size_t newulen,
 }
 
 // main realloc().
-static void *yrealloc(void *p,size_t oldlen,size_t newlen,ub4 tag)
+static void *yrealloc_(void *p,size_t oldlen,size_t newlen,ub4 tag)
 {
   heapdesc *hd = getheapdesc(Lreal);
   heap *hb;
@@ -298,6 +404,7 @@ static void *yrealloc(void *p,size_t oldlen,size_t newlen,ub4 tag)
   enum Tidstate tidstate = hd->tidstate;
 
   ypush(hd,Lreal | Lapi,Fln)
+  ystats(hd->stat.apireallocs)
 
   ytrace(0,hd,Lreal,tag,0,"+ realloc(%zx,%zu)",(size_t)p,newlen)
 
@@ -307,6 +414,7 @@ static void *yrealloc(void *p,size_t oldlen,size_t newlen,ub4 tag)
     ypush(hd,Lreal | Lapi,Fln)
     return np;
   }
+  prof_free(p); // sample ends, new block not sampled
 
   // realloc(p,0) = free(p) - deprecated since c17. see https://open-std.org/JTC1/SC22/WG14/www/docs/n2396.htm#dr_400
   if (unlikely(newlen == 0)) {
@@ -340,6 +448,7 @@ static void *yrealloc(void *p,size_t oldlen,size_t newlen,ub4 tag)
 #endif
     } else {
       didcas = 1;
+      priv_enter(hb)
     }
     if (unlikely(didcas == 0)) {
       hb = hd->hb = heap_new(hd,Lreal,Fln);
@@ -382,7 +491,7 @@ static void *yrealloc(void *p,size_t oldlen,size_t newlen,ub4 tag)
   if (tidstate != Ts_private) {
     Atomset(hb->lock,0,Morel);
     vg_drd_wlock_rel(hb)
-  }
+  } else priv_leave(hb)
 
   ip = (size_t)np;
 
@@ -396,4 +505,16 @@ static void *yrealloc(void *p,size_t oldlen,size_t newlen,ub4 tag)
   error2(Lreal,fln,"realloc(%zx,%zu) failed",ip,newlen)
   return nil;
 }
+
+static inline void *yrealloc(void *p,size_t oldlen,size_t newlen,ub4 tag)
+{
+  Latstart
+  void *np = yrealloc_(p,oldlen,newlen,tag);
+#if Yal_enable_lat
+  heapdesc *hd = getheapdesc(Lreal);
+
+  Latend(hd->stat,Yal_lat_realloc)
+#endif
+  return np;
+}
 #undef Logfile
@@ -0,0 +1,130 @@
+/* rec.h - binary allocation event recording
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   Each API call appends a fixed-size struct yal_rec to a ring owned by the calling thread's heap descriptor, without lock or format.
+   A full ring is written to the file in one write by its owner, via osbwrite() as oswrite() is for text. Remaining records are written at exit.
+   A global tick orders the records of all threads, for replay by test p <file>.
+   The file starts with a header record of op Yal_rec_none, with ptr Yal_rec_magic and arg the record size.
+*/
+
+#define Logfile Frec
+
+static_assert(sizeof(struct yal_rec) == 48,"yal_rec size");
+
+struct recring {
+  ub4 pos;
+  ub4 filler;
+  struct yal_rec recs[Rec_len];
+};
+
+static int global_recfd = -1; // enabled if not -1
+static _Atomic ub8 global_rectick;
+static _Atomic size_t global_recdrops;
+
+static void rec_flush(struct recring *rp)
+{
+  ub4 pos = rp->pos;
+  int fd = global_recfd;
+
+  if (pos == 0 || fd == -1) return;
+  rp->pos = 0;
+  if (osbwrite(fd,rp->recs,pos * sizeof(struct yal_rec)) == 0) Atomad(global_recdrops,pos,Monone);
+}
+
+static Cold void rec_new(heapdesc *hd)
+{
+  struct recring *rp = osmmap(sizeof(struct recring));
+
+  if (rp == nil) Atomad(global_recdrops,1,Monone);
+  hd->rec = rp;
+}
+
+static void rec_add(heapdesc *hd,enum Yal_rec_op op,void *p,size_t arg,size_t len,ub4 tag)
+{
+  struct recring *rp;
+  struct yal_rec *r;
+  ub4 pos;
+
+  rp = hd->rec;
+  if (unlikely(rp == nil)) {
+    rec_new(hd);
+    rp = hd->rec;
+    if (rp == nil) return;
+  }
+  pos = rp->pos;
+  r = rp->recs + pos;
+  r->tick = Atomad(global_rectick,1,Monone) + 1;
+  r->ptr = (size_t)p;
+  r->arg = arg;
+  r->len = len;
+  r->op = op;
+  r->tid = hd->id;
+  r->tag = tag;
+  r->filler = 0;
+  if (++pos == Rec_len) { rp->pos = pos; rec_flush(rp); }
+  else rp->pos = pos;
+}
+
+// api entry
+static void rec_api(enum Yal_rec_op op,void *p,size_t arg,size_t len,ub4 tag)
+{
+  heapdesc *hd = getheapdesc(Lnone);
+
+  if (unlikely(hd->inrec != 0)) return; // internal, e.g. from recording
+  hd->inrec = 1;
+  rec_add(hd,op,p,arg,len,tag);
+  hd->inrec = 0;
+}
+
+#define yrec(op,p,arg,len,tag) if (unlikely(global_recfd != -1)) rec_api((op),(p),(arg),(len),(tag));
+
+static void rec_exit(void)
+{
+  heapdesc *hd;
+  int fd = global_recfd;
+  ub4 iter = 1u << 16;
+  size_t drops;
+
+  if (fd == -1) return;
+
+  for (hd = Atomget(global_heapdescs,Moacq); hd && --iter; hd = hd->nxt) {
+    if (hd->rec) rec_flush(hd->rec); // threads still running may lose records
+  }
+  global_recfd = -1;
+  osclose(fd);
+
+  drops = Atomget(global_recdrops,Monone);
+  if (drops) minidiag(Fln,Lnone,Warn,0,"rec dropped %zu records",drops);
+}
+
+// Yal_rec_envvar=1 creates Yal_rec_file-<pid>.bin
+static void init_rec(void)
+{
+  cchar *envs = getenv(Yal_rec_envvar);
+  struct yal_rec hdr;
+  char fname[256];
+  unsigned long pid = Atomget(global_pid,Monone);
+  int fd;
+
+  if (envs == nil || *envs == '0') return;
+
+  snprintf_mini(fname,0,255,"%.64s-%lu.bin",Yal_rec_file,pid);
+  fd = oscreate(fname);
+  if (fd == -1) { minidiag(Fln,Lnone,Warn,0,"cannot create %s - %m",fname); return; }
+
+  memset(&hdr,0,sizeof(hdr));
+  hdr.op = Yal_rec_none;
+  hdr.ptr = Yal_rec_magic;
+  hdr.arg = sizeof(struct yal_rec);
+  if (osbwrite(fd,&hdr,sizeof(hdr)) == 0) { osclose(fd); return; }
+
+  global_recfd = fd;
+  atexit(rec_exit);
+  minidiag(Fln,Lnone,Vrb,0,"rec to %s",fname);
+}
+
+#undef Logfile
@@ -154,7 +154,7 @@ static bool setregion(heap *hb,xregion *reg,size_t bas,size_t len,bool add,enum
   ub4 pos1,pos2,pos3,posend;
   ub4 shift1,shift2;
   xregion ****dir1,***dir2,**dir3;
-  ub4 hid = hb->id;
+  ub4 Unused hid = hb->id;
 
   ydbg2(fln,loc,"set %s region %u.%u p %zx len %zu` %u",regname(reg),hb->id,reg->id,bas,len,add);
 
@@ -208,13 +208,24 @@ static bool setregion(heap *hb,xregion *reg,size_t bas,size_t len,bool add,enum
 }
 
 // locate region from pointer. First part of free()
-static Hot xregion *findregion(heap *hb,size_t ip,enum Loc loc)
+static Hot xregion *findregion(heap *hb,size_t ip,enum Loc Unused loc)
 {
   size_t ip1;
   ub4 pos1,pos2,pos3;
   ub4 shift1,shift2;
   xregion ****dir1,***dir2,**dir3,*reg;
 
+#if Regcache_len
+  struct regcache *rc = hb->regcache + ((ip >> Minregion) & (Regcache_len - 1));
+  region *creg = rc->reg;
+
+  if (likely(creg != nil) && creg->uid == rc->uid && creg->aged == 0 && ip - creg->user < creg->len) { // same slab, not trimmed
+    ystats(hb->stat.regcachehits)
+    return (xregion *)creg;
+  }
+  ystats(hb->stat.regcachemisses)
+#endif
+
   dir1 = hb->rootdir;
 
   shift1= Vmbits - Dir1;
@@ -249,6 +260,14 @@ static Hot xregion *findregion(heap *hb,size_t ip,enum Loc loc)
   if (ip > base + len) { error(loc,"region %u p %zx above base %zx + %zu",reg->id,ip,base,len) return nil; } // possible user error
 #endif
 
+#if Regcache_len
+  if (reg->typ == Rslab) {
+    creg = (region *)reg; // -V1027 PVS unrelated obj cast
+    rc->reg = creg;
+    rc->uid = creg->uid;
+  }
+#endif
+
   return reg;
 }
 
@@ -465,12 +484,24 @@ static void vg_closeregs(heap *hb)
 #define closeregs(hb)
 #endif
 
+#if Yal_enable_memlimit
+static void mem_drop_(heap *hb,size_t len); // free.h
+
+static inline void mem_drop(heap *hb,size_t len)
+{
+  if (unlikely(mem_room(len) == 0) && hb->pool == nil) mem_drop_(hb,len); // pool regions are owned by the pool
+}
+#else
+ #define mem_drop(hb,len)
+#endif
+
 // create new region with user and meta blocks
-static region *newregion(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 cellen,enum Rtype typ)
+static region *newregion_(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 cellen,enum Rtype typ)
 {
   void *user,*ouser;
   void *meta,*ometa;
-  size_t mlen,ulen,olen,omlen,loadr,hiadr;
+  size_t mlen,ulen,olen,omlen,loadr;
+  size_t Unused hiadr;
   ub8 uid = 0;
   region *reg = nil,*ureg,*preg,*nreg,*nxt,*nxureg;
   ub4 rid,hid = hb->id;
@@ -482,7 +513,9 @@ static region *newregion(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 celle
   ub4 shift;
   ub4 iter;
   ub4 from;
-  bool didcas;
+  ub4 huge = 0;
+  size_t dirty = 0;
+  bool Unused didcas;
   yalstats *sp = &hb->stat;
 
   ycheck(nil,Lalloc,len < Pagesize,"heap %u type %s region has len %zu",hid,regnames[typ],len)
@@ -601,6 +634,8 @@ static region *newregion(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 celle
     gen = reg->gen;
     rbinlen = reg->rbinlen;
     rembin = Atomget(reg->rembin,Moacq);
+    huge = olen ? reg->huge : 0;
+    dirty = olen ? reg->dirty : 0;
 
     slabstats(reg,&hb->stat,nil,0,0,0,0,0); // accumulate stats from previous user
 
@@ -662,17 +697,31 @@ static region *newregion(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 celle
   reg->uid = uid;
 
   if (olen == 0) {
-    ulen = doalign8(len,Pagesize);
-    user = osmem(Fln,hid,ulen,"region base");
+#if Yal_huge_pages
+    if (typ == Rslab && order >= Huge_threshold) {
+      ulen = doalign8(len,1ul << Huge_order);
+      mem_drop(hb,ulen);
+      user = oshugemem(Fln,hid,ulen,"huge region base");
+      huge = 1;
+    } else
+#endif
+    {
+      ulen = doalign8(len,Pagesize);
+      mem_drop(hb,ulen);
+      user = osmem(Fln,hid,ulen,"region base");
+    }
     if (user == nil) {
       return nil;
     }
+    osnodebind(hb,user,ulen);
   } else {
     user = ouser;
     ulen = olen;
   }
   reg->user = (size_t)user;
   reg->len = ulen;
+  reg->huge = huge;
+  reg->dirty = dirty;
 
   vg_mem_noaccess(user,ulen)
   loadr = (size_t)user;
@@ -691,10 +740,12 @@ static region *newregion(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 celle
       mlen += (mlen >> shift);
     }
     mlen = max(mlen,max(Pagesize,8192));
+    mem_drop(hb,mlen);
     meta = osmem(Fln,hid,mlen,"region meta");
     if (meta == nil) {
       return nil;
     }
+    osnodebind(hb,meta,mlen);
   } else {
     ycheck(nil,0,ometa == nil,"nil meta for len %zu",omlen)
     meta = ometa;
@@ -709,6 +760,55 @@ static region *newregion(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 celle
   return reg;
 }
 
+static inline region *newregion(heap *hb,ub4 order,size_t len,size_t metaulen,ub4 cellen,enum Rtype typ)
+{
+  Latstart
+  region *reg = newregion_(hb,order,len,metaulen,cellen,typ);
+  Latend(hb->stat,Yal_lat_newregion) // heap locked
+  return reg;
+}
+
+// reused mmap region much larger than needed: its tail becomes a free region on its own
+static void mpsplit(heap *hb,mpregion *reg,size_t len)
+{
+  mpregion *treg,*preg,*nreg;
+  size_t tlen = reg->len - len;
+  ub4 tord = sizeof(size_t) * 8 - clzl(tlen);
+
+  treg = newmpregmem(hb);
+  if (treg == nil) return;
+
+  hb->stat.newmpregions++;
+  ystats(hb->stat.splitmpregions)
+  Atomad(global_mapadd,1,Monone); // tail is unmapped on its own
+  treg->id = (ub4)hb->stat.newmpregions * 2 + 1;
+  treg->hid = hb->id;
+  treg->hb = hb;
+  treg->typ = Rmmap;
+  treg->user = reg->user + len;
+  treg->len = tlen;
+  treg->order = tord;
+  treg->clr = reg->clr;
+  Atomset(treg->set,2,Morel); // freed
+  Atomset(treg->age,2,Morel);
+  treg->aged = 1;
+
+  preg = hb->mpregprv;
+  preg->nxt = treg;
+  hb->mpregprv = treg;
+
+  nreg = hb->freempregs[tord];
+  hb->freempregs[tord] = treg;
+  treg->frenxt = nreg;
+  treg->freprv = nil;
+  if (nreg) nreg->freprv = treg;
+  hb->mpcachelen += tlen;
+
+  ydbg2(Fln,Lnone,"split xregion %u.%u len %zu` at %zu` into %u",reg->hid,reg->id,reg->len,len,treg->id)
+  reg->len = len;
+  reg->order = sizeof(size_t) * 8 - clzl(len);
+}
+
 // new region for mmap block
 static mpregion *newmpregion(heap *hb,size_t len,enum Loc loc,ub4 fln)
 {
@@ -730,28 +830,32 @@ static mpregion *newmpregion(heap *hb,size_t len,enum Loc loc,ub4 fln)
   ycheck(nil,Lnone,order < Page,"region len %zu` order %u below %u",len,order,Page)
   ycheck(nil,Lnone,order >= Vmbits,"region len %zu` order %u above %u",len,order,Vmbits)
 
-  // recycle ?
+  // recycle ? best fit in the first order having one
   iter = 80;
   do {
     ureg = hb->freempregs[ord];
     while (ureg && --iter) {
       ydbg2(Fln,loc,"try xreg %u len %zu` for %zu` ord %u/%u",ureg->id,ureg->len,len,ord,order)
-      if (len <= ureg->len) {
-        ydbg2(Fln,loc,"use xregion %u.%u len %zu` gen %u for %zu` ord %u/%u",ureg->hid,ureg->id,ureg->len,ureg->gen,len,ord,order)
+      if (len <= ureg->len && (reg == nil || ureg->len < reg->len) && (loc != Lcalloc || ureg->clr == 0 || len < Calloc_fresh_min)) { // large calloc prefers a fresh mapping over clearing
         reg = ureg;
-
-        nreg = reg->frenxt; // unlist
-        preg = reg->freprv;
-        if (preg) preg->frenxt = nreg;
-        else hb->freempregs[ord] = nreg;
-        if (nreg) nreg->freprv = preg;
-        sp->usempregions++;
-        break; // suitable size
+        if (ureg->len == len) break;
       }
       ureg = ureg->frenxt;
     }
   } while (reg == nil && ++ord < min(Vmbits,order + 3));
 
+  if (reg) {
+    ydbg2(Fln,loc,"use xregion %u.%u len %zu` gen %u for %zu` ord %u/%u",reg->hid,reg->id,reg->len,reg->gen,len,ord,order)
+    nreg = reg->frenxt; // unlist
+    preg = reg->freprv;
+    if (preg) preg->frenxt = nreg;
+    else hb->freempregs[ord] = nreg;
+    if (nreg) nreg->freprv = preg;
+    hb->mpcachelen -= min(hb->mpcachelen,reg->len);
+    sp->usempregions++;
+    if (reg->len - len >= Mmap_splitmin && reg->rsvlen == 0) mpsplit(hb,reg,len);
+  }
+
   if (reg == nil) { // use empty one
     iter = 100;
     ureg = hb->freemp0regs;
@@ -834,13 +938,14 @@ static mpregion *newmpregion(heap *hb,size_t len,enum Loc loc,ub4 fln)
   ydbg2(Fln,Lnone,"use xregion %zx %u.%u for size %zu` from %zu`",(size_t)reg,hid,reg->id,len,olen);
 
   if (olen) {
-    reg->gen++;
-    reg->clr = 1;
+    reg->gen++; // clr as left by previous use or decommit
   } else {
+    mem_drop(hb,len);
+    if (mem_charge(len) == 0) return nil;
     Atomad(global_mapadd,1,Monone);
     p = osmmap(len);
     user = (size_t)p;
-    if (user == 0) return nil;
+    if (user == 0) { mem_uncharge(len); return nil; }
     ycheck(nil,loc,user & Pagesize1,"mmap %zx not page aligned",user)
 
     reg->user = user;
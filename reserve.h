@@ -0,0 +1,192 @@
+/* reserve.h - slab regions built and prefaulted ahead of use
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   yal_reserve() adds slab regions for a size class to the caller's heap, at the region order that holds the requested count,
+   instead of growing from Minregion with each new region of the class. User memory and metadata are prefaulted.
+   The class is marked popular, so its first allocations skip bump and use the reserved cells.
+   Directory leaves for the regions are created as part of setting them up.
+   Yal_reserve_envvar is parsed at init, and applied once to the first heap created.
+*/
+
+#define Logfile Freserve
+
+static ub4 global_rsvlens[Reserve_envmax];
+static ub4 global_rsvcnts[Reserve_envmax];
+static _Atomic ub4 global_rsvcnt;
+
+// size class and its len, as alloc_heap()
+static ub4 reserve_clas(ub4 len,ub4 *palen)
+{
+  ub4 ord,cord,alen,clen,clas;
+
+  if (len < Smalclas) {
+    clas = len2clas[len];
+    *palen = clas2len[clas];
+    return clas;
+  }
+  if (len & (len - 1)) {
+    ord = 32 - clz(len);
+    cord = ord - class_grain;
+    alen = doalign4(len,1u << cord);
+    clen = (alen >> cord) & class_grain;
+    if (clen == 0) clen = 4;
+    clas = ord * class_grain1 + clen;
+  } else {
+    clas = (ctz(len) + 1) * class_grain1;
+    alen = len;
+  }
+  *palen = alen;
+  return clas + Baseclass - 7 * class_grain1;
+}
+
+// region seq for which newslab() selects an order of at least len
+static ub4 reserve_seq(size_t len)
+{
+  ub4 ord = len > 1 ? 64 - clzl(len - 1) : 0;
+  ub4 seq;
+
+  if (ord <= Minregion) return 0;
+  for (seq = 0; seq < 18; seq++) {
+    if ((ub4)Minregion + slab_addords[seq] >= ord) return seq;
+  }
+  return ord - Minregion + 6; // order capped by newslab()
+}
+
+static void reserve_fault(heap Unused *hb,void *p,size_t len)
+{
+  len = doalign8(len,Pagesize);
+  if (osprefault(p,len) == 0) { ystats2(hb->stat.rsvbytes,len) }
+}
+
+// add slab regions for cnt cels of len to locked heap. returns bytes reserved
+static size_t reserve_heap(heap *hb,size_t len,size_t cnt)
+{
+  region *reg,**clasregs;
+  ub4 clas,alen,pos,seq,clascnt;
+  Ub8 msk,fremsk;
+  size_t cels = 0,rsv = 0,need;
+
+  if (len == 0 || len >= mmap_limit || cnt == 0) return 0;
+
+  clas = reserve_clas((ub4)len,&alen);
+  if (clas >= Clascnt) return 0;
+
+  clascnt = hb->clasinf[clas].cnt & Hi31;
+  if (clascnt == 0) {
+    hb->clasinf[clas].len = alen;
+    hb->clasinf[clas].fremsk = 0xfffffffful;
+  }
+  hb->clasinf[clas].cnt = max(clascnt,Clas_threshold); // no bump
+
+  clasregs = hb->clasregs + clas * Clasregs;
+  seq = max(reserve_seq(cnt * alen),hb->clasinf[clas].regcnt);
+
+  while (cels < cnt) {
+    fremsk = hb->clasinf[clas].fremsk;
+    if (fremsk == 0) break;
+    pos = ctzl(fremsk);
+    if (pos >= Clasregs) break;
+
+    reg = newslab(hb,alen,clas,seq);
+    if (reg == nil) break;
+
+    reg->claspos = pos;
+    msk = 1ul << pos;
+    clasregs[pos] = reg;
+    hb->clasinf[clas].msk |= msk;
+    hb->clasinf[clas].fremsk = fremsk & ~msk;
+    hb->clasinf[clas].regcnt = (ub2)min(seq + 1,Hi16);
+    if (hb->clasinf[clas].smal == nil) {
+      hb->clasinf[clas].smal = reg;
+      hb->clasinf[clas].pos = (ub2)pos;
+    }
+    seq++;
+
+    need = min((cnt - cels) * alen,reg->len);
+    reserve_fault(hb,(void *)reg->user,need);
+    reserve_fault(hb,reg->meta,reg->metalen);
+    reg->dirty = max(reg->dirty,doalign8(need,Pagesize)); // for trim
+
+    ydbg1(Fln,Lnone,"reserve reg %.01llu clas %u len %u cels %u order %u",reg->uid,clas,alen,reg->celcnt,reg->order);
+    cels += reg->celcnt;
+    rsv += reg->len;
+    ystats(hb->stat.rsvregions)
+    ystats2(hb->stat.rsvcels,reg->celcnt)
+  }
+  return rsv;
+}
+
+// once, for the first heap
+static void reserve_env(heap *hb)
+{
+  ub4 i,n = Atomget(global_rsvcnt,Monone);
+
+  if (likely(n == 0) || Cas(global_rsvcnt,n,0) == 0) return;
+  for (i = 0; i < n; i++) reserve_heap(hb,global_rsvlens[i],global_rsvcnts[i]);
+}
+
+// Yal_reserve_envvar=<len>:<cnt>[,<len>:<cnt>...]
+static void init_reserve(void)
+{
+  cchar *envs = getenv(Yal_reserve_envvar);
+  ub4 n = 0,len,cnt;
+
+  if (envs == nil) return;
+
+  while (*envs && n < Reserve_envmax) {
+    len = atou(envs);
+    while (*envs >= '0' && *envs <= '9') envs++;
+    if (*envs != ':') break;
+    cnt = atou(++envs);
+    while (*envs >= '0' && *envs <= '9') envs++;
+    if (len && cnt) {
+      global_rsvlens[n] = len;
+      global_rsvcnts[n++] = cnt;
+    }
+    if (*envs != ',') break;
+    envs++;
+  }
+  if (*envs && *envs != ',') minidiag(Fln,Lnone,Warn,0,"%s: expected <len>:<cnt>,.. at '%.16s'",Yal_reserve_envvar,envs);
+  minidiag(Fln,Lnone,Vrb,0,"reserve %u classes",n);
+  Atomset(global_rsvcnt,n,Morel);
+}
+
+size_t yal_reserve(size_t len,size_t cnt,unsigned int Unused tag)
+{
+  heapdesc *hd = getheapdesc(Lalloc);
+  heap *hb = hd->hb;
+  size_t rsv;
+  ub4 from;
+  bool didcas;
+
+  if (hb == nil) didcas = 0;
+  else if (hd->tidstate == Ts_mt) { from = 0; didcas = Cas(hb->lock,from,1); }
+  else { didcas = 1; priv_enter(hb) }
+
+  if (didcas == 0) { // as yal_heapdesc()
+    hb = heap_new(hd,Lalloc,Fln); // locked
+    if (hb == nil) return 0;
+    if (hd->minidir == 0 && hd->mhb != nil) {
+      hd->minidir = 1;
+      setregion(hb,(xregion *)hd->mhb,hd->mhb->user,hd->mhb->len,1,Lalloc,Fln);
+    }
+    hd->hb = hb;
+  } else vg_drd_wlock_acq(hb)
+
+  ytrace(0,hd,Lalloc,tag,0,"+reserve(%zu`,%zu`)",len,cnt)
+  reserve_env(hb);
+  rsv = reserve_heap(hb,len,cnt);
+  ytrace(0,hd,Lalloc,tag,0,"-reserve(%zu`,%zu`) = %zu`",len,cnt,rsv)
+
+  if (hd->tidstate != Ts_private) {
+    Atomset(hb->lock,0,Morel);
+    vg_drd_wlock_rel(hb)
+  } else priv_leave(hb)
+  return rsv;
+}
+
+#undef Logfile
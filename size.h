@@ -114,6 +114,7 @@ static Hot size_t Nonnull(1,4) size_heap(heapdesc *hd,heap *hb,size_t ip,struct
       error(loc,"ptr %zx is not allocated: %u",ip,set)
       return Nolen;
     }
+    if (Realloc_runmax > 1 && cellen > Cel_nolen) cellen *= slab_run(creg,cel);
     ytrace(0,hd,loc,tag,0,"size(%zx) len %u",ip,cellen)
     pi->reg = reg;
     pi->cel = cel;
@@ -121,6 +122,10 @@ static Hot size_t Nonnull(1,4) size_heap(heapdesc *hd,heap *hb,size_t ip,struct
     return cellen;
   }
 
+#if Yal_enable_arena
+  if (unlikely(typ == Rarena)) return arena_free(hd,(aregion *)reg,ip,loc,tag); // no len kept. -V1027 PVS unrelated obj cast
+#endif
+
   if (unlikely(typ == Rbump || typ == Rmini)) {
     len4 = bump_free(hd,nil,(bregion *)reg,ip,Nolen,tag,loc); // -V1027 PVS unrelated obj cast
     pi->reg = reg;
@@ -188,6 +193,7 @@ static Nonnull(1,2,3) size_t ysize_heap(heapdesc *hd,void *p,struct ptrinfo *pi,
       from = Atomget(hb->lock,Moacq);
       ycheck(Nolen,loc,from != 1,"heap %u unlock %u",hb->id,from)
 #endif
+      priv_enter(hb)
     }
   } // nil hb
   hd->locked = didcas;
@@ -210,7 +216,7 @@ static Nonnull(1,2,3) size_t ysize_heap(heapdesc *hd,void *p,struct ptrinfo *pi,
     Atomset(hb->lock,0,Morel);
     ydbg2(Fln,loc,"unlock heap %u",hb->id)
     vg_drd_wlock_rel(hb)
-  }
+  } else priv_leave(hb)
 
   return retlen;
 }
@@ -7,8 +7,9 @@
 
   Meetadata is stored separate from the user blocks - aka cells - and layed out as consecutive arrays of one word per cell.
 
-  binset            - one atomic byte for bin allocation. 0 init 1 alloc 2 free. Used for alloced / freed admin and invalid free detect
+  binset            - one atomic byte for bin allocation. 0 init 1 alloc 2 free 3 remote free 4 in magazine 5 tail of a block grown by realloc. Used for alloced / freed admin and invalid free detect
   bin                 - one 32 bits word dependent on cell count. List of binpos cells, max celcnt. starts at binorg
+                             For cells up to Yal_slab_bitmap, one bit per cell instead. Alloc takes the lowest
   userlen          - one 16/32 bits word. requested aka net length. Absent for small cells
   tags                - optional one 16/32 bits word with callsite info.
 */
@@ -18,23 +19,26 @@
 #define Nocel Hi32
 
 // determine suitable size for new slab, given it's sequence in its class. Higher seqs get exponentially larger ones.
+static const ub2 slab_addords[18] = { 0,1,1,2,2,3,3,4,4,5,5,6,6,7,8,9,10,11 }; // region order add for claseq
+
 static region *newslab(heap *hb,ub4 cellen,ub4 clas,ub4 claseq)
 {
   ub4 order,addord,maxord,celord,align;
+  bool bmap;
   region *reg;
-  ub4 rid;
+  ub4 Unused rid;
   size_t reglen,xlen;
   size_t metalen,metacnt;
   size_t cnt,acnt;
-  static const ub2 addords[18] = { 0,1,1,2,2,3,3,4,4,5,5,6,6,7,8,9,10,11 };
 
   size_t binlen;
   size_t binorg;
   size_t lenorg,lenlen;
   size_t tagorg,taglen;
   size_t flnorg,flnlen;
+  size_t remorg,remlen;
 
-  addord = claseq > 17 ? claseq - 6 : addords[claseq];
+  addord = claseq > 17 ? claseq - 6 : slab_addords[claseq];
 
   celord = 31 - clz(cellen);
   if (cellen & (cellen - 1)) celord++;
@@ -56,7 +60,7 @@ static region *newslab(heap *hb,ub4 cellen,ub4 clas,ub4 claseq)
       align = min(cellen,Pagesize);
       cnt = (ub4)(reglen >> celord);
     } else {
-      align = cellen < 16 ? clas2len[clas] : 16;
+      align = min(1u << ctz(cellen),Pagesize); // region base is page aligned
       celord = 0;
       cnt = (ub4)(reglen / cellen);
       xlen = (size_t)cnt * cellen;
@@ -79,7 +83,9 @@ static region *newslab(heap *hb,ub4 cellen,ub4 clas,ub4 claseq)
   acnt = doalign8(cnt,4);
   binorg = acnt * sizeof(celset_t) / 4; // local bin
 
-  binlen = doalign8(acnt,L1line / 4);
+  bmap = Yal_slab_bitmap && cellen <= Yal_slab_bitmap;
+  if (bmap) binlen = doalign8((acnt + 31) / 32,L1line / 4);
+  else binlen = doalign8(acnt,L1line / 4);
   lenorg = binorg + binlen;
   if (cellen > Cel_nolen) lenlen = acnt;
   else lenlen = 0;
@@ -90,7 +96,10 @@ static region *newslab(heap *hb,ub4 cellen,ub4 clas,ub4 claseq)
   flnorg = tagorg + taglen;
   flnlen = Yal_enable_check > 1 ? acnt : 0;
 
-  metacnt = flnorg + flnlen;
+  remorg = flnorg + flnlen; // remote list links
+  remlen = Yal_remote_mpsc ? acnt : 0;
+
+  metacnt = remorg + remlen;
   ycheck(nil,Lalloc,metacnt >= Hi30,"len %zu` metacnt %zu`",reglen,metacnt)
 
   metalen = metacnt * sizeof(ub4); // bytes
@@ -116,9 +125,11 @@ static region *newslab(heap *hb,ub4 cellen,ub4 clas,ub4 claseq)
   reg->claseq = claseq;
 
   reg->binorg = binorg;
+  reg->bmap = bmap;
   reg->lenorg = lenorg;
   reg->tagorg = Yal_enable_tag ? tagorg : 0;
   reg->flnorg = flnlen ? flnorg : 0; //coverity[DEADCODE]
+  reg->remorg = remorg;
 
   reg->align = align;
 
@@ -169,6 +180,33 @@ static ub4 slab_getfln(region *reg,ub4 cel)
   #define Putfln(r,c,f)
 #endif
 
+// add cel to bin at pos, or set its bit
+static Hot void slab_binput(region *reg,ub4 *bin,ub4 pos,ub4 cel)
+{
+  ub4 w;
+
+  if (Yal_slab_bitmap && reg->bmap) {
+    w = cel >> 5;
+    bin[w] |= 1u << (cel & 31);
+    if (w < reg->bmlo) reg->bmlo = w;
+  } else bin[pos] = cel;
+}
+
+// take lowest cel from bitmap bin. Nocel if empty
+static Hot ub4 slab_bmget(region *reg,ub4 *bin)
+{
+  ub4 w,x,wcnt = (reg->celcnt + 31) >> 5;
+
+  for (w = reg->bmlo; w < wcnt; w++) {
+    x = bin[w];
+    if (x == 0) continue;
+    bin[w] = x & (x - 1);
+    reg->bmlo = w;
+    return (w << 5) + ctz(x);
+  }
+  return Nocel;
+}
+
 /* mark cel as freed. Possibly called from remote.
    returns 1 on error
  */
@@ -203,7 +241,7 @@ static Hot bool markfree(region *reg,ub4 cel,ub4 cellen,celset_t to,ub4 fln,ub4
     error2(Lfree,Fln,"region %.01llu invalid free(%zx) of size %u - never allocated - cel %u above %u altag %.01u",reg->uid,ip,cellen,cel,inipos,altag)
     return 1;
   }
-  if (from == 2 || from == 3) {
+  if (from == 2 || from == 3 || from == 4) {
     errorctx(fln,Lfree,"region %.01llu ptr %zx cel %u is already binned - 1 -> 2 = %u altag %.01u",reg->uid,ip,cel,from,altag)
     free2(Fln,Lfree,(xregion *)reg,ip,cellen,fretag,"slab-bin");
   } else {
@@ -277,11 +315,41 @@ static Hot ub4 slab_getlen(region *reg,ub4 cel,ub4 cellen)
   ub4 ulen;
   ub4 *lens = meta + reg->lenorg;
 
+  if (Yal_lazy_len && reg->lenset == 0) return cellen; // none stored yet
   ulen = lens[cel];
-  ycheck(0,Lnone,ulen > cellen,"cel %u ulen %u above %u",cel,ulen,cellen)
+  if (Yal_lazy_len && ulen == 0) return cellen; // allocated before
+  ycheck(0,Lnone,ulen > cellen * Realloc_runmax,"cel %u ulen %u above %u",cel,ulen,cellen)
   return ulen;
 }
 
+// number of cels in block. Can be called from remote.
+static Hot ub4 slab_run(region *reg,ub4 cel)
+{
+  _Atomic celset_t *binset = (_Atomic celset_t *)reg->meta;
+  ub4 c = cel + 1;
+  ub4 end = min(cel + Realloc_runmax,reg->celcnt);
+
+  while (c < end && Atomgeta(binset + c,Moacq) == 5) c++;
+  return c - cel;
+}
+
+// mark tail cels of a grown block as freed. returns 1 on error
+static bool slab_runfree(region *reg,ub4 cel,ub4 run,celset_t to)
+{
+  _Atomic celset_t *binset = (_Atomic celset_t *)reg->meta;
+  celset_t from;
+  ub4 c;
+
+  for (c = cel + 1; c < cel + run; c++) {
+    from = 5;
+    if (unlikely(Casa(binset + c,&from,to) == 0)) {
+      error(Lfree,"region %.01llu cel %u of block %u/%u state %u",reg->uid,c,cel,run,from)
+      return 1;
+    }
+  }
+  return 0;
+}
+
 // get checked cel from ptr. Can be called from remote.
 static Hot ub4 slab_cel(region *reg,size_t ip,ub4 cellen,ub4 celcnt,enum Loc loc)
 {
@@ -318,18 +386,116 @@ static Hot ub4 slab_cel(region *reg,size_t ip,ub4 cellen,ub4 celcnt,enum Loc loc
   return cel;
 }
 
-// alloc from remote bin
+#if Yal_remote_mpsc
+
+#define Rempending Hi32 // link not yet written by sender
+
+/* push on remote list. Wait-free : the head is swapped in one step, the link follows.
+   A consumer meeting a pending link resumes there at its next detach */
+static void slab_rempush(region *reg,ub4 cel)
+{
+  _Atomic ub4 *nxts = (_Atomic ub4 *)(reg->meta + reg->remorg);
+  ub4 prv;
+
+  Atomseta(nxts + cel,Rempending,Monone);
+  prv = Atomxchg(reg->remhead,cel + 1,Moacqrel);
+  Atomseta(nxts + cel,prv,Morel);
+}
+
+// alloc from remote list. Detach all in one exchange, owner heap locked
 static ub4 slab_remalloc(region *reg)
 {
-  ub4 pos,rpos;
-  ub4 *bin,*rbin;
-  ub4 c,cel,celcnt;
+  ub4 pos,cnt = 0;
+  ub4 *bin;
+  ub4 cel,nxt,top = Nocel;
+  ub4 celcnt,iter;
+  ub4 pend;
   ub4 cfln;
   bool didcas;
 
+  ub4 *meta = reg->meta;
+  _Atomic ub4 *nxts = (_Atomic ub4 *)(meta + reg->remorg);
+  _Atomic celset_t *binset = (_Atomic celset_t *)meta;
+  celset_t from;
+
+  pend = reg->rempend;
+  if (unlikely(pend != 0)) { // resume previous list at the cel held back
+    if (Atomgeta(nxts + pend - 1,Moacq) == Rempending) return Nocel;
+    reg->rempend = 0;
+    nxt = pend;
+  } else {
+    if (Atomget(reg->remhead,Monone) == 0) return Nocel;
+    nxt = Atomxchg(reg->remhead,0,Moacq);
+  }
+
+  bin = meta + reg->binorg;
+  pos = reg->binpos;
+  celcnt = reg->celcnt;
+
+  while (nxt) {
+    cel = nxt - 1;
+    ycheck(Nocel,Lalloc,cel >= reg->inipos,"cel %u above ini %u",cel,reg->inipos)
+
+    // read the link before use : once reused, a late sender would write it over
+    iter = 64;
+    while ( (nxt = Atomgeta(nxts + cel,Moacq)) == Rempending && --iter) Pause
+    if (unlikely(nxt == Rempending)) { // sender between swap and link : hold cel back until linked
+      reg->rempend = cel + 1;
+      break;
+    }
+
+    if (top == Nocel) top = cel; // alloc first, stays marked remote
+    else {
+      from = 3;
+      didcas = Casa(binset + cel,&from,2);
+      if (unlikely(didcas == 0)) {
+        cfln = Getfln(reg,cel);
+        errorctx(cfln,Lalloc,"pos %u",cnt)
+        error2(Lalloc,Fln,"reg %.01llu cel %u is not free %u",reg->uid,cel,from)
+        break;
+      }
+      Putfln(reg,cel,(Fln))
+      ycheck(Nocel,Lalloc,pos >= celcnt,"bin pos %u above %u",pos,celcnt)
+      slab_binput(reg,bin,pos++,cel);
+    }
+    cnt++;
+  }
+  reg->binpos = pos;
+  ystats2(reg->stat.rfrees,cnt)
+  return top;
+}
+
+#else
+
+// remote bin has a cel not marked remote free: report the first
+static Cold ub4 slab_remerr(region *reg,_Atomic celset_t *binset,ub4 *rbin,ub4 cnt)
+{
+  ub4 c,cel,cfln;
+  celset_t from;
+
+  for (c = 0; c < cnt; c++) {
+    cel = rbin[c];
+    from = Atomgeta(binset + cel,Monone);
+    if (from == 3) continue;
+    cfln = Getfln(reg,cel);
+    errorctx(cfln,Lalloc,"pos %u/%u",c,cnt)
+    error2(Lalloc,Fln,"reg %.01llu cel %u is not free %u",reg->uid,cel,from)
+    break;
+  }
+  return Nocel;
+}
+
+// alloc from remote bin
+static ub4 slab_remalloc(region *reg)
+{
+  ub4 pos,rpos,cnt;
+  ub4 *bin,*rbin;
+  ub4 c,cel;
+  ub4 Unused celcnt;
+  ub4 bad;
+
   ub4 *meta;
   _Atomic celset_t *binset;
-  celset_t from;
 
   rbin = Atomget(reg->rembin,Moacq);
   if (rbin == nil) return Nocel;
@@ -354,29 +520,34 @@ static ub4 slab_remalloc(region *reg)
   ycheck(Nocel,Lalloc,pos + rpos > celcnt,"bin pos %u + %u above %u",pos,rpos,celcnt)
   ycheck(Nocel,Lalloc,rpos > reg->rbinlen,"bin pos %u above %u",rpos,reg->rbinlen)
 
-  // copy all but topmost to local bin
+  /* copy all but topmost to local bin
+     Cels in the remote bin are marked remote free. Only the owner changes that, a racing free() fails its cas from allocated.
+     Thus validate in bulk passes and mark without cas. The range and copy passes vectorize.
+   */
   binset = (_Atomic celset_t *)meta;
+  cnt = rpos - 1;
 
-  for (c = 0; c < rpos - 1; c++) {
-    cel = rbin[c];
+#if Yal_enable_check
+  ub4 hicel = 0;
 
-    ycheck(Nocel,Lalloc,cel >= celcnt,"bin pos %u + %u cel %u above %u",pos,rpos,cel,celcnt)
-    ycheck(Nocel,Lalloc,cel >= reg->inipos,"cel %u above ini %u",cel,reg->inipos)
+  for (c = 0; c < cnt; c++) hicel = max(hicel,rbin[c]);
+  ycheck(Nocel,Lalloc,cnt && hicel >= reg->inipos,"bin pos %u + %u cel %u above ini %u",pos,rpos,hicel,reg->inipos)
+  ycheck(Nocel,Lalloc,reg->bmap == 0 && (size_t)(bin + pos + cnt) > reg->metautop,"bin pos %u above meta %zu",pos + cnt,reg->metautop)
+#endif
 
-    from = 3;
-    didcas = Casa(binset + cel,&from,2);
+  bad = 0;
+  for (c = 0; c < cnt; c++) bad |= Atomgeta(binset + rbin[c],Monone) ^ 3u;
+  if (unlikely(bad != 0)) return slab_remerr(reg,binset,rbin,cnt);
 
-    if (unlikely(didcas == 0)) {
-      cfln = Getfln(reg,cel);
-      errorctx(cfln,Lalloc,"pos %u/%u",c,rpos)
-      error2(Lalloc,Fln,"reg %.01llu cel %u is not free %u",reg->uid,cel,from)
-      return Nocel;
-    }
+  for (c = 0; c < cnt; c++) {
+    cel = rbin[c];
+    Atomseta(binset + cel,2,Monone);
     Putfln(reg,cel,(Fln))
-    ycheck(Nocel,Lalloc,(size_t)(bin + pos) >= reg->metautop,"bin pos %u above meta %zu",pos,reg->metautop)
-    bin[pos++] = cel;
-    ycheck(Nocel,Lalloc,pos > celcnt,"bin pos %u + %u above %u",pos,rpos,celcnt)
   }
+  if (Yal_slab_bitmap && reg->bmap) {
+    for (c = 0; c < cnt; c++) slab_binput(reg,bin,0,rbin[c]);
+  } else memcpy(bin + pos,rbin,cnt * sizeof(ub4));
+  pos += cnt;
   reg->binpos = pos;
   ystats2(reg->stat.rfrees,rpos)
 
@@ -387,14 +558,17 @@ static ub4 slab_remalloc(region *reg)
   ycheck(Nocel,Lalloc,cel >= celcnt,"bin pos %u + %u cel %u above %u",pos,rpos,cel,celcnt)
   ycheck(Nocel,Lalloc,cel >= reg->inipos,"cel %u above ini %u",cel,reg->inipos)
 
-  ref = Atomsub(reg->remref,1,Moacqrel);
+  Atomsub(reg->remref,1,Moacqrel);
   return cel;
 }
 
+#endif // Yal_remote_mpsc
+
 // Add cels to remote bin. Already marked. have hb
 static ub4 cels2rbin(heap *hb,ub4 *bin,region *reg,ub4 cnt,enum Loc loc)
 {
-  ub4 cel,c,celcnt,rcnt,inc;
+  ub4 Unused cel,c;
+  ub4 celcnt,rcnt,inc;
   ub4 pos,rpos = reg->rbinpos;
   ub4 *rbin,*rbin2;
 
@@ -457,12 +631,13 @@ static ub4 cels2rbin(heap *hb,ub4 *bin,region *reg,ub4 cnt,enum Loc loc)
 }
 
 // unbuffer remote frees. Returns cells left
-static size_t slab_unbuffer(heap *hb,enum Loc loc,ub4 frees)
+static size_t slab_unbuffer_(heap *hb,enum Loc loc,ub4 frees)
 {
   heap *xhb;
   struct rembuf *rb;
   struct remote *rem,*remp;
-  ub4 cnt,pos;
+  ub4 Unused cnt;
+  ub4 pos;
   region *reg;
   ub4 hid,clas,seq,clasofs;
   Ub8 clasmsk,Clasmsk,clasmsks,seqmsk,Seqmsk,hidmsk,Hidmsk;
@@ -576,22 +751,36 @@ static size_t slab_unbuffer(heap *hb,enum Loc loc,ub4 frees)
   return bufs - batch;
 }
 
+static inline size_t slab_unbuffer(heap *hb,enum Loc loc,ub4 frees)
+{
+  Latstart
+  size_t left = slab_unbuffer_(hb,loc,frees);
+  Latend(hb->stat,Yal_lat_unbuffer) // heap locked
+  return left;
+}
+
 // free from other thread. Returns cel len.
 static ub4 slab_free_rheap(heapdesc *hd,heap *hb,region *reg,size_t ip,ub4 tag,enum Loc loc)
 {
-  heap *xhb;
+  heap Unused *xhb;
   struct remote *rem,*remp;
   struct rembuf *rb;
   ub4 *binp,*bin2;
   ub4 pos;
   ub4 cel,cellen,celcnt,cnt,inc;
+  ub4 c,run = 1;
   ub4 clasofs,clasbit;
   ub4 hid,clas,seq;
-  ub4 ref;
-  size_t bufs,batch;
+  ub4 Unused ref;
+  size_t bufs;
+  size_t Unused batch;
   bool rv;
 
+  static_assert(Realloc_runmax <= Rbinbuf,"Realloc_runmax <= Rbinbuf");
+
+#if Yal_remote_mpsc == 0
   ycheck(0,loc,hb == nil,"reg %u nil heap",reg->id)
+#endif
 
   cellen = reg->cellen;
   celcnt = reg->celcnt;
@@ -608,6 +797,16 @@ static ub4 slab_free_rheap(heapdesc *hd,heap *hb,region *reg,size_t ip,ub4 tag,e
     ypush(hd,loc,Fln)
     return 0;
   }
+  if (Realloc_runmax > 1 && cellen > Cel_nolen) {
+    run = slab_run(reg,cel);
+    if (unlikely(run > 1) && slab_runfree(reg,cel,run,3)) return 0;
+  }
+
+#if Yal_remote_mpsc
+  for (c = 0; c < run; c++) slab_rempush(reg,cel + c);
+  ystats2(hd->stat.xfreebatch,run) // unbuffered
+  return cellen;
+#endif
 
   // create a remote buffer if not present
   if (unlikely(hid >= Remhid)) {
@@ -620,7 +819,7 @@ static ub4 slab_free_rheap(heapdesc *hd,heap *hb,region *reg,size_t ip,ub4 tag,e
   }
   rem = rb->rem;
 
-  bufs = hb->stat.xfreebuf + 1;
+  bufs = hb->stat.xfreebuf + run;
   batch = hb->stat.xfreebatch;
   ycheck(0,loc,bufs < batch,"buffered %zu` batch %zu`",bufs,batch)
   yhistats(hb->stat.xmaxbin,bufs - batch)
@@ -678,8 +877,8 @@ static ub4 slab_free_rheap(heapdesc *hd,heap *hb,region *reg,size_t ip,ub4 tag,e
     ycheck1(0,loc,remp->celcnt != celcnt,"reg %.01llu.%u cellen %u vs %u",reg->uid,reg->id,celcnt,remp->celcnt)
     ycheck1(0,loc,remp->uid != reg->uid,"reg %.01llu.%u vs %.01llu",reg->uid,reg->id,remp->uid)
   }
-  binp[pos] = cel;
-  remp->pos = pos + 1;
+  for (c = 0; c < run; c++) binp[pos + c] = cel + c;
+  remp->pos = pos + run;
 
   // add to masks
   rb->seq[clas] |= (1ul << seq);
@@ -761,7 +960,7 @@ static Hot ub4 slab_newalcel(region *reg,ub4 align,ub4 cellen)
       if (unlikely(rv != 0)) return Nocel;
       rv = markfree(reg,c,cellen,2,Fln,0);
       if (unlikely(rv != 0)) return Nocel;
-      binp[binpos++] = c;
+      slab_binput(reg,binp,binpos++,c);
     }
     reg->binpos = binpos;
   }
@@ -780,8 +979,10 @@ static Hot ub4 slab_newcel(region *reg,enum Loc loc)
   bool rv;
   size_t binallocs = reg->stat.binallocs;
   celset_t set;
+#if Yal_remote_mpsc == 0
   ub4 from;
   bool didcas;
+#endif
 
   meta = reg->meta;
   celcnt = reg->celcnt;
@@ -794,19 +995,23 @@ static Hot ub4 slab_newcel(region *reg,enum Loc loc)
     pos--;
 
     bin = meta + reg->binorg;
-    ycheck(0,loc,(size_t)(bin + pos) >= reg->metautop,"bin pos %u above meta %zu",pos,reg->metautop)
-    cel = bin[pos];
+    if (Yal_slab_bitmap && reg->bmap) {
+      cel = slab_bmget(reg,bin);
+      if (unlikely(cel == Nocel)) { error(loc,"reg %.01llu bitmap bin %u empty",reg->uid,pos) return Nocel; }
+    } else {
+      ycheck(0,loc,(size_t)(bin + pos) >= reg->metautop,"bin pos %u above meta %zu",pos,reg->metautop)
+      cel = bin[pos];
 
-    if (unlikely(cel == Nocel)) {
-      for (c = 0; c <= min(pos,64); c++) {
-        cel = bin[c];
-        do_ylog(0,loc,Fln,Info,0,"bin %u cel %u",c,cel);
+      if (unlikely(cel == Nocel)) {
+        for (c = 0; c <= min(pos,64); c++) {
+          cel = bin[c];
+          do_ylog(0,loc,Fln,Info,0,"bin %u cel %u",c,cel);
+        }
+        error(loc,"reg %.01llu bin %u",reg->uid,pos)
       }
-      error(loc,"reg %.01llu bin %u",reg->uid,pos)
+      bin[pos] = Nocel;
     }
-
     reg->binpos = pos;
-    bin[pos] = Nocel;
 
     ycheck(Nocel,loc,cel >= celcnt,"region %.01llu cel %u >= cnt %u",reg->uid,cel,reg->celcnt)
     reg->stat.binallocs = binallocs + 1;
@@ -817,6 +1022,12 @@ static Hot ub4 slab_newcel(region *reg,enum Loc loc)
       ydbg3(loc,"reg %u ini %u == cnt seq %zu",reg->id,celcnt,reg->stat.iniallocs)
 
       // check remote bin
+#if Yal_remote_mpsc
+      cel = slab_remalloc(reg);
+      if (cel == Nocel) return Nocel;
+      ystats(reg->stat.xallocs)
+      set = 3;
+#else
       from = 0; didcas = Cas(reg->lock,from,1);
       if (didcas) {
         vg_drd_wlock_acq(reg)
@@ -834,6 +1045,7 @@ static Hot ub4 slab_newcel(region *reg,enum Loc loc)
       } else { // nocas
         return Nocel;
       }
+#endif
     } else { // ini full
       reg->inipos = cel + 1;
       reg->stat.iniallocs++;
@@ -851,7 +1063,7 @@ static Hot ub4 slab_newcel(region *reg,enum Loc loc)
 }
 
 // generic for malloc,calloc,aligned_alloc
-static Hot void *slab_alloc( Unused heapdesc *hd,heap *hb,region *reg,ub4 ulen,ub4 align,enum Loc loc,ub4 tag)
+static Hot void *slab_alloc( Unused heapdesc *hd,heap Unused *hb,region *reg,ub4 ulen,ub4 align,enum Loc loc,ub4 Unused tag)
 {
   ub4 cel,cellen;
   ub4 inipos;
@@ -899,10 +1111,13 @@ static Hot void *slab_alloc( Unused heapdesc *hd,heap *hb,region *reg,ub4 ulen,u
 #endif
 
   if (cellen > Cel_nolen) {
-    meta = reg->meta;
-
-    len4 = meta + reg->lenorg;
-    len4[cel] = ulen;
+    if (Yal_lazy_len && reg->lenset == 0 && loc != Lreal) reg->stat.lenskips++;
+    else {
+      reg->lenset = 1;
+      meta = reg->meta;
+      len4 = meta + reg->lenorg;
+      len4[cel] = ulen;
+    }
   }
 
   ip = reg->user + (size_t)cel * cellen;
@@ -928,7 +1143,8 @@ static Hot void *slab_alloc( Unused heapdesc *hd,heap *hb,region *reg,ub4 ulen,u
   ystats(reg->stat.callocs)
   ydbg2(Fln,loc,"calloc(%u) cel %u/%u ini %u seq %zu",ulen,cel,reg->celcnt,inipos,reg->stat.callocs)
   vg_mem_def(p,ulen)
-  if (inipos != reg->inipos && reg->clr == 0) {
+  if (inipos != reg->inipos && (reg->clr == 0 || (Yal_decommit_zero && (size_t)cel * cellen >= reg->dirty))) { // never used, or beyond previous use
+    ystats2(hb->stat.calloczero,ulen)
 
 #if Yal_enable_check > 1
     char *cp = (char *)p;
@@ -948,12 +1164,13 @@ static Hot void *slab_alloc( Unused heapdesc *hd,heap *hb,region *reg,ub4 ulen,u
   }
   ydbg2(Fln,loc,"calloc clear seq %zu",reg->stat.callocs)
 
+  ystats2(hb->stat.callocclear,ulen)
   memset(p,0,ulen);
   return p;
 }
 
 // simpler for malloc only
-static Hot void *slab_malloc(region *reg,ub4 ulen,ub4 tag)
+static Hot void *slab_malloc(region *reg,ub4 ulen,ub4 Unused tag)
 {
   ub4 cel,cellen = reg->cellen;
   ub4 *meta;
@@ -984,10 +1201,12 @@ static Hot void *slab_malloc(region *reg,ub4 ulen,ub4 tag)
 #endif
 
   if (cellen > Cel_nolen) {
-    meta = reg->meta;
-
-    len4 = meta + reg->lenorg;
-    len4[cel] = ulen;
+    if (Yal_lazy_len && reg->lenset == 0) reg->stat.lenskips++;
+    else {
+      meta = reg->meta;
+      len4 = meta + reg->lenorg;
+      len4[cel] = ulen;
+    }
   }
 
   ip = reg->user + (size_t)cel * cellen;
@@ -997,26 +1216,93 @@ static Hot void *slab_malloc(region *reg,ub4 ulen,ub4 tag)
   return p;
 }
 
+// as slab_malloc for up to cnt cells. returns count
+static Hot ub4 slab_mallocs(region *reg,ub4 ulen,void **ptrs,ub4 cnt,ub4 Unused tag)
+{
+  ub4 n,cel,cellen = reg->cellen;
+  ub4 *meta = reg->meta;
+  ub4 *len4 = meta + reg->lenorg;
+  size_t user = reg->user;
+  bool setlen = cellen > Cel_nolen && (Yal_lazy_len == 0 || reg->lenset);
+  void *p;
+
+  ycheck(0,Lalloc,ulen == 0,"ulen %u tag %.01u",ulen,tag)
+  ycheck(0,Lalloc,ulen > cellen,"ulen %u above %u",ulen,cellen)
+
+  ycheck(0,Lalloc,reg->aged != 0,"region %.01llu age %u",reg->uid,reg->aged)
+
+  reg->age = 0;
+
+#if Yal_enable_tag
+  ub4 *tags = meta + reg->tagorg;
+#endif
+
+  for (n = 0; n < cnt; n++) {
+    cel = slab_newcel(reg,Lalloc);
+    if (unlikely(cel == Nocel)) break;
+
+#if Yal_enable_tag
+    tags[cel] = tag;
+#endif
+    if (setlen) len4[cel] = ulen;
+
+    p = (void *)(user + (size_t)cel * cellen);
+    vg_mem_undef(p,ulen)
+    ptrs[n] = p;
+  }
+  if (Yal_lazy_len && cellen > Cel_nolen && setlen == 0) reg->stat.lenskips += n;
+  return n;
+}
+
 static bool slab_setlen(region *reg,ub4 cel,ub4 len)
 {
-  ub4 cellen = reg->cellen;
+  ub4 Unused cellen = reg->cellen;
   ub4 *meta = reg->meta;
   ub4 *len4;
 
   ycheck(1,Lnone,len == 0,"ulen %u",len)
-  ycheck(1,Lnone,len > cellen,"ulen %u above %u",len,cellen)
+  ycheck(1,Lnone,len > cellen * Realloc_runmax,"ulen %u above %u",len,cellen)
 
   len4 = meta + reg->lenorg;
   len4[cel] = len;
+  reg->lenset = 1; // from now on at each alloc, others read as cel len
 
   return 0;
 }
 
+/* realloc: grow block in place into the following never-allocated cels, marked 5. local only, cellen above Cel_nolen
+   returns 1 if done
+ */
+static bool slab_grow(region *reg,ub4 cel,ub4 cellen,size_t ulen)
+{
+  _Atomic celset_t *binset = (_Atomic celset_t *)reg->meta;
+  celset_t from;
+  ub4 c,run,need;
+
+  if (ulen > (size_t)cellen * Realloc_runmax) return 0;
+  need = ((ub4)ulen + cellen - 1) / cellen;
+
+  run = slab_run(reg,cel);
+  if (cel + run != reg->inipos || cel + need > reg->celcnt) return 0; // not the last one or no space
+
+  for (c = cel + run; c < cel + need; c++) {
+    from = 0;
+    if (unlikely(Casa(binset + c,&from,5) == 0)) {
+      error(Lreal,"region %.01llu cel %u of block %u/%u state %u",reg->uid,c,cel,need,from)
+      return 0;
+    }
+  }
+  reg->inipos = cel + need;
+  slab_setlen(reg,cel,(ub4)ulen);
+  ystats(reg->stat.iniallocs)
+  return 1;
+}
+
 // check and add to bin. local only
 // returns bin size, thus 0 at error
-static Hot ub4 slab_frecel(heap *hb,region *reg,ub4 cel,ub4 cellen,ub4 celcnt,ub4 tag)
+static Hot ub4 slab_frecel(heap *hb,region *reg,ub4 cel,ub4 cellen,ub4 Unused celcnt,ub4 tag)
 {
-  ub4 pos;
+  ub4 pos,c,run = 1;
   ub4 *meta,*bin;
   bool rv;
 
@@ -1030,22 +1316,33 @@ static Hot ub4 slab_frecel(heap *hb,region *reg,ub4 cel,ub4 cellen,ub4 celcnt,ub
     return 0;
   }
 
+  if (Realloc_runmax > 1 && cellen > Cel_nolen) {
+    run = slab_run(reg,cel);
+    if (unlikely(run > 1) && slab_runfree(reg,cel,run,2)) return 0;
+  }
+
   pos = reg->binpos;
   ycheck(0,Lfree,pos >= celcnt,"region %u bin %u above %u",reg->id,pos,celcnt)
 
   meta = reg->meta;
   bin = meta + reg->binorg;
-  ycheck(0,Lfree,(size_t)(bin + pos) >= reg->metautop,"bin pos %u above meta %zu",pos,reg->metautop)
+
+  if (Yal_slab_bitmap && reg->bmap) { // no runs for small cels
+    slab_binput(reg,bin,pos++,cel);
+  } else {
+    ycheck(0,Lfree,(size_t)(bin + pos) >= reg->metautop,"bin pos %u above meta %zu",pos,reg->metautop)
 
 #if Alloc_last_freed == 0 // swap mru with lru
-  ub4 cel0 = bin[0];
-  bin[pos] = cel0;
-  bin[0] = cel;
+    ub4 cel0 = bin[0];
+    bin[pos] = cel0;
+    bin[0] = cel;
 #else
-  bin[pos] = cel;
+    bin[pos] = cel;
 #endif
 
-  pos++;
+    pos++;
+    for (c = 1; c < run; c++) bin[pos++] = cel + c;
+  }
   reg->binpos = pos;
 
 #if Yal_enable_check > 1
@@ -49,13 +49,16 @@ static ub4 slabstats(region *reg,yalstats *sp,char *buf,ub4 pos,ub4 len,bool pri
   sp->slabAllocs += Allocs;
   sp->callocs += callocs;
   sp->slabxfrees += rfrees;
+  sp->lenskips += rp->lenskips;
   sp->slabfrees += frees;
 
   sp->minlen = min(sp->minlen,cellen);
   sp->maxlen = max(sp->maxlen,cellen);
 
-  sp->minclass = min(sp->minclass,class);
-  sp->maxclass = max(sp->maxclass,class);
+  if (class < Clascnt) { // not pool
+    sp->minclass = min(sp->minclass,class);
+    sp->maxclass = max(sp->maxclass,class);
+  }
 
   sp->loadr = min(sp->loadr,ip);
   sp->hiadr = max(sp->hiadr,ip + rlen);
@@ -81,6 +84,10 @@ static ub4 slabstats(region *reg,yalstats *sp,char *buf,ub4 pos,ub4 len,bool pri
   sp->inuse += inuse;
   sp->inusecnt += inusecnt;
   sp->slabmem += rlen + reg->metalen;
+  if (reg->aged != 3) { // metadata overhead per bin format
+    if (reg->bmap) { sp->metamap += reg->metautop - (size_t)reg->meta; sp->celsmap += celcnt; }
+    else { sp->metalist += reg->metautop - (size_t)reg->meta; sp->celslist += celcnt; }
+  }
 
   if (print == 0 || (opts & Yal_stats_detail) == 0) return pos;
 
@@ -209,6 +216,7 @@ static Cold void regstats(int fd,heap *hb,bool print,ub4 opts)
   yalstats sp0,*sp;
   struct regstat *rp;
   size_t alloc0s,free0s,af0,freenils;
+  size_t hugemem = 0,hugecnt = 0,regmem = 0;
   ub4 cnt = 0;
   region reg0;
   char buf[4096];
@@ -244,9 +252,14 @@ static Cold void regstats(int fd,heap *hb,bool print,ub4 opts)
     if (typ != Rslab) { sp->noregion_cnt++; reg = nxt; continue; }
     pos = slabstats(reg,sp,buf,pos,blen,print,opts,cnt++);
     if (pos > 3096) { oswrite(fd,buf,pos,Fln); pos = 0; }
+    regmem += reg->len;
+    if (reg->huge && reg->len) { hugecnt++; hugemem += reg->len; }
     reg = nxt;
   }
   closeregs(hb)
+  sp->hugemem = hugemem;
+  sp->hugeregions = hugecnt;
+  if (print && hugecnt) pos += snprintf_mini(buf,pos,blen,"  huge pages %zu` regions %zu`b of %zu`b %u%%\n",hugecnt,hugemem,regmem,(ub4)(hugemem * 100 / regmem));
   if (pos) oswrite(fd,buf,pos,Fln);
 }
 
@@ -325,7 +338,10 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
     if (issum == 0) {
       buf[pos++] = '\n';
       pos = diagfln(buf,pos,len,Fln);
-      pos += snprintf_mini(buf,pos,len,"0 3    stats   --- yalloc %s stats for %s heap %u --- %s tag %.01u\n",yal_version,hb ? "" : "base ",hid,desc,tag);
+      pos += snprintf_mini(buf,pos,len,"0 3    stats   --- yalloc %s stats for %s heap %u --- %s tag %.01u\n",yal_version,hb ? (hb->poolheap ? "pool " : "") : "base ",hid,desc,tag);
+#if Yal_enable_pool
+      if (hb && hb->pool) pos += snprintf_mini(buf,pos,len,"  pool %u cellen %u align %u regions %u\n",hb->pool->id,hb->pool->cellen,hb->pool->align,hb->pool->regcnt);
+#endif
       oswrite(fd,buf,pos,fln);// detail above
     }
   }
@@ -341,6 +357,7 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
     sp->delregion_cnt = sp->freeregion_cnt = sp->region_cnt = 0;
 
     sp->frecnt = sp->fresiz = sp->inuse = sp->inusecnt = 0;
+    sp->metalist = sp->metamap = sp->celslist = sp->celsmap = 0;
 
     regstats(fd,hb,print,opts);
     if (hb) {
@@ -360,6 +377,7 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
   size_t reallocles = sp->reallocles;
   size_t reallocgts = sp->reallocgts;
   size_t Reallocles = sp->Reallocles;
+  size_t reallocruns = sp->reallocruns;
   size_t slabfrees = sp->slabfrees;
   size_t free0s = sp->free0s;
   size_t freenils = sp->freenils;
@@ -386,7 +404,7 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
 
   double clockperc;
 
-  ub4 cnt,clas,*clascnts;
+  ub4 cnt,clas;
   ub4 a,ac;
   size_t align,minalign = Hi64,maxalign = 0;
 
@@ -406,14 +424,16 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
     if (newregs) { // slabs
 
       tpos = table(tbuf,0,tlen,7,8,"alloc",slaballocs,"alloc0",alloc0s,"calloc",callocs,"free",slabfrees,"free0",free0s,"freenil",freenils,"rfree",slabxfrees,
-        "realloc",reallocles,"<",Reallocles,"Realloc",reallocgts,"Alloc",slabAllocs,"size",sp->sizes,nil);
+        "realloc",reallocles,"<",Reallocles,"Realloc",reallocgts,"inplace",reallocruns,"Alloc",slabAllocs,"size",sp->sizes,nil);
       pos += snprintf_mini(buf,pos,len,"\n-- slab summary --\n  counts  %.*s\n",tpos,tbuf);
 
       tpos = table(tbuf,0,tlen,7,8,"new",sp->newregions,"reuse",sp->useregions,"del",sp->delregions,"inuse",
-        sp->region_cnt,"free",sp->freeregion_cnt,"del",sp->delregion_cnt,"no",sp->noregion_cnt,"mem",sp->slabmem,nil);
+        sp->region_cnt,"free",sp->freeregion_cnt,"del",sp->delregion_cnt,"no",sp->noregion_cnt,"mem",sp->slabmem,"huge",sp->hugemem,nil);
       pos += snprintf_mini(buf,pos,len,"  regions %.*s\n ",tpos,tbuf);
+      if (sp->celslist | sp->celsmap) pos += snprintf_mini(buf,pos,len," meta list %zu`b for %zu` cels, bitmap %zu`b for %zu` cels\n ",sp->metalist,sp->celslist,sp->metamap,sp->celsmap);
+      if (sp->lenskips) pos += snprintf_mini(buf,pos,len," net len not stored %zu`\n ",sp->lenskips);
 
-      tpos = table(tbuf,0,tlen,6,7,"mark",sp->trimregions[0],"unlist",sp->trimregions[1],"undir",sp->trimregions[2],"unmap",sp->trimregions[3],nil);
+      tpos = table(tbuf,0,tlen,6,7,"mark",sp->trimregions[0],"unlist",sp->trimregions[1],"undir",sp->trimregions[2],"unmap",sp->trimregions[3],"decommit",sp->decommits,"bytes",sp->decombytes,nil);
       if (tpos) pos += snprintf_mini(buf,pos,len,"  trim %.*s\n ",tpos,tbuf);
 
       pos += snprintf_mini(buf,pos,len,"  clas %3u-%-3u len %3u - %-3u real %3zu - %-3zu",minclass,sp->maxclass,minlen,maxlen,minrelen,maxrelen);
@@ -422,12 +442,11 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
 
       if (hb && detail) {
         pos += snprintf_mini(buf,pos,len,"clas size  count\n");
-        clascnts = hb->clascnts;
-        clascnts[0] = (ub4)min(alloc0s,Hi32);
+        hb->clasinf[0].cnt = (ub4)min(alloc0s,Hi32);
         for (clas = 0; clas < Xclascnt; clas++) {
-          cnt = clascnts[clas];
+          cnt = hb->clasinf[clas].cnt;
           if (cnt) {
-            pos += snprintf_mini(buf,pos,len,"  %-2u %-6u %u`\n",clas,hb->claslens[clas],cnt);
+            pos += snprintf_mini(buf,pos,len,"  %-2u %-6u %u`\n",clas,hb->clasinf[clas].len,cnt);
           }
         }
         buf[pos++] = '\n';
@@ -467,16 +486,27 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
       pos += snprintf_mini(buf,pos,len,"  inter-thread free slab %-7zu` map %-7zu` buffer %zu` max %zu` batch %zu` + %zu` - %zu = %zu`b mmap %zu\n",
         xfreebuf + xfreebatch1,xmapfrees,xfreebuf,xmaxbin,xfreebatch,xfreebatch1,sp->xfreedropped,sp->xbufbytes,sp->rbinallocs);
     }
+    if (sp->regcachehits | sp->regcachemisses) pos += snprintf_mini(buf,pos,len,"  region cache hit %zu` miss %zu`\n",sp->regcachehits,sp->regcachemisses);
     if (bumpallocs | bumpfrees) pos += snprintf_mini(buf,pos,len,"  bump alloc %-3zu free %-3zu\n",bumpallocs,bumpfrees);
+    if (sp->clas2slab | sp->clas2bump) pos += snprintf_mini(buf,pos,len,"  class adapt to slab %zu` to bump %zu`\n",sp->clas2slab,sp->clas2bump);
     if (miniallocs | minifrees) pos += snprintf_mini(buf,pos,len,"  mini alloc %-3zu free %-3zu\n",miniallocs,minifrees);
+    if (sp->callocclear | sp->calloczero) pos += snprintf_mini(buf,pos,len,"  calloc cleared %zu`b known zero %zu`b\n",sp->callocclear,sp->calloczero);
+    if (sp->bgtrims) pos += snprintf_mini(buf,pos,len,"  background trims %zu`\n",sp->bgtrims);
+    if (sp->memrelieves) pos += snprintf_mini(buf,pos,len,"  memory pressure rounds %zu`\n",sp->memrelieves);
+    if (sp->rsvregions) pos += snprintf_mini(buf,pos,len,"  reserve regions %zu` cels %zu` prefault %zu`b\n",sp->rsvregions,sp->rsvcels,sp->rsvbytes);
+    if (sp->ownerfrees | sp->ownerbusy) pos += snprintf_mini(buf,pos,len,"  remote free in owner heap %zu` owner busy %zu`\n",sp->ownerfrees,sp->ownerbusy);
+    if (sp->alclasallocs) pos += snprintf_mini(buf,pos,len,"  aligned alloc by class %zu`\n",sp->alclasallocs);
+    if (sp->arenas) pos += snprintf_mini(buf,pos,len,"  arena new %-3zu chunk %zu` alloc %zu` %zu`b free %zu`\n",sp->arenas,sp->arenachunks,sp->arenaallocs,sp->arenabytes,sp->arenafrees);
 
     if (sp->newmpregions) { // mmap
       tpos = table(tbuf,0,tlen,7,7,"alloc",mapallocs,"Allocs",mapAllocs,"realloc",mapreallocs,"free",mapfrees,"rfree",mapxfrees,"minlen",mapminlen,"maxlen",mapmaxlen,nil);
       pos += snprintf_mini(buf,pos,len,"\n-- mmap summary --\n  counts  %.*s\n",tpos,tbuf);
-      tpos = table(tbuf,0,tlen,7,7,"new",sp->newmpregions,"use",sp->usempregions,"del",sp->delmpregions,"used",sp->xregion_cnt,"inuse",sp->inmapuse,nil);
+      tpos = table(tbuf,0,tlen,7,7,"new",sp->newmpregions,"use",sp->usempregions,"del",sp->delmpregions,"split",sp->splitmpregions,"used",sp->xregion_cnt,"inuse",sp->inmapuse,nil);
       pos += snprintf_mini(buf,pos,len,"  regions %.*s\n",tpos,tbuf);
       tpos = table(tbuf,0,tlen,6,7,"mark",sp->trimregions[4],"unlist",sp->trimregions[5],"undir",sp->trimregions[6],"unmap",sp->trimregions[7],nil);
       if (tpos) pos += snprintf_mini(buf,pos,len,"  trim %.*s\n ",tpos,tbuf);
+      tpos = table(tbuf,0,tlen,6,7,"inplace",sp->mrealinplace,"moved",sp->mrealmoves,"copied",sp->mrealcopies,"reserve",sp->mreserves,nil);
+      if (tpos) pos += snprintf_mini(buf,pos,len,"  realloc %.*s\n ",tpos,tbuf);
     }
 
     if (detail && mapAllocs) {
@@ -490,6 +520,14 @@ static Cold size_t yal_mstats_heap(int fd,heap *hb,yalstats *ret,bool print,ub4
     }
 
     if (issum) pos += snprintf_mini(buf,pos,len,"  heaps new %2zu  used %2zu get %4zu` noget %4zu`,%-4zu`\n\n",newheaps,useheaps,sp->getheaps,sp->nogetheaps,sp->nogetheap0s);
+    if (issum && (sp->idleheaps | sp->handovers)) pos += snprintf_mini(buf,pos,len,"  thread exit handover %zu` reuse %zu`\n\n",sp->handovers,sp->idleheaps);
+
+#if Yal_enable_numa
+    for (a = 0; a < Numa_nodes; a++) {
+      if (sp->nodeheaps[a] | sp->nodebytes[a]) pos += snprintf_mini(buf,pos,len,"  numa node %u heaps %zu bound %zu`b\n",a,sp->nodeheaps[a],sp->nodebytes[a]);
+    }
+    pos += snprintf_mini(buf,pos,len,"  numa local %zu` remote %zu` bind-fail %zu\n\n",sp->numalocal,sp->numaremote,sp->numafails);
+#endif
     // pos += snprintf_mini(buf,pos,len,"  mmap %zu unmap %zu\n\n",sp->mmaps,sp->munmaps);
 
 #endif
@@ -533,6 +571,7 @@ static void sumup(yalstats *sum,yalstats *one)
   sum->reallocles += one->reallocles;
   sum->Reallocles += one->Reallocles;
   sum->reallocgts += one->reallocgts;
+  sum->reallocruns += one->reallocruns;
   sum->frees += one->frees;
   sum->free0s += one->free0s;
   sum->freenils += one->freenils;
@@ -543,11 +582,20 @@ static void sumup(yalstats *sum,yalstats *one)
   sum->mapxfrees += one->mapxfrees;
   sum->mreallocles += one->mreallocles;
   sum->mreallocgts += one->mreallocgts;
+  sum->mrealinplace += one->mrealinplace;
+  sum->mrealmoves += one->mrealmoves;
+  sum->mrealcopies += one->mrealcopies;
+  sum->mreserves += one->mreserves;
 
   sum->fresiz += one->fresiz;
   sum->frecnt += one->frecnt;
   sum->inuse += one->inuse;
   sum->inusecnt += one->inusecnt;
+  sum->metalist += one->metalist;
+  sum->metamap += one->metamap;
+  sum->celslist += one->celslist;
+  sum->celsmap += one->celsmap;
+  sum->lenskips += one->lenskips;
   sum->inmapuse += one->inmapuse;
   sum->mmaps += one->mmaps;
   sum->fremapsiz += one->fremapsiz;
@@ -561,9 +609,21 @@ static void sumup(yalstats *sum,yalstats *one)
   sum->delregion_cnt += one->delregion_cnt;
   sum->newmpregions += one->newmpregions;
   sum->usempregions += one->usempregions;
+  sum->splitmpregions += one->splitmpregions;
   sum->delmpregions += one->delmpregions;
 
   for (i = 0; i < 8; i++) sum->trimregions[i] += one->trimregions[i];
+  sum->decommits += one->decommits;
+  sum->decombytes += one->decombytes;
+  sum->callocclear += one->callocclear;
+  sum->rsvregions += one->rsvregions;
+  sum->clas2slab += one->clas2slab;
+  sum->clas2bump += one->clas2bump;
+  sum->memrelieves += one->memrelieves;
+  sum->bgtrims += one->bgtrims;
+  sum->rsvcels += one->rsvcels;
+  sum->rsvbytes += one->rsvbytes;
+  sum->calloczero += one->calloczero;
 
   for (a = 0; a < 32; a++) sum->slabaligns[a] += one->slabaligns[a];
   for (a = 0; a < Vmbits; a++) sum->mapaligns[a] += one->mapaligns[a];
@@ -580,10 +640,26 @@ static void sumup(yalstats *sum,yalstats *one)
   sum->locks += one->locks;
   sum->clocks += one->clocks;
 
+  sum->hugemem += one->hugemem;
+  sum->hugeregions += one->hugeregions;
+
+  sum->regcachehits += one->regcachehits;
+  sum->regcachemisses += one->regcachemisses;
+
   sum->newheaps += one->newheaps;
   sum->useheaps += one->useheaps;
+
+  sum->numalocal += one->numalocal;
+  sum->numaremote += one->numaremote;
+  sum->numafails += one->numafails;
+  for (i = 0; i < 8; i++) {
+    sum->nodeheaps[i] += one->nodeheaps[i];
+    sum->nodebytes[i] += one->nodebytes[i];
+  }
   sum->nogetheaps += one->nogetheaps;
   sum->nogetheap0s += one->nogetheap0s;
+  sum->handovers += one->handovers;
+  sum->idleheaps += one->idleheaps;
 
   sum->maxlen = max(sum->maxlen,one->maxlen);
   sum->minlen = min(sum->minlen,one->minlen);
@@ -599,6 +675,9 @@ static void sumup(yalstats *sum,yalstats *one)
   sum->xmaxbin = max(sum->xmaxbin,one->xmaxbin);
   sum->invalid_frees += one->invalid_frees;
   sum->errors += one->errors;
+#if Yal_enable_lat
+  lat_merge(sum,one->lats);
+#endif
 }
 
 // get and/or print stats from all heaps
@@ -660,6 +739,24 @@ size_t Cold yal_mstats(yalstats *ret,ub4 opts,ub4 tag,const char *desc)
 
   if (allthreads == 0) {
     errs = yal_mstats_heap(fd,hd->hb,ret,print != 0,opts,tag,desc,Fln);
+#if Yal_enable_hist
+    if (ret) hist_merge(ret,hd);
+    if (print && (opts & Yal_stats_hist)) {
+      memset(&one,0,sizeof(one));
+      hist_merge(&one,hd);
+      hist_print(fd,&one);
+      hist_dump(&one,hd->id,pid);
+    }
+#endif
+#if Yal_enable_lat
+    if (ret) lat_merge(ret,hd->stat.lats);
+    if (print) {
+      memset(&one,0,sizeof(one));
+      if (hd->hb) lat_merge(&one,hd->hb->stat.lats);
+      lat_merge(&one,hd->stat.lats);
+      lat_print(fd,&one);
+    }
+#endif
     if (print && didopen) osclose(fd);
     if (didcas) Atomset(oneprint,0,Morel);
     return errs;
@@ -707,10 +804,28 @@ size_t Cold yal_mstats(yalstats *ret,ub4 opts,ub4 tag,const char *desc)
     sum.nogetheaps += ds->nogetheaps;
     sum.nogetheap0s += ds->nogetheap0s;
 
+    sum.arenas += ds->arenas;
+    sum.arenachunks += ds->arenachunks;
+    sum.arenaallocs += ds->arenaallocs;
+    sum.arenabytes += ds->arenabytes;
+    sum.arenafrees += ds->arenafrees;
+    sum.alclasallocs += ds->alclasallocs;
+    sum.ownerfrees += ds->ownerfrees;
+    sum.ownerbusy += ds->ownerbusy;
+#if Yal_enable_hist
+    hist_merge(&sum,xhd);
+#endif
+#if Yal_enable_lat
+    lat_merge(&sum,ds->lats);
+#endif
+
     if (print && (opts & Yal_stats_detail) ) {
       if (hnew | huse) pos += snprintf_mini(buf,pos,len,"heap base %u new %u  used %u get %zu noget %zu,%zu\n",xhd->id,hnew,huse,ds->getheaps,ds->nogetheaps,ds->nogetheap0s);
       if (pos > 2048) { oswrite(fd,buf,pos,Fln); pos = 0; }
     }
+    if (print && (opts & Yal_stats_detail) && (ds->magallocs | ds->magfrees) ) {
+      pos += snprintf_mini(buf,pos,len,"  magazine alloc %zu` free %zu` fill %zu` drain %zu` flush %zu`\n",ds->magallocs,ds->magfrees,ds->magfills,ds->magdrains,ds->magflushes);
+    }
     if (invfrees) pos += snprintf_mini(buf,pos,len,"  invalid-free %-4zu error %-3zu\n",invfrees,ds->errors);
 
     mhb = xhd->mhb;
@@ -765,6 +880,16 @@ size_t Cold yal_mstats(yalstats *ret,ub4 opts,ub4 tag,const char *desc)
   }
   yal_mstats_heap(fd,nil,&sum,print != 0,opts | 0x80,tag,desc,Fln); // totals
 
+#if Yal_enable_hist
+  if (print && (opts & Yal_stats_hist)) {
+    hist_print(fd,&sum);
+    hist_dump(&sum,hd->id,pid);
+  }
+#endif
+#if Yal_enable_lat
+  if (print) lat_print(fd,&sum);
+#endif
+
   if (slabfrees + slabxfrees > slaballocs + slabAllocs) {
     error2(Lnone,Fln,"allocs %zu + %zu frees %zu + %zu",slaballocs,slabAllocs,slabfrees,slabxfrees)
   }
@@ -795,6 +920,12 @@ size_t Cold yal_mstats(yalstats *ret,ub4 opts,ub4 tag,const char *desc)
     mmaps += sum.rbinallocs;
 
     pos += snprintf_mini(buf,pos,len,"  mmap %zu munmap %zu\n\n",mmaps,munmaps);
+#if Yal_enable_memlimit
+    if (global_memhard) {
+      pos += snprintf_mini(buf,pos,len,"  mapped %zu`b limit %zu`b soft %zu`b pressure %u fail %u\n\n",
+        Atomget(global_mapbytes,Monone),global_memhard,global_memsoft,Atomget(global_pressure,Monone),Atomget(global_memfails,Monone));
+    }
+#endif
 
     buf[pos++] = '\n';
     if (bootnolocks) {
@@ -21,6 +21,7 @@ void *malloc(size_t len)
 #endif
 
   p = ymalloc(len,Fln);
+  yrec(Yal_rec_malloc,p,0,len,Fln)
 
   return p;
 }
@@ -31,6 +32,7 @@ void free(void *p)
   if (unlikely(yal_tls_inited == 0)) return;
 #endif
 
+  yrec(Yal_rec_free,p,0,0,Fln) // before the block can be reused
   yfree(p,0,Fln);
 }
 
@@ -70,6 +72,7 @@ void *calloc (size_t count, size_t size)
 #endif
 
   p = yalloc(len,Lcalloc,Fln);
+  yrec(Yal_rec_calloc,p,count,len,Fln)
 
   return p;
 }
@@ -88,6 +91,7 @@ void *realloc(void *p,size_t newlen)
 #endif
 
   q = yrealloc(p,Nolen,newlen,Fln);
+  yrec(Yal_rec_realloc,q,(size_t)p,newlen,Fln)
   return q;
 }
 
@@ -104,6 +108,7 @@ void *aligned_alloc(size_t align, size_t size)
 #endif
 
   p = yalloc_align(align,size,Fln);
+  yrec(Yal_rec_align,p,align,size,Fln)
   return p;
 }
 
@@ -147,23 +152,27 @@ void *reallocarray(void *p,size_t nelem, size_t elsize)
 
   if (unlikely(rv != 0)) return oom(nil,Fln,Lreal,nelem,elsize);
 
-  return yrealloc(p,Nolen,len,Fln);
+  void *q = yrealloc(p,Nolen,len,Fln);
+  yrec(Yal_rec_realloc,q,(size_t)p,len,Fln)
+  return q;
 }
 #endif
 
 #if Yal_enable_c23
 
 // https://www.open-std.org/jtc1/sc22/wg14/www/docs/n2699.htm
-// In yalloc, the size arg is used for checking only.  If zero, it is equivalent to free(p)
+// In yalloc, the size arg is used to locate small blocks without directory lookup.  If zero, it is equivalent to free(p)
 void free_sized(void *ptr,size_t size)
 {
-  yfree(ptr,size,Fln);
+  yrec(Yal_rec_free,ptr,0,size,Fln)
+  yfree_sized(ptr,size,Fln);
 }
 
 // in contrast with the C23 standard, the pointer passed may have been obtained from any of the allocation functions
 void free_aligned_sized(void *ptr, size_t Unused alignment, size_t size)
 {
-  yfree(ptr,size,Fln);
+  yrec(Yal_rec_free,ptr,0,size,Fln)
+  yfree_sized(ptr,size,Fln);
 }
 #endif // c23
 
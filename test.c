@@ -13,7 +13,9 @@
 
 #define _POSIX_C_SOURCE 199309L
 
-#include <unistd.h> // write, nanosleep
+#include <unistd.h> // write, nanosleep, fork
+#include <time.h> // clock_gettime
+#include <sys/wait.h> // waitpid
 
 #include <errno.h>
 
@@ -46,8 +48,15 @@ s - slabs lolen hilen count iter\n\
 a = all\n\
 A = align lolen hilen loalign hialign\n\
 2 = double free\n\
+e - arena count hilen : alignment, size limit and destroy\n\
+P - pool cellen count : zeroed cells on reuse\n\
+D - snap count : yal_stats_snap() and yal_stats_delta() counts\n\
+f - fork #threads #forks : fork while threads allocate and free\n\
+L - memlimit hard : allocations past the hard limit fail with ENOMEM\n\
 x - xfree #threads list of 'a' tid1 tid2 len count or 'f' tid1 tid2 len count\n\
-m - manual list of  'a' len count or 'f' from to\n\
+m - manual list of  'a' len count or 'f' from to, 'b' 'B' idem as batch, 't' effort pad trim\n\
+w - waves #waves #threads len count : each wave of threads frees the blocks left by the previous one\n\
+p - replay file : malloc, free etc. calls as recorded with Yal_enable_rec, in the recorded threads\n\
 \n";
 
 static ub4 dostat,dotstat;
@@ -568,6 +577,283 @@ static int xfree(cchar *cmd,size_t tidcnt,int argc,char *argv[])
   return 0;
 }
 
+// free blocks left by the previous, exited thread. Allocate cnt blocks and leave every second one
+static void *wave_thread(void *arg)
+{
+  struct xinfo *ap = (struct xinfo *)arg;
+  void * _Atomic * ps = ap->ps;
+  size_t c,l;
+  size_t cnt = Atomget(ap->cnt,Moacq);
+  size_t len = Atomget(ap->len,Monone);
+  size_t pos = ap->pos;
+  ssize_t rv = 0;
+  char *p;
+  ub8 state[18];
+
+  inixor(state);
+  for (l = 0; l < 16; l++) state[l] = xorshift64star();
+
+  for (c = 0; c < pos; c++) free(Atomgeta(ps + c,Moacq));
+
+  pos = 0;
+  for (c = 0; c < cnt; c++) {
+    l = rnd(len,state) + 1;
+    p = malloc(l);
+    if (p == nil) {
+      rv = L;
+      break;
+    }
+    memset(p,(int)(c & 0xff),l);
+    if (c & 1) Atomseta(ps + pos++,p,Morel);
+    else free(p);
+  }
+  ap->pos = pos;
+  pthread_exit( (void *)rv);
+}
+
+// spawn and join threads in waves
+static int waves(size_t wavecnt,size_t tidcnt,size_t len,size_t cnt)
+{
+  pthread_t tids[64];
+  static struct xinfo infos[64];
+  struct xinfo *a1;
+  void *retval;
+  size_t w,c;
+  ub4 tid;
+  int rv;
+
+  if (tidcnt == 0 || len == 0) return L;
+  tidcnt = min(tidcnt,64);
+  cnt = min(cnt,2 * Pointers);
+
+  info(L,"waves %zu threads %zu len %zu cnt %zu",wavecnt,tidcnt,len,cnt);
+
+  for (tid = 0; tid < tidcnt; tid++) {
+    a1 = infos + tid;
+    a1->tid = tid;
+    Atomset(a1->cnt,cnt,Morel);
+    Atomset(a1->len,len,Morel);
+  }
+
+  for (w = 0; w < wavecnt; w++) {
+    for (tid = 0; tid < tidcnt; tid++) {
+      rv = pthread_create(tids + tid,nil,wave_thread,(void *)(infos + tid));
+      if (rv) return L;
+    }
+    for (tid = 0; tid < tidcnt; tid++) {
+      rv = pthread_join(tids[tid],&retval);
+      if (rv) return L;
+      rv = (int)(size_t)retval;
+      if (rv) {
+        warning(L,"wave %zu thread %u returned %d",w,tid,rv);
+        return rv;
+      }
+    }
+  }
+
+  for (tid = 0; tid < tidcnt; tid++) {
+    a1 = infos + tid;
+    for (c = 0; c < a1->pos; c++) free(Atomgeta(a1->ps + c,Moacq));
+    a1->pos = 0;
+  }
+
+  return haserr(0,nil,wavecnt,L);
+}
+
+// -- replay a record file from Yal_enable_rec, see rec.h --
+
+struct rpinfo {
+  ub4 tid;
+  size_t cnt;
+  size_t *recs; // per thread, in tick order
+};
+
+static struct yal_rec *rp_recs;
+static ub4 *rp_from,*rp_to; // slot of block used and returned, Hi32 for none
+static void * _Atomic *rp_ptrs; // replayed block per slot
+static char rp_nil; // allocation returned nil
+
+static void *rp_get(ub4 slot)
+{
+  void *p;
+  ub4 iter = 0;
+
+  while ( (p = Atomgeta(rp_ptrs + slot,Moacq)) == nil) { // set by another thread
+    if (++iter > 64) waitus(10);
+    if (iter > Hi16) return &rp_nil;
+  }
+  return p;
+}
+
+static void *rp_thread(void *arg)
+{
+  struct rpinfo *ip = (struct rpinfo *)arg;
+  struct yal_rec *r;
+  size_t i,x,len;
+  void *p,*q;
+  ub4 from,to;
+
+  for (i = 0; i < ip->cnt; i++) {
+    x = ip->recs[i];
+    r = rp_recs + x;
+    from = rp_from[x]; to = rp_to[x];
+    len = (size_t)r->len;
+    p = from != Hi32 ? rp_get(from) : nil;
+    if (p == &rp_nil) p = nil;
+    q = nil;
+    switch (r->op) {
+      case Yal_rec_malloc: q = malloc(len); break;
+      case Yal_rec_calloc: q = r->arg > 1 ? calloc((size_t)r->arg,len / (size_t)r->arg) : calloc(1,len); break;
+      case Yal_rec_align: q = aligned_alloc((size_t)r->arg,len); break;
+      case Yal_rec_realloc: q = realloc(p,len); break;
+      case Yal_rec_free: free(p); break;
+      default: break;
+    }
+    if (to != Hi32) Atomseta(rp_ptrs + to,q ? q : &rp_nil,Morel);
+  }
+  pthread_exit(nil);
+}
+
+// open-addressed recorded block to slot
+static ub4 *rp_map(ub8 *keys,ub4 *vals,size_t mask,ub8 ptr)
+{
+  size_t h = (size_t)((ptr >> 4) * 0x9e3779b97f4a7c15ull);
+
+  while (1) {
+    h &= mask;
+    if (keys[h] == ptr) return vals + h;
+    if (keys[h] == 0) { keys[h] = ptr; vals[h] = Hi32; return vals + h; }
+    h++;
+  }
+}
+
+static int replay(cchar *name)
+{
+  struct osstat st;
+  struct yal_rec *recs,*r;
+  static struct rpinfo infos[Tids];
+  pthread_t tids[Tids];
+  ub4 rtids[Tids];
+  ub4 tidcnt = 0,t,slots = 0,*vp;
+  size_t n,i,x,ticks = 0,mapcnt,*bytick,*tidrecs,ops = 0;
+  ub8 *keys;
+  ub4 *vals;
+  struct timespec t0,t1;
+  unsigned long us;
+  char *p;
+  long nr;
+  int fd,rv;
+
+  fd = osopen(name,&st);
+  if (fd == -1) return error(L,"cannot open %s",name);
+  n = st.len / sizeof(struct yal_rec);
+  if (n < 2) return error(L,"%s: no records",name);
+
+  recs = malloc(n * sizeof(struct yal_rec));
+  if (recs == nil) return L;
+  p = (char *)recs;
+  for (i = 0; i < n * sizeof(struct yal_rec); i += (size_t)nr) {
+    nr = osread(fd,p + i,n * sizeof(struct yal_rec) - i);
+    if (nr <= 0) return error(L,"cannot read %s",name);
+  }
+  osclose(fd);
+
+  if (recs->op != Yal_rec_none || recs->ptr != Yal_rec_magic || recs->arg != sizeof(struct yal_rec)) return error(L,"%s: not a yalloc record file",name);
+
+  for (i = 1; i < n; i++) ticks = max(ticks,(size_t)recs[i].tick);
+  bytick = calloc(ticks + 1,sizeof(size_t));
+  rp_from = malloc(n * sizeof(ub4));
+  rp_to = malloc(n * sizeof(ub4));
+  for (mapcnt = 64; mapcnt < 2 * n; mapcnt <<= 1) ;
+  keys = calloc(mapcnt,sizeof(ub8));
+  vals = calloc(mapcnt,sizeof(ub4));
+  tidrecs = calloc(n,sizeof(size_t));
+  if (bytick == nil || rp_from == nil || rp_to == nil || keys == nil || vals == nil || tidrecs == nil) return L;
+
+  for (i = 1; i < n; i++) bytick[recs[i].tick] = i;
+
+  // assign a slot to each block, in global order
+  for (x = 1; x <= ticks; x++) {
+    i = bytick[x];
+    if (i == 0) continue; // lost
+    r = recs + i;
+    rp_from[i] = rp_to[i] = Hi32;
+    switch (r->op) {
+      case Yal_rec_malloc: case Yal_rec_calloc: case Yal_rec_align:
+        rp_to[i] = slots++;
+        if (r->ptr) *rp_map(keys,vals,mapcnt - 1,r->ptr) = rp_to[i];
+        break;
+      case Yal_rec_realloc:
+        if (r->arg) {
+          vp = rp_map(keys,vals,mapcnt - 1,r->arg);
+          rp_from[i] = *vp; // Hi32 if allocated before recording: as malloc
+          *vp = Hi32;
+        }
+        rp_to[i] = slots++;
+        if (r->ptr) *rp_map(keys,vals,mapcnt - 1,r->ptr) = rp_to[i];
+        break;
+      case Yal_rec_free:
+        if (r->ptr == 0) { r->op = Yal_rec_none; break; }
+        vp = rp_map(keys,vals,mapcnt - 1,r->ptr);
+        if (*vp == Hi32) r->op = Yal_rec_none; // allocated before recording
+        rp_from[i] = *vp;
+        *vp = Hi32;
+        break;
+      default: r->op = Yal_rec_none;
+    }
+    if (r->op == Yal_rec_none) continue;
+    ops++;
+
+    // recorded threads map to replay threads, wrapping around
+    for (t = 0; t < tidcnt && rtids[t] != r->tid; t++) ;
+    if (t == tidcnt) {
+      if (tidcnt < Tids) rtids[tidcnt++] = r->tid;
+      else t = r->tid % Tids;
+    }
+    infos[t].cnt++;
+  }
+  free(keys); free(vals);
+
+  x = 0;
+  for (t = 0; t < tidcnt; t++) {
+    infos[t].tid = t;
+    infos[t].recs = tidrecs + x;
+    x += infos[t].cnt;
+    infos[t].cnt = 0;
+  }
+  for (x = 1; x <= ticks; x++) {
+    i = bytick[x];
+    r = recs + i;
+    if (i == 0 || r->op == Yal_rec_none) continue;
+    for (t = 0; t < tidcnt && rtids[t] != r->tid; t++) ;
+    if (t == tidcnt) t = r->tid % Tids;
+    infos[t].recs[infos[t].cnt++] = i;
+  }
+  free(bytick);
+
+  rp_recs = recs;
+  rp_ptrs = calloc(slots + 1,sizeof(void *));
+  if (rp_ptrs == nil) return L;
+
+  info(L,"replay %s: %zu records, %zu ops, %u blocks, %u threads",name,n - 1,ops,slots,tidcnt);
+
+  clock_gettime(CLOCK_MONOTONIC,&t0);
+  for (t = 0; t < tidcnt; t++) {
+    rv = pthread_create(tids + t,nil,rp_thread,(void *)(infos + t));
+    if (rv) return L;
+  }
+  for (t = 0; t < tidcnt; t++) {
+    rv = pthread_join(tids[t],nil);
+    if (rv) return L;
+  }
+  clock_gettime(CLOCK_MONOTONIC,&t1);
+  us = (unsigned long)((t1.tv_sec - t0.tv_sec) * 1000000l + (t1.tv_nsec - t0.tv_nsec) / 1000);
+  info(L,"replayed %zu ops in %lu us",ops,us);
+
+  free(rp_ptrs); free(rp_from); free(rp_to); free(tidrecs); free(recs);
+  return 0;
+}
+
 static void *mt_alfre_thread(void *arg)
 {
   struct xinfo *ap = (struct xinfo *)arg;
@@ -888,6 +1174,253 @@ static int tstreal2(cchar *cmd,size_t from,size_t to,size_t step)
   return 0;
 }
 
+// arena
+static int tstarena(size_t cnt,size_t hilen)
+{
+  yal_arena *a;
+  size_t n,len,align;
+  ub1 *p;
+
+  hilen = max(hilen,1);
+  info(L,"arena cnt %zu len %zu",cnt,hilen);
+
+  a = yal_arena_create(0,L);
+  if (a == nil) return L;
+
+  for (n = 0; n < cnt; n++) {
+    len = rnd(hilen,g_state) + 1;
+    align = (size_t)1 << (n % 13); // 1 .. 4k
+    p = yal_arena_alloc(a,len,align,L);
+    if (p == nil) return error(L,"nil at %zu len %zu align %zu",n,len,align);
+    if ((size_t)p & (align - 1)) return error(L,"ptr %p not aligned at %zu",(void *)p,align);
+    memset(p,(int)(n & 0xff),len);
+  }
+  p = yal_arena_alloc(a,1u << 24,4096,L); // larger than a chunk
+  if (p == nil || ((size_t)p & 4095)) return error(L,"large arena block %p",(void *)p);
+  memset(p,1,1u << 24);
+
+  // size limits : errors expected, no wrap into a small block
+  if (yal_arena_alloc(a,(size_t)-16,0,L)) return error(L,"arena alloc of %zx",(size_t)-16);
+  if (yal_arena_alloc(a,16,(size_t)1 << 62,L)) return error(L,"arena align of %zx",(size_t)1 << 62);
+  if (yal_arena_alloc(a,16,48,L)) return error(L,"arena align %u",48);
+
+  yal_arena_destroy(a,L);
+  return 0; // errors above are counted per thread, not in yal_mstats()
+}
+
+#define Maxptr (1u << 20)
+static void *ps[Maxptr];
+
+// pool cells are zero when the pool is created with Yal_pool_zero, also when reused
+static int tstpool(size_t cellen,size_t cnt)
+{
+  yal_pool *pl;
+  size_t n;
+  ub1 *p;
+
+  cellen = max(cellen,1);
+  cnt = min(max(cnt,2),Maxptr);
+  info(L,"pool len %zu cnt %zu",cellen,cnt);
+
+  pl = yal_pool_create(cellen,0,Yal_pool_zero);
+  if (pl == nil) return L;
+
+  for (n = 0; n < cnt; n++) {
+    p = yal_pool_alloc(pl,L);
+    if (p == nil) return error(L,"nil at %zu",n);
+    if (chkcel(p,cellen,0,0,0)) return L;
+    memset(p,0xaa,cellen);
+    ps[n] = p;
+  }
+  for (n = 0; n < cnt; n += 2) yal_pool_free(pl,ps[n],L);
+  for (n = 0; n < cnt; n += 2) {
+    p = yal_pool_alloc(pl,L);
+    if (p == nil) return error(L,"nil at %zu",n);
+    if (chkcel(p,cellen,0,0,0)) return error(L,"reused cel %zu not zero",n);
+    ps[n] = p;
+  }
+  for (n = 0; n < cnt; n++) free(ps[n]); // as well
+  yal_pool_destroy(pl,L);
+  return haserr(0,nil,cnt,L);
+}
+
+// yal_stats_snap() and yal_stats_delta() show the calls of this thread
+static int tstsnap(size_t cnt)
+{
+  static struct yal_snap snaps0[256],snaps1[256];
+  struct yal_snap rate,*a,*b;
+  size_t n,n0,n1,i,j,usecs,allocs = 0;
+  void *p;
+
+  cnt = max(cnt,1);
+  info(L,"snap cnt %zu",cnt);
+
+  p = malloc(16); free(p);
+  n0 = yal_stats_snap(snaps0,256);
+  for (n = 0; n < cnt; n++) {
+    p = malloc(n % 1000 + 1);
+    free(p);
+  }
+  waitus(1000);
+  n1 = yal_stats_snap(snaps1,256);
+  if (n0 == 0 && n1 == 0) { info(L,"%s","snap not enabled"); return 0; }
+  if (n1 < n0) return error(L,"snaps %zu after %zu",n1,n0);
+
+  for (i = 0; i < n1; i++) {
+    b = snaps1 + i;
+    if (b->kind != Yal_snap_thread) continue;
+    for (j = 0; j < n0; j++) {
+      a = snaps0 + j;
+      if (a->kind != b->kind || a->id != b->id) continue;
+      if (b->allocs < a->allocs || b->frees < a->frees) return error(L,"thread %u allocs %zu after %zu",b->id,b->allocs,a->allocs);
+      if (b->allocs - a->allocs < cnt) continue;
+      allocs = b->allocs - a->allocs;
+      if (b->frees - a->frees < cnt) return error(L,"thread %u frees %zu for %zu allocs",b->id,b->frees - a->frees,allocs);
+      usecs = yal_stats_delta(a,b,&rate);
+      if (usecs == 0) return error(L,"thread %u no interval",b->id);
+      if (rate.allocs < allocs * 1000000ull / usecs) return error(L,"thread %u rate %zu for %zu in %zu us",b->id,rate.allocs,allocs,usecs);
+      if (yal_stats_delta(a,snaps1,&rate) && snaps1->kind != a->kind) return error(L,"%s","delta over different kinds");
+    }
+  }
+  if (allocs == 0) {
+    if (snaps1[n1 - 1].allocs == 0) { info(L,"%s","allocs not counted"); return 0; }
+    return error(L,"no thread with %zu allocs in %zu snaps",cnt,n1);
+  }
+  return haserr(0,nil,cnt,L);
+}
+
+// -- fork while other threads churn. The child uses the heaps it inherited, including blocks of the parent --
+
+static _Atomic ub4 fk_stop;
+
+static void *fk_thread(void *arg)
+{
+  void *blks[512];
+  ub4 i = 0,j;
+  ub8 state[18];
+
+  inixor(state);
+  for (j = 0; j < 16; j++) state[j] = xorshift64star();
+  memset(blks,0,sizeof(blks));
+
+  while (Atomget(fk_stop,Moacq) == 0) {
+    j = i++ & 511;
+    free(blks[j]);
+    blks[j] = malloc(rnd(4096,state) + 1);
+  }
+  for (j = 0; j < 512; j++) free(blks[j]);
+  return arg;
+}
+
+// fork from another thread. The heap of the main thread is then private to a thread that is absent in the child
+static void *fk_forker(void *arg)
+{
+  void **keep = arg;
+  pid_t pid;
+  int st;
+  ub4 i;
+
+  pid = fork();
+  if (pid == 0) {
+    alarm(10);
+    for (i = 0; i < 256; i++) free(keep[i]);
+    for (i = 0; i < 1000; i++) {
+      ps[i] = malloc(i * 3 + 1);
+      if (ps[i] == nil) _exit(1);
+    }
+    for (i = 0; i < 1000; i++) free(ps[i]);
+    _exit(0);
+  }
+  if (pid == -1 || waitpid(pid,&st,0) != pid || WIFEXITED(st) == 0 || WEXITSTATUS(st)) return arg;
+  return nil;
+}
+
+static int forkchurn(size_t tidcnt,size_t forks)
+{
+  pthread_t tids[64],ftid;
+  void *keep[256],*res;
+  size_t f,bad = 0;
+  ub4 i,tid;
+  pid_t pid;
+  int st,rv;
+
+  tidcnt = min(max(tidcnt,1),64);
+  info(L,"fork %zu times with %zu threads",forks,tidcnt);
+
+  for (i = 0; i < 256; i++) keep[i] = malloc(i * 5 + 1);
+
+  Atomset(fk_stop,0,Morel);
+  for (tid = 0; tid < tidcnt; tid++) {
+    rv = pthread_create(tids + tid,nil,fk_thread,nil);
+    if (rv) return L;
+  }
+
+  for (f = 0; f < forks; f++) {
+    pid = fork();
+    if (pid == -1) return error(L,"fork %zu: %m",f);
+    if (pid == 0) { // child : threads are gone, their heaps are not
+      alarm(10); // a lock left held would hang
+      for (i = 0; i < 1000; i++) {
+        ps[i] = malloc(i * 3 + 1);
+        if (ps[i] == nil) _exit(1);
+      }
+      for (i = 0; i < 1000; i++) free(ps[i]);
+      for (i = 0; i < 256; i++) free(keep[i]);
+      _exit(yal_mstats(nil,0,L,"fork child") ? 2 : 0);
+    }
+    if (waitpid(pid,&st,0) != pid || WIFEXITED(st) == 0 || WEXITSTATUS(st)) bad++;
+  }
+
+  rv = pthread_create(&ftid,nil,fk_forker,keep);
+  if (rv) return L;
+  pthread_join(ftid,&res);
+  if (res) bad++;
+
+  Atomset(fk_stop,1,Morel);
+  for (tid = 0; tid < tidcnt; tid++) pthread_join(tids[tid],nil);
+  for (i = 0; i < 256; i++) free(keep[i]);
+
+  if (bad) return error(L,"%zu of %zu children failed",bad,forks + 1);
+  return haserr(0,nil,forks,L);
+}
+
+// allocate past a hard limit. Failures are ENOMEM, without error or exit, and memory is reusable after free
+static int tstmemlimit(size_t hard)
+{
+  size_t n,cnt = 0,len = 1u << 20;
+  void *p;
+
+  if (hard < (64u << 20)) hard = 64u << 20;
+  info(L,"memlimit %zu`",hard);
+
+  if (yal_options(Yal_mem_limit,hard,0)) return L;
+
+  for (n = 0; n < Maxptr; n++) {
+    errno = 0;
+    p = malloc(len);
+    if (p == nil) {
+      if (errno != ENOMEM) return error(L,"nil at %zu with errno %d",n,errno);
+      break;
+    }
+    memset(p,1,4096);
+    ps[cnt++] = p;
+  }
+  if (cnt == Maxptr || cnt * len > hard) return error(L,"%zu blocks of %zu` within %zu`",cnt,len,hard);
+  for (n = 0; n < 1000; n++) { // small ones from regions at hand, else fail as well
+    p = malloc(n + 1);
+    if (p == nil && errno != ENOMEM) return error(L,"nil at %zu with errno %d",n,errno);
+    free(p);
+  }
+  for (n = 0; n < cnt; n++) free(ps[n]);
+
+  p = malloc(hard / 2); // cached regions are released to make room
+  if (p == nil) return error(L,"nil for %zu` after free",hard / 2);
+  free(p);
+
+  yal_options(Yal_mem_limit,0,0);
+  return haserr(0,nil,cnt,L);
+}
+
 static int do_test(cchar *cmd,size_t arg1,size_t arg2,size_t arg3,size_t arg4)
 {
   int rv = L;
@@ -902,6 +1435,11 @@ static int do_test(cchar *cmd,size_t arg1,size_t arg2,size_t arg3,size_t arg4)
   if (haschr(cmd,'r')) { tstcnt++; rv = tstrand(arg1,arg2,arg3,arg4); if (rv) return rv; }
   if (haschr(cmd,'R')) { tstcnt++; rv = tstreal(arg1,arg2,arg3); if (rv) return rv; }
   if (haschr(cmd,'B')) { tstcnt++; rv = tstreal2(cmd,arg1,arg2,arg3); if (rv) return rv; }
+  if (haschr(cmd,'e')) { tstcnt++; rv = tstarena(arg1,arg2); if (rv) return rv; }
+  if (haschr(cmd,'P')) { tstcnt++; rv = tstpool(arg1,arg2); if (rv) return rv; }
+  if (haschr(cmd,'D')) { tstcnt++; rv = tstsnap(arg1); if (rv) return rv; }
+  if (haschr(cmd,'f')) { tstcnt++; rv = forkchurn(arg1,arg2); if (rv) return rv; }
+  if (haschr(cmd,'L')) { tstcnt++; rv = tstmemlimit(arg1); if (rv) return rv; }
 
   if (tstcnt == 0) return L;
 
@@ -910,9 +1448,6 @@ static int do_test(cchar *cmd,size_t arg1,size_t arg2,size_t arg3,size_t arg4)
   return 0;
 }
 
-#define Maxptr (1u << 20)
-static void *ps[Maxptr];
-
 static char *filarg(char *buf,ub4 len,ub4 *ppos)
 {
   ub4 arg,pos = *ppos;
@@ -943,6 +1478,9 @@ static int doclose(int fd,int line) {
    r .from. .newlen.  realloc
    s .from. .len.  assert .from. has .size.
    A .len. .count. .align. - allocate aligned
+   b .size. .count.  idem a, as one batch
+   B .from. .to.   - free as one batch
+   t .effort. .pad.   - trim all heaps
    @ .file. redirect args from file
  */
 static int manual(int argc,char *argv[])
@@ -1017,6 +1555,32 @@ static int manual(int argc,char *argv[])
         if (pos < Maxptr) ps[pos++] = p;
       }
 
+    // batch alloc
+    } else if (cmd == 'b') {
+      len = v1;
+      cnt = min(v2,Maxptr - pos);
+      info(L,"alloc batch %zu` * %zu`b at %u",cnt,len,pos);
+      c = yal_alloc_batch(len,ps + pos,cnt,L);
+      if (c != cnt) { error(L,"batch %zu of %zu",c,cnt); return L; }
+      for (c = 0; c < cnt; c++) {
+        p = ps[pos + c];
+        if (chkcel(p,len,0,0x55,0xaa)) return L;
+        if (len) memset(p,0x55,len);
+      }
+      pos += (ub4)cnt;
+
+    // batch free
+    } else if (cmd == 'B') {
+      if (v1 > v2 || v2 >= Maxptr) return L;
+      info(L,"free batch %zu .. %zu",v1,v2);
+      yal_free_batch(ps + v1,v2 - v1 + 1,L);
+      pos = 0;
+
+    // trim
+    } else if (cmd == 't') {
+      len = yal_trim(0,(ub4)v1,v2,L);
+      info(L,"trim effort %zu pad %zu` = %zu`b",v1,v2,len);
+
     // calloc
     } else if (cmd == 'c') {
       len = v1;
@@ -1189,6 +1753,18 @@ int main(int argc,char *argv[])
     if (rv) error(L,"test error on line %d",rv);
     argc = 0;
 
+  } else if (*cmd == 'w') { // waves .waves. .tidcnt. .len. .cnt.
+    if (argc < 4) return L;
+    rv = waves(atoul(argv[0]),atoul(argv[1]),atoul(argv[2]),atoul(argv[3]));
+    if (rv) error(L,"test error on line %d",rv);
+    argc = 0;
+
+  } else if (*cmd == 'p') { // replay .file.
+    if (argc < 1) return L;
+    rv = replay(argv[0]);
+    if (rv) error(L,"test error on line %d",rv);
+    argc = 0;
+
   } else if (*cmd == 'T') { // mt_alfree .tidcnt. .iter.
     if (argc < 3) return L;
     tidcnt = atou(argv[0]);
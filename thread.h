@@ -1,35 +1,35 @@
-/* thread.h - nonportable thread exit notification
+/* thread.h - thread exit notification
 
- */
-
-  #include <pthread.h>
-
-// https://github.com/cpredef
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
 
-#ifdef __musl__ // musl has no identifier, expected from cmdline
-  typdedef struct __ptcb Thread_clean_info;
-  #define Thread_clean_push(i,f,x) _pthread_cleanup_push(i,f,x)
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
 
-#elif defined __GLIBC__
-  typedef struct _pthread_cleanup_buffer Thread_clean_info;
-  extern void __pthread_cleanup_push (struct _pthread_cleanup_buffer *buffer,void (*routine) (void *), void *arg);
-  #define Thread_clean_push(i,f,x) // __pthread_cleanup_push(i,f,x)
+   A pthread key destructor is called at exit of each thread that registered a value.
+   Unlike cleanup handlers, this covers all exit paths and is portable across posix threads.
+ */
 
-#elif defined __APPLE__ && defined __MACH__
-  // excerpt from pthread.h
-  typedef struct __darwin_pthread_handler_rec Thread_clean_info;
+  #include <pthread.h>
 
-  static void Thread_clean_push( struct __darwin_pthread_handler_rec *handler,void (*func)(void *),void *val)
-  {
-       pthread_t self = pthread_self();
-	     handler->__routine = func;
-	     handler->__arg = val;
-	     handler->__next = self->__cleanup_stack;
-	     self->__cleanup_stack = handler;
+static pthread_key_t thread_key;
+static _Atomic ub4 thread_keystate; // 0 none 1 creating 2 ready 3 unavailable
+
+// have cleaner called with arg at exit of the current thread
+static void thread_setkey(void (*cleaner)(void *),void *arg)
+{
+  ub4 from = 0;
+  ub4 state = Atomget(thread_keystate,Moacq);
+
+  if (unlikely(state < 2)) {
+    if (Cas(thread_keystate,from,1)) {
+      state = pthread_key_create(&thread_key,cleaner) ? 3 : 2;
+      Atomset(thread_keystate,state,Morel);
+    } else {
+      do {
+        Pause
+        state = Atomget(thread_keystate,Moacq);
+      } while (state < 2);
+    }
   }
-
-#else
-  typedef int Thread_clean_info;
-  #define Thread_clean_push(i,f,x)
-
- #endif
+  if (state == 2) pthread_setspecific(thread_key,arg);
+}
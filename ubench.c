@@ -0,0 +1,310 @@
+/* ubench.c - microbenchmarks of internal yalloc functions
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   Includes yalloc.c as the unity build does, and calls its internal routines directly on two heaps of its own, bypassing malloc().
+   Each routine is timed with rdtsc or cntvct over a whole region, in one of these states :
+   fresh - never allocated cels from ini. binned - cels freed in order. fragmented - half of the cels freed in random order
+   remote - all cels freed from the second heap, buffered there, then moved to the remote bin of the owner
+   The loop is run Ub_rounds times on a new region, and the median cycles per op is printed.
+   Single threaded with a fixed seed, class and region order, so results of builds with the same options compare across commits.
+   Usage: ubench [cellen]
+*/
+
+#include <stddef.h>
+
+#include "yalloc.c"
+
+#define Ub_rounds 9
+#define Ub_lens 4096
+#define Ub_finds 4096
+#define Ub_bumps 256
+#define Ub_maxcels (1u << 20)
+
+static_assert(Ub_rounds <= Clasregs,"Ub_rounds <= Clasregs");
+
+enum Ub_ops { Ub_clas,Ub_findreg,Ub_findgreg,Ub_newfresh,Ub_frecel,Ub_newbin,Ub_frerand,Ub_newfrag,Ub_freremote,Ub_unbuffer,Ub_remalloc,Ub_newremote,Ub_bumpalloc,Ub_bumpfree,Ub_count };
+
+static cchar *ub_names[Ub_count] = {
+  "class","findregion","findgregion","newcel fresh","frecel","newcel binned","frecel random","newcel fragmented",
+  "free remote","unbuffer","remalloc","newcel remote","bumpalloc","bump_free" };
+
+static size_t ub_res[Ub_count][Ub_rounds]; // cycles per op * 10
+static ub4 ub_ops[Ub_count];
+
+static ub4 ub_cels[Ub_maxcels];
+static ub4 ub_lens[Ub_lens];
+static size_t ub_ips[Ub_finds];
+static void *ub_bumps[Ub_bumps];
+static region *ub_regs[Ub_rounds];
+
+static ub8 ub_seed = 0x2545f4914f6cdd1dul;
+
+#if defined __x86_64__ || defined __i386__
+ static inline ub8 ub_cycles(void) { return __builtin_ia32_rdtsc(); }
+#elif defined __aarch64__
+ static inline ub8 ub_cycles(void)
+ {
+   ub8 t;
+
+   __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (t));
+   return t;
+ }
+#else
+ static inline ub8 ub_cycles(void) { return osnsecs(); } // ns instead
+#endif
+
+static ub4 ub_rnd(ub4 range)
+{
+  ub8 x = ub_seed;
+
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  ub_seed = x;
+  return (ub4)(x % range);
+}
+
+static void ub_add(enum Ub_ops op,ub4 round,ub8 t0,ub4 ops)
+{
+  ub8 dt = ub_cycles() - t0;
+
+  ub_res[op][round] = ops ? (size_t)(dt * 10 / ops) : 0;
+  ub_ops[op] = ops;
+}
+
+// as alloc_heap()
+static ub4 ub_clas(ub4 len)
+{
+  ub4 ord,cord,alen,clen,clas;
+
+  if (len < Smalclas) return len2clas[len];
+
+  if (len & (len - 1)) {
+    ord = 32 - clz(len);
+    cord = ord - class_grain;
+    alen = doalign4(len,1u << cord);
+    clen = (alen >> cord) & class_grain;
+    if (clen == 0) clen = 4;
+    clas = ord * class_grain1 + clen;
+  } else {
+    clas = (ctz(len) + 1) * class_grain1;
+  }
+  return clas + Baseclass - 7 * class_grain1;
+}
+
+static void ub_shuffle(ub4 *a,ub4 n)
+{
+  ub4 i,j,x;
+
+  for (i = n - 1; i; i--) {
+    j = ub_rnd(i + 1);
+    x = a[i]; a[i] = a[j]; a[j] = x;
+  }
+}
+
+static ub4 ub_allcels(region *reg,ub4 cnt,enum Ub_ops op,ub4 round)
+{
+  ub4 i,n = 0,cel;
+  ub8 t0 = ub_cycles();
+
+  for (i = 0; i < cnt; i++) {
+    cel = slab_newcel(reg,Lalloc);
+    if (cel == Nocel) break;
+    ub_cels[n++] = cel;
+  }
+  ub_add(op,round,t0,n);
+  return n;
+}
+
+static void ub_frecels(heap *hb,region *reg,ub4 cnt,enum Ub_ops op,ub4 round)
+{
+  ub4 i,cellen = reg->cellen,celcnt = reg->celcnt;
+  ub8 t0 = ub_cycles();
+
+  for (i = 0; i < cnt; i++) slab_frecel(hb,reg,ub_cels[i],cellen,celcnt,0);
+  ub_add(op,round,t0,cnt);
+}
+
+// one round of slab cel states on a new region
+static bool ub_slab(heapdesc *hd,heap *hb,heap *xhb,ub4 cellen,ub4 round)
+{
+  region *reg;
+  ub4 i,cnt,half,cel,clas = len2clas[cellen];
+  size_t ip;
+  ub8 t0;
+
+  reg = newslab(hb,cellen,clas,0);
+  if (reg == nil) return 1;
+  reg->claspos = round;
+  ub_regs[round] = reg;
+  cnt = min(reg->celcnt,Ub_maxcels);
+
+  if (ub_allcels(reg,cnt,Ub_newfresh,round) != cnt) return 1;
+
+  ub_frecels(hb,reg,cnt,Ub_frecel,round);
+  if (ub_allcels(reg,cnt,Ub_newbin,round) != cnt) return 1;
+
+  half = cnt / 2;
+  ub_shuffle(ub_cels,cnt);
+  ub_frecels(hb,reg,half,Ub_frerand,round);
+  if (ub_allcels(reg,half,Ub_newfrag,round) != half) return 1;
+
+  // remote
+  t0 = ub_cycles();
+  for (i = 0; i < cnt; i++) {
+    ip = reg->user + (size_t)i * cellen;
+    slab_free_rheap(hd,xhb,reg,ip,0,Lfree);
+  }
+  ub_add(Ub_freremote,round,t0,cnt);
+
+  Atomset(hb->lock,0,Morel); // owner heap is trylocked
+  t0 = ub_cycles();
+  slab_unbuffer(xhb,Lfree,0);
+  ub_add(Ub_unbuffer,round,t0,cnt);
+  Atomset(hb->lock,1,Morel);
+
+  t0 = ub_cycles();
+  cel = slab_newcel(reg,Lalloc); // binned from remote
+  ub_add(Ub_remalloc,round,t0,cnt);
+  if (cel == Nocel) return 1;
+  if (ub_allcels(reg,cnt - 1,Ub_newremote,round) != cnt - 1) return 1;
+
+  return 0;
+}
+
+static void ub_find(heap *hb,ub4 round)
+{
+  ub4 i;
+  region *reg;
+  xregion *xreg;
+  size_t sum = 0;
+  ub8 t0;
+
+  for (i = 0; i < Ub_finds; i++) {
+    reg = ub_regs[ub_rnd(Ub_rounds)];
+    ub_ips[i] = reg->user + ub_rnd(reg->celcnt) * reg->cellen;
+  }
+
+  t0 = ub_cycles();
+  for (i = 0; i < Ub_finds; i++) {
+    xreg = findregion(hb,ub_ips[i],Lfree);
+    sum += (size_t)xreg;
+  }
+  ub_add(Ub_findreg,round,t0,Ub_finds);
+
+  t0 = ub_cycles();
+  for (i = 0; i < Ub_finds; i++) {
+    xreg = findgregion(Lfree,ub_ips[i]);
+    sum -= (size_t)xreg;
+  }
+  ub_add(Ub_findgreg,round,t0,Ub_finds);
+  if (sum) minidiag(Yfln,Lnone,Warn,0,"findregion and findgregion differ");
+}
+
+static void ub_class(ub4 round)
+{
+  ub4 i,sum = 0;
+  ub8 t0;
+
+  for (i = 0; i < Ub_lens; i++) ub_lens[i] = (i & 1) ? ub_rnd(Smalclas - 1) + 1 : ub_rnd(1u << 20) + 1;
+
+  t0 = ub_cycles();
+  for (i = 0; i < Ub_lens; i++) sum += ub_clas(ub_lens[i]);
+  ub_add(Ub_clas,round,t0,Ub_lens);
+  ub_lens[0] = sum;
+}
+
+static void ub_bump(heapdesc *hd,heap *hb,ub4 round)
+{
+  ub4 i,b,n = 0;
+  size_t ip;
+  bregion *reg;
+  ub8 t0;
+
+  t0 = ub_cycles();
+  for (i = 0; i < Ub_bumps; i++) {
+    ub_bumps[n] = bump_alloc(hd,hb,16 + (i & 7) * 8,1,Lalloc,0);
+    if (ub_bumps[n] == nil) break;
+    n++;
+  }
+  ub_add(Ub_bumpalloc,round,t0,n);
+
+  t0 = ub_cycles();
+  for (i = 0; i < n; i++) {
+    ip = (size_t)ub_bumps[i];
+    for (b = 0; b < Bumpregions; b++) {
+      reg = hb->bumpregs + b;
+      if (ip - reg->user < reg->len) { bump_free(hd,hb,reg,ip,0,0,Lfree); break; }
+    }
+  }
+  ub_add(Ub_bumpfree,round,t0,n);
+}
+
+static size_t ub_median(size_t *a)
+{
+  ub4 i,j;
+  size_t x;
+
+  for (i = 1; i < Ub_rounds; i++) {
+    x = a[i];
+    for (j = i; j && a[j - 1] > x; j--) a[j] = a[j - 1];
+    a[j] = x;
+  }
+  return a[Ub_rounds / 2];
+}
+
+static void ub_report(ub4 cellen)
+{
+  char buf[4096];
+  ub4 pos,len = 4000;
+  ub4 op;
+  size_t med;
+
+  pos = snprintf_mini(buf,0,len,"yalloc %s ubench cellen %u cels %u .. %u rounds %u - median of rounds, in cycles per op\n\n",
+    yal_version,cellen,ub_regs[0]->celcnt,ub_regs[Ub_rounds - 1]->celcnt,Ub_rounds);
+  for (op = 0; op < Ub_count; op++) {
+    med = ub_median(ub_res[op]);
+    pos += snprintf_mini(buf,pos,len,"  %-18s %6zu.%zu  %u ops\n",ub_names[op],med / 10,med % 10,ub_ops[op]);
+  }
+  oswrite(1,buf,pos,Yfln);
+}
+
+int main(int argc,char *argv[])
+{
+  heapdesc *hd;
+  heap *hb,*xhb;
+  void * volatile p;
+  ub4 round,cellen = 64;
+
+  if (argc > 1) cellen = atou(argv[1]);
+  if (cellen == 0 || cellen >= Smalclas) {
+    minidiag(Yfln,Lnone,Error,0,"usage: ubench [cellen] - cellen 1 .. %u",Smalclas - 1);
+    return 1;
+  }
+  cellen = clas2len[len2clas[cellen]];
+
+  p = malloc(16); // init
+  free(p);
+
+  hd = getheapdesc(Lalloc);
+  hb = heap_new(hd,Lalloc,Yfln); // locked
+  xhb = heap_new(hd,Lalloc,Yfln);
+  if (hb == nil || xhb == nil || hb == xhb) return 1;
+
+  for (round = 0; round < Ub_rounds; round++) {
+    ub_class(round);
+    if (ub_slab(hd,hb,xhb,cellen,round)) {
+      minidiag(Yfln,Lnone,Error,0,"round %u cellen %u incomplete",round,cellen);
+      return 1;
+    }
+    ub_bump(hd,hb,round);
+  }
+  for (round = 0; round < Ub_rounds; round++) ub_find(hb,round);
+
+  ub_report(cellen);
+  return 0;
+}
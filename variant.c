@@ -0,0 +1,148 @@
+/* variant.c - select a checked or a fast build of yalloc at startup
+
+   This file is part of yalloc, yet another memory allocator providing affordable safety in a compact package.
+
+   SPDX-FileCopyrightText: © 2024 Joris van der Geer
+   SPDX-License-Identifier: GPL-3.0-or-later
+
+   build.sh -F compiles yalloc.c twice: as configured, and without checks, trace, full stats and tags, see Yal_fast_flags there.
+   The exported symbols of each are prefixed with yal_safe_ and yal_fast_, and linked with this file into one yalloc.o
+   The first call picks the build for the process: fast if Yalloc_check is 0 and neither Yalloc_stats nor Yalloc_trace is set.
+   Each entry below then calls the picked one directly. variant_gen.h lists the entries present, as generated by build.sh
+*/
+
+#include <stddef.h> // size_t
+#include <stdatomic.h>
+
+#include "malloc.h"
+
+#include "variant_gen.h"
+
+extern char *getenv(const char *name); // no <stdlib.h> as its malloc() defines may not be compatible
+
+static _Atomic unsigned int variant; // 0 - not yet 1 - safe 2 - fast
+
+static int envnum(const char *name)
+{
+  const char *s = getenv(name);
+  int n = 0;
+
+  if (s == NULL) return -1;
+  while (*s >= '0' && *s <= '9') n = n * 10 + (*s++ - '0');
+  return n;
+}
+
+static __attribute__((cold,noinline)) unsigned int pickvariant(void)
+{
+  unsigned int v = 1;
+
+  if (envnum("Yalloc_check") == 0 && envnum("Yalloc_stats") <= 0 && envnum("Yalloc_trace") <= 0) v = 2;
+  atomic_store_explicit(&variant,v,memory_order_relaxed); // any race stores the same
+  return v;
+}
+
+static inline int isfast(void)
+{
+  unsigned int v = atomic_load_explicit(&variant,memory_order_relaxed);
+
+  if (__builtin_expect(v == 0,0)) v = pickvariant();
+  return v == 2;
+}
+
+#define Vfn(rt,fn,args,call) \
+  extern rt yal_safe_##fn args; \
+  extern rt yal_fast_##fn args; \
+  rt fn args { return isfast() ? yal_fast_##fn call : yal_safe_##fn call; }
+
+#define Vvfn(fn,args,call) \
+  extern void yal_safe_##fn args; \
+  extern void yal_fast_##fn args; \
+  void fn args { if (isfast()) yal_fast_##fn call; else yal_safe_##fn call; }
+
+// std
+Vfn(void *,malloc,(size_t len),(len))
+Vfn(void *,calloc,(size_t cnt,size_t len),(cnt,len))
+Vfn(void *,realloc,(void *p,size_t len),(p,len))
+Vvfn(free,(void *p),(p))
+Vfn(void *,aligned_alloc,(size_t align,size_t len),(align,len))
+Vfn(int,posix_memalign,(void **pp,size_t align,size_t len),(pp,align,len))
+Vfn(void *,memalign,(size_t align,size_t len),(align,len))
+Vfn(size_t,malloc_usable_size,(void *p),(p))
+
+#ifdef Yal_v_valloc
+ Vfn(void *,valloc,(size_t len),(len))
+#endif
+#ifdef Yal_v_pvalloc
+ Vfn(void *,pvalloc,(size_t len),(len))
+#endif
+#ifdef Yal_v___libc_memalign
+ Vfn(void *,__libc_memalign,(size_t align,size_t len),(align,len))
+#endif
+#ifdef Yal_v_reallocarray
+ Vfn(void *,reallocarray,(void *p,size_t cnt,size_t len),(p,cnt,len))
+#endif
+#ifdef Yal_v_reallocf
+ Vfn(void *,reallocf,(void *p,size_t len),(p,len))
+#endif
+#ifdef Yal_v_malloc_size
+ Vfn(size_t,malloc_size,(const void *p),(p))
+#endif
+#ifdef Yal_v_free_sized
+ Vvfn(free_sized,(void *p,size_t len),(p,len))
+#endif
+#ifdef Yal_v_free_aligned_sized
+ Vvfn(free_aligned_sized,(void *p,size_t align,size_t len),(p,align,len))
+#endif
+
+// glibc
+#ifdef Yal_v_malloc_stats
+ Vvfn(malloc_stats,(void),())
+#endif
+#ifdef Yal_v_malloc_trim
+ Vfn(int,malloc_trim,(size_t pad),(pad))
+#endif
+#ifdef Yal_v_mallopt
+ Vfn(int,mallopt,(int param,int val),(param,val))
+#endif
+#ifdef Yal_v_mallinfo2
+ Vfn(struct mallinfo2 *,mallinfo2,(void),())
+#endif
+
+// jemalloc
+Vfn(void *,__je_bootstrap_malloc,(size_t len),(len))
+Vfn(void *,__je_bootstrap_calloc,(size_t cnt,size_t len),(cnt,len))
+Vvfn(__je_bootstrap_free,(void *p),(p))
+
+// extensions
+#ifdef Yal_v_yal_mstats
+ Vfn(size_t,yal_mstats,(struct yal_stats *sp,unsigned int opts,unsigned int tag,const char *desc),(sp,opts,tag,desc))
+#endif
+Vfn(size_t,yal_stats_export,(char *buf,size_t len,unsigned int opts,unsigned int tag),(buf,len,opts,tag))
+Vfn(size_t,yal_stats_snap,(struct yal_snap *snaps,size_t cnt),(snaps,cnt))
+Vfn(size_t,yal_stats_delta,(const struct yal_snap *prv,const struct yal_snap *cur,struct yal_snap *rate),(prv,cur,rate))
+Vfn(size_t,yal_heapprofile,(int fd),(fd))
+
+#ifdef Yal_v_yal_options
+ Vfn(unsigned int,yal_options,(enum Yal_options opt,size_t arg1,size_t arg2),(opt,arg1,arg2))
+ Vfn(void *,yal_alloc,(size_t len,unsigned int tag),(len,tag))
+ Vfn(void *,yal_calloc,(size_t len,unsigned int tag),(len,tag))
+ Vvfn(yal_free,(void *p,unsigned int tag),(p,tag))
+ Vfn(void *,yal_realloc,(void *p,size_t olen,size_t len,unsigned int tag),(p,olen,len,tag))
+ Vfn(void *,yal_aligned_alloc,(size_t align,size_t len,unsigned int tag),(align,len,tag))
+ Vfn(size_t,yal_getsize,(void *p,unsigned int tag),(p,tag))
+ Vfn(size_t,yal_alloc_batch,(size_t len,void **ptrs,size_t cnt,unsigned int tag),(len,ptrs,cnt,tag))
+ Vvfn(yal_free_batch,(void **ptrs,size_t cnt,unsigned int tag),(ptrs,cnt,tag))
+ Vfn(size_t,yal_trim,(unsigned int hid,unsigned int effort,size_t pad,unsigned int tag),(hid,effort,pad,tag))
+#endif
+
+Vfn(yal_arena *,yal_arena_create,(size_t len,unsigned int tag),(len,tag))
+Vfn(void *,yal_arena_alloc,(yal_arena *arena,size_t len,size_t align,unsigned int tag),(arena,len,align,tag))
+Vvfn(yal_arena_destroy,(yal_arena *arena,unsigned int tag),(arena,tag))
+
+Vfn(yal_pool *,yal_pool_create,(size_t cellen,size_t align,unsigned int flags),(cellen,align,flags))
+Vfn(void *,yal_pool_alloc,(yal_pool *pool,unsigned int tag),(pool,tag))
+Vvfn(yal_pool_free,(yal_pool *pool,void *p,unsigned int tag),(pool,p,tag))
+Vvfn(yal_pool_destroy,(yal_pool *pool,unsigned int tag),(pool,tag))
+
+Vfn(size_t,yal_reserve,(size_t len,size_t cnt,unsigned int tag),(len,cnt,tag))
+Vvfn(yal_mem_callback,(yal_mem_pressure *fn,void *arg),(fn,arg))
@@ -64,7 +64,21 @@
 
 #endif // Dev
 
-#if Yal_signal
+#if Yal_enable_stats == 0
+ #undef Yal_enable_export
+ #define Yal_enable_export 0
+ #undef Yal_enable_lat
+ #define Yal_enable_lat 0
+#endif
+
+#if Yal_enable_extensions == 0
+ #undef Yal_enable_arena
+ #define Yal_enable_arena 0
+ #undef Yal_enable_pool
+ #define Yal_enable_pool 0
+#endif
+
+#if Yal_signal || (Yal_enable_export && Yal_export_signal)
  #undef _POSIX_C_SOURCE
  #define _POSIX_C_SOURCE 199309L // needs to be at first system header
  #undef __XSI_VISIBLE
@@ -72,6 +86,21 @@
  #include <signal.h>
 #endif
 
+#if Yal_percpu // heaps are shared by all threads on a cpu
+ #undef Yal_enable_private
+ #define Yal_enable_private 0
+
+ #if defined __linux__ && defined __has_include
+  #if __has_include(<sys/rseq.h>)
+   #include <sys/rseq.h> // cpu_id kept current by the kernel in the area registered by glibc
+   #define Yal_rseq 1
+  #endif
+ #endif
+#endif
+#ifndef Yal_rseq
+ #define Yal_rseq 0
+#endif
+
 #include <stddef.h> // size_t
 #include <limits.h> // UINT_MAX
 
@@ -255,9 +284,9 @@ static int newlogfile(cchar *name[],cchar *suffix,ub4 id,unsigned long pid)
   return fd;
 }
 
-enum File { Falloc,Fatom,Fbist,Fboot,Fbump,Fdbg,Fdiag,Ffree,Fheap,Fmini,Frealloc,Fregion,Fsize,Fslab,Fstat,Fstd,Fyalloc,Fcount };
+enum File { Falloc,Farena,Fatom,Fbg,Fbist,Fboot,Fbump,Fdbg,Fdiag,Fexport,Ffork,Ffree,Fheap,Fhist,Flat,Fmag,Fmemlimit,Fmini,Fpool,Fprof,Frealloc,Frec,Fregion,Freserve,Fsize,Fslab,Fstat,Fstd,Fyalloc,Fcount };
 static cchar * const filenames[Fcount] = {
-  "alloc.h","atom","bist.h","boot.h","bump.h","dbg.h","diag.h","free.h","heap.h","mini.h","realloc.h","region.h","size","slab.h","stats.h","std.h","yalloc.c"
+  "alloc.h","arena.h","atom","bg.h","bist.h","boot.h","bump.h","dbg.h","diag.h","export.h","fork.h","free.h","heap.h","hist.h","lat.h","mag.h","memlimit.h","mini.h","pool.h","prof.h","realloc.h","rec.h","region.h","reserve.h","size","slab.h","stats.h","std.h","yalloc.c"
 };
 
 #define Trcnames 256
@@ -348,8 +377,8 @@ static Printf(5,6) ub4 minidiag(ub4 fln,enum Loc loc,enum Loglvl lvl,ub4 id,char
 
 // -- main admin structures --
 
-enum Rtype { Rnone,Rslab,Rbump,Rmini,Rmmap,Rcount };
-static cchar * const regnames[Rcount + 1] = { "none","slab","bump","mini","mmap", "?" };
+enum Rtype { Rnone,Rslab,Rbump,Rmini,Rmmap,Rarena,Rcount };
+static cchar * const regnames[Rcount + 1] = { "none","slab","bump","mini","mmap","arena", "?" };
 
 enum Status { St_ok, St_oom,St_tmo,St_intr,St_error,St_free2,St_nolock,St_trim };
 
@@ -359,6 +388,7 @@ typedef unsigned char celset_t;
 struct regstat {
   size_t allocs,Allocs,callocs,binallocs,iniallocs,xallocs;
   size_t frees,rfrees;
+  size_t lenskips; // net len not stored
   ub4 minlen,maxlen;
   size_t rbin;
   size_t invalidfrees;
@@ -414,6 +444,7 @@ struct Align(16) st_mpregion { // mmap region. allocated as pool from heap
   _Atomic ub4 age;
   ub4 aged;
   ub4 real;
+  size_t rsvlen; // reserved address space directly after len
 };
 typedef struct st_mpregion mpregion;
 
@@ -440,7 +471,7 @@ struct Align(16) st_bregion { // bump region. statically present in heap
   ub4 freorg;
   ub4 tagorg;
 
-  ub4 filler;
+  ub4 trimpos; // user below is decommitted
 
   ub8 uid;
 
@@ -491,6 +522,9 @@ struct Align(16) st_region { // slab region. allocated as pool from heap
 
   // bin
   ub4 binpos;
+  ub4 bmap; // bin is a bitmap, see slab.h
+  ub4 lenset; // net len stored per cel, see Yal_lazy_len
+  ub4 bmlo; // lowest bitmap word possibly nonzero
 
   ub4 claseq;
   ub4 celord;  //   cel len if pwr2 0 if not
@@ -508,11 +542,19 @@ struct Align(16) st_region { // slab region. allocated as pool from heap
   ub4 * _Atomic rembin; // allocated on demand by sender from sender's heapmem
   _Atomic ub4 remref; // todo
 
+  // remote list, if Yal_remote_mpsc
+  _Atomic ub4 remhead; // cel + 1 of last pushed
+  ub4 rempend; // cel + 1 held back at detach, its link not yet written
+  size_t remorg; // offset in meta
+
   ub4 rbinpos;
   ub4 rbinlen,rbininc;
 
   ub4 aged;
   ub4 inuse;
+  ub4 real; // served realloc growth
+  ub4 huge; // user block on huge pages, trimmed as a whole only
+  size_t dirty; // user len possibly resident from previous uses
 
   size_t prvlen,prvmetalen;
 
@@ -541,27 +583,48 @@ struct rembuf {
   Ub8 seq[Clascnt];
 };
 
+// findregion() cache entry, validated by uid
+struct regcache {
+  region *reg;
+  ub8 uid;
+};
+
+enum Clasmode { Clas_default,Clas_slab };
+
+// per size class, as used together by alloc. Within one cache line
+struct Align(L1line) clasinfo {
+  ub4 cnt; // track popularity of sizes
+  ub4 len; // size covered
+  Ub8 msk; // bit mask for clasregs having space
+  Ub8 fremsk; // bit mask for empty clasregs
+  ub2 pos; // currently used
+  ub2 regcnt; // #regions per class
+  ub4 mode; // Clas_slab if moved from bump by clas_adapt()
+  struct st_region *smal; // current, for small classes
+
+  ub4 rate,ratetick; // slow path allocs, decaying per heap tick
+  ub4 bumpallocs; // bump blocks of this len
+};
+
+// per size class, written by freeing threads. Kept apart from clasinfo to leave its lines to the owner
+struct Align(L1line) clasremote {
+  _Atomic ub4 bumpfrees[Xclascnt]; // bump blocks of this len
+};
+
 // thread heap base including starter kit. page-aligned
 struct Align(16) st_heap {
   _Atomic ub4 lock;
   ub4 id; // ident
+  _Atomic ub4 incall; // owner of a private heap is in a call, see fork.h
 
-  char l1fill[L1line - 8];
+  char l1fill[L1line - 12];
 
   // slab allocator
-  ub4 clascnts[Xclascnt]; // track popularity of sizes
-  ub4 claslens[Xclascnt]; // size covered
-
-  ub2 claspos[Clascnt]; // currently used
-  Ub8 clasmsk[Clascnt]; // bit mask for clasregs having space
-  Ub8 cfremsk[Xclascnt]; // bit mask for empty clasregs
-
-  ub2 clasregcnt[Clascnt]; // #regions per class
+  struct clasinfo clasinf[Xclascnt];
+  struct clasremote clasrem;
 
   struct st_region *clasregs[Clascnt * Clasregs];
 
-  struct st_region *smalclas[Clascnt];
-
   // region bases
   struct st_region *regmem;
   struct st_mpregion *xregmem;
@@ -572,8 +635,12 @@ struct Align(16) st_heap {
   struct st_region * freeregs[Regorder + 1];
   struct st_mpregion* freempregs[Vmbits + 1];
   struct st_mpregion* freemp0regs;
+  size_t mpcachelen; // bytes in freempregs
 
   struct st_heap *nxt; // list for reassign
+  struct st_pool *pool; // if private to pool, see pool.h
+  ub4 poolheap;
+  ub4 forkheld; // how fork_prepare() holds it, see fork.h
 
   // page dir root
   struct st_xregion *** rootdir[Dir1len];
@@ -584,6 +651,10 @@ struct Align(16) st_heap {
   ub4 dirmem_pos,ldirmem_pos;
   ub4 dirmem_top,ldirmem_top;
 
+#if Regcache_len
+  struct regcache regcache[Regcache_len]; // recent findregion() hits
+#endif
+
   // region lists
   struct st_region *reglst,*regprv,*regtrim;// todo prv for stats ?
   struct st_mpregion *mpreglst,*mpregprv,*mpregtrim;
@@ -596,14 +667,15 @@ struct Align(16) st_heap {
   ub4 *rbinmem;  // mempool for rembins
   ub4 rbmempos,rbmemlen;
 
-  ub4 trimcnt;
+  ub4 trimcnt; // ticks, see free_tick()
   _Atomic ub4 locfln;
 
   struct yal_stats stat;
 
   ub4 rmeminc;
-
-  char filler[12];
+  ub4 node; // numa node at creation
+  ub4 pressure; // memlimit round handled
+  ub4 bgtick; // trimcnt at last background visit
 
   // bump allocator
   struct st_bregion bumpregs[Bumpregions];
@@ -621,10 +693,17 @@ struct hdstats {
   size_t invalid_frees,errors;
   size_t xmapfrees;
   size_t delregions,munmaps;
+  size_t magallocs,magfrees,magfills,magdrains,magflushes;
+  size_t arenas,arenachunks,arenaallocs,arenabytes,arenafrees;
+  size_t alclasallocs;
+  size_t apiallocs,apireallocs,apifrees; // for yal_stats_snap()
+  size_t ownerfrees,ownerbusy; // remote slab free: owner heap locked or busy
+#if Yal_enable_lat
+  size_t lats[Yal_lat_count][32]; // api calls and trim
+#endif
 };
 
-#if Yal_thread_exit // install thread exit handler to recycle heap descriptor
-  #include <pthread.h>
+#if Yal_thread_exit // install thread exit handler to hand over heap and recycle heap descriptor
   #include "thread.h"
 #endif
 
@@ -632,6 +711,48 @@ struct hdstats {
 
 enum Tidstate { Ts_init,Ts_mt,Ts_private };
 
+#if Yal_enable_magazine
+#define Magclas 32 // covers len2clas[Magazine_len - 1]
+
+// per-thread cache of small cells, all from slab regions in one heap
+struct magcel {
+  struct st_region *reg;
+  ub4 cel;
+  ub4 filler;
+};
+
+struct magazine {
+  struct st_heap *hb; // owner of all cached cells
+  ub4 cnt; // total cached
+  ub4 frees; // for the heap tick, see mag_tick()
+  ub4 cnts[Magclas];
+  struct magcel cels[Magclas][Magazine_cnt]; // LIFO per class
+};
+#endif
+
+#if Yal_enable_stats == 0
+ #undef Yal_enable_hist
+ #define Yal_enable_hist 0
+#endif
+
+#if Yal_enable_hist // see hist.h
+#define Hist_lens 160 // 4 steps per pwr2, as in struct yal_stats
+#define Hist_lives 32
+#define Hist_clas 128
+#define Hist_tags 32
+
+struct hdhist {
+  size_t trkips[Hist_track]; // sampled blocks
+  size_t trkticks[Hist_track];
+  size_t allocs,frees,lives;
+  size_t reqlens[Hist_lens],grantlens[Hist_lens];
+  size_t lifetimes[Hist_lives];
+  size_t clasfrees[Hist_clas],clasxfrees[Hist_clas];
+  ub4 tags[Hist_tags];
+  size_t tagbytes[Hist_tags],tagcnts[Hist_tags];
+};
+#endif
+
 struct Align(L1line) st_heapdesc {
   struct st_heapdesc *nxt,*frenxt;
   struct st_heap *hb;
@@ -656,16 +777,34 @@ struct Align(L1line) st_heapdesc {
   ub1 minicnts[Miniord];
   ub4 minidir;
 
+#if Yal_enable_magazine
+  struct magazine *mag;
+  size_t magip; // free() not taken by the magazine, with its region as found there
+  struct st_xregion *magreg;
+#endif
+
+#if Yal_enable_hist
+  size_t histallocs,histfrees; // calls, as tick
+  struct hdhist *hist;
+#endif
+
+#if Yal_enable_prof
+  long profleft; // bytes to next sample
+  ub8 profrnd;
+  ub4 inprof;
+#endif
+
+#if Yal_enable_rec
+  struct recring *rec;
+  ub4 inrec;
+#endif
+
 #if Yal_enable_stack
   ub4 flnstack[Yal_stack_len];
   ub1 locstack[Yal_stack_len];
   ub4 flnpos;
   // ub4 tag;
 #endif
-
-#if Yal_thread_exit
-  Thread_clean_info thread_clean_info;
-#endif
 };
 typedef struct st_heapdesc heapdesc;
 
@@ -676,21 +815,11 @@ static ub4 global_check = Yal_check_default;
 static heapdesc * _Atomic global_freehds;
 
 #if Yal_thread_exit // install thread exit handler to recycle heap descriptor
-  // add hd to head of free list
-  static void thread_cleaner(void *arg)
-  {
-     heapdesc *hd = (heapdesc *)arg;
-     heapdesc *prv = Atomget(global_freehds,Moacq);
-
-     // minidiag(Yfln,Lnone,Info,0,"thread %u exit ",hd->id);
-
-     hd->frenxt = prv;
-     Cas(global_freehds,prv,hd);
-  }
+  static void thread_cleaner(void *arg); // free.h
 
   static void thread_setclean(heapdesc *hd)
   {
-     Thread_clean_push(&hd->thread_clean_info,thread_cleaner, hd);
+     thread_setkey(thread_cleaner,hd);
   }
 #else
   static void thread_setclean(Unused heapdesc * hd) { }
@@ -704,6 +833,24 @@ static ub4 *global_zeroblock; // malloc(0)
 
 static struct st_heapdesc * _Atomic global_heapdescs;
 static struct st_heap * _Atomic global_heaps;
+static struct st_heap * _Atomic global_heaphint; // heap_new() scan start
+static _Atomic ub4 global_forking; // fork_prepare() holds the heaps, see fork.h
+
+#if Yal_percpu
+static struct st_heap * _Atomic global_cpuheaps[Maxcpu];
+
+// current cpu. Read directly from the rseq area if registered
+static inline ub4 cpu_id(void)
+{
+#if Yal_rseq
+  if (likely(__rseq_size != 0)) {
+    const struct rseq *rs = (const struct rseq *)((char *)__builtin_thread_pointer() + __rseq_offset);
+    return *(volatile const ub4 *)&rs->cpu_id & (Maxcpu - 1);
+  }
+#endif
+  return oscpu() & (Maxcpu - 1);
+}
+#endif
 
 static _Atomic ub4 global_tid;
 static _Atomic ub4 global_hid = 1;
@@ -863,10 +1010,10 @@ static _Atomic ub4 global_hid = 1;
 
 static heapdesc *new_heapdesc(enum Loc loc)
 {
-  heapdesc *org,*hd;
+  heapdesc *org,*hd,*nxt;
   ub4 id,iter;
   ub4 len = sizeof(struct st_heapdesc);
-  bool didcas;
+  bool didcas,reuse = 0;
   unsigned long caller = Caller();
   static heapdesc firstbase;
 
@@ -879,6 +1026,11 @@ static heapdesc *new_heapdesc(enum Loc loc)
     tid_sethd(hd);
     thread_setclean(hd);
     hd->id = id;
+    iter = 20;
+    do { // as below, for stats
+      org = hd->nxt = Atomget(global_heapdescs,Moacq);
+      didcas = Cas(global_heapdescs,org,hd);
+    } while (didcas == 0 && --iter);
     init_env();
     hd->trace = global_trace & 3;
     hd->trcfln = global_trace & 8;
@@ -893,12 +1045,32 @@ static heapdesc *new_heapdesc(enum Loc loc)
     org = hd->frenxt;
     didcas = Cas(global_freehds,hd,org);
     if (didcas) {
+      nxt = hd->nxt; // already in global_heapdescs
+#if Yal_enable_magazine
+      struct magazine *mg = hd->mag; // cached cells stay valid for the next thread
+#endif
+#if Yal_enable_hist
+      struct hdhist *hs = hd->hist; // keeps accumulating for stats
+#endif
+#if Yal_enable_rec
+      struct recring *rp = hd->rec; // pending records flushed by the next thread
+#endif
       memset(hd,0,sizeof(heapdesc));
-      tid_sethd(hd);
-      thread_setclean(hd);
+#if Yal_enable_magazine
+      hd->mag = mg;
+#endif
+#if Yal_enable_hist
+      hd->hist = hs;
+#endif
+#if Yal_enable_rec
+      hd->rec = rp;
+#endif
+      hd->nxt = nxt;
+      reuse = 1;
       minidiag(Yfln,loc,Debug,id,"use base heap %u size %u.%u caller %lx",hd->id,len,(ub4)sizeof(struct hdstats),caller);
-    }
-  } else { // new, common case
+    } else hd = nil;
+  }
+  if (hd == nil) { // new, common case
     hd = bootalloc(Yfln,id,loc,len);
     minidiag(Yfln,loc,Debug,id,"new base heap size %u.%u caller %lx",len,(ub4)sizeof(struct hdstats),caller);
   }
@@ -916,12 +1088,14 @@ static heapdesc *new_heapdesc(enum Loc loc)
   iter = 20;
 
   // create list of all heapdescs for stats
-  do {
-    org = hd->nxt = Atomget(global_heapdescs,Moacq);
-    didcas = Cas(global_heapdescs,org,hd);
-  } while (didcas == 0 && --iter);
+  if (reuse == 0) {
+    do {
+      org = hd->nxt = Atomget(global_heapdescs,Moacq);
+      didcas = Cas(global_heapdescs,org,hd);
+    } while (didcas == 0 && --iter);
 
-  if (didcas == 0) hd->stat.nolink++; // not essential
+    if (didcas == 0) hd->stat.nolink++; // not essential
+  }
 
   hd->id = id;
   hd->trace = global_trace & 3;
@@ -943,6 +1117,14 @@ static Hot heapdesc *getheapdesc(enum Loc loc)
   hd = tid_gethd();
 
   if (likely(hd != nil)) {
+#if Yal_percpu
+    heap *chb;
+
+    if (likely(hd->hb != nil)) { // first heap via heap_new(), adding mini to dir
+      chb = Atomget(global_cpuheaps[cpu_id()],Moacq);
+      if (likely(chb != nil)) hd->hb = chb;
+    }
+#endif
     if (hd->tidstate != Ts_private) return hd;
 #if Yal_enable_private == 1
     tic = hd->ticker;
@@ -981,6 +1163,19 @@ static cchar *regname(xregion *reg)
 static _Atomic unsigned int global_mapadd;
 static _Atomic unsigned int global_mapdel;
 
+#if Yal_enable_memlimit
+  #include "memlimit.h"
+#else
+  #define mem_charge(len) 1
+  static inline void mem_uncharge(size_t Unused len) {}
+  #define mem_room(len) 1
+  #define mem_soft() 0
+  #define mem_overlimit 0
+  static inline void mem_tick(void) {}
+  static void init_memlimit(void) {}
+  void yal_mem_callback(yal_mem_pressure Unused *fn,void Unused *arg) {}
+#endif
+
 static ub1 mapshifts[24] = { // progressively increase region sizes the more we have
   0,0,0,0,
   0,0,1,1, // 8
@@ -989,6 +1184,22 @@ static ub1 mapshifts[24] = { // progressively increase region sizes the more we
   5,6,7,8,
   10,12,14,14 };
 
+#if Yal_enable_lat
+  #include "lat.h"
+#else
+  #define Latstart
+  #define Latend(sp,op)
+#endif
+
+// a private heap is used without lock. Its calls are marked for fork_prepare() to wait on, see fork.h
+#if Yal_enable_fork && Yal_enable_private
+  #define priv_enter(hb) { Atomset((hb)->incall,1,Monone); Atomfence(Morel); }
+  #define priv_leave(hb) Atomset((hb)->incall,0,Morel);
+#else
+  #define priv_enter(hb)
+  #define priv_leave(hb)
+#endif
+
 #include "heap.h"
 
 static void *oom(heap *hb,ub4 fln,enum Loc loc,size_t n1,size_t n2)
@@ -998,7 +1209,7 @@ static void *oom(heap *hb,ub4 fln,enum Loc loc,size_t n1,size_t n2)
   if (n2) snprintf_mini(buf,0,64," * %zu`",n2);
   else *buf = 0;
 
-  do_ylog(Yal_diag_oom,loc,fln,Error,0,"heap %u out of memory allocating %zu`%s",hb ? hb->id : 0,n1,buf);
+  do_ylog(Yal_diag_oom,loc,fln,mem_overlimit ? Warn : Error,0,"heap %u out of memory allocating %zu`%s",hb ? hb->id : 0,n1,buf);
   Enomem
   return nil;
 }
@@ -1016,7 +1227,8 @@ static void *osmem(ub4 fln,ub4 hid,size_t len,cchar *desc)
 
   // if (len <= Pagesize) do_ylog(Diagcode,Lnone,fln,len < Pagesize ? Warn : Info,0,"heap %u osmem len %u %s",hid,(ub4)len,desc);
 
-  p = osmmap(len);
+  if (unlikely(mem_charge(len) == 0)) p = nil; // over limit
+  else if ( (p = osmmap(len)) == nil) mem_uncharge(len);
   // ydbg1(fln,Lnone,"hid %-2u osmem %-6zu` = %-7zx %s",hid,len,(size_t)p,desc)
   if (p) {
     Atomad(global_mapadd,1,Monone);
@@ -1028,6 +1240,43 @@ static void *osmem(ub4 fln,ub4 hid,size_t len,cchar *desc)
   return p;
 }
 
+#if Yal_enable_numa
+// prefer the heap's node for new memory
+static void osnodebind(heap *hb,void *p,size_t len)
+{
+  ub4 node;
+
+  if (hb == nil) return; // mini
+  node = hb->node;
+  if (osmbind(p,len,node)) {
+    hb->stat.numafails++;
+    return;
+  }
+  hb->stat.nodebytes[node & (Numa_nodes - 1)] += len;
+}
+#else
+ #define osnodebind(hb,p,len)
+#endif
+
+#if Yal_huge_pages
+// idem, aligned to and backed by huge pages where available
+static void *oshugemem(ub4 fln,ub4 hid,size_t len,cchar *desc)
+{
+  void *p;
+
+  if (unlikely(mem_charge(len) == 0)) p = nil;
+  else if ( (p = oshugemap(len,Huge_order,Yal_huge_pages > 1)) == nil) mem_uncharge(len);
+  if (p) {
+    Atomad(global_mapadd,1,Monone);
+    return p;
+  }
+
+  errorctx(fln,Lnone,"heap %u %s",hid,desc)
+  oom(nil,Yfln,Lnone,len,0);
+  return p;
+}
+#endif
+
 static bool osunmem(ub4 fln,heapdesc *hd,void *p,size_t len,cchar *desc)
 {
   ydbg3(Lnone,"heap %u osunmem %zu` for %s at %u = %p",hd->id,len,desc,fln & Hi16,p)
@@ -1037,9 +1286,29 @@ static bool osunmem(ub4 fln,heapdesc *hd,void *p,size_t len,cchar *desc)
     return 1;
   }
   Atomad(global_mapdel,1,Monone);
+  mem_uncharge(len);
   return 0;
 }
 
+#if Yal_trim_decommit
+// return pages to the O.S. keeping the mapping. 1 if done, pages then zero with Yal_decommit_zero
+static bool osdecom(heap *hb,size_t p,size_t len)
+{
+  size_t ap = doalign8(p,Pagesize);
+  int rv;
+
+  len -= (ap - p);
+  len &= ~(size_t)Pagesize1;
+  if (len == 0) return 0;
+
+  rv = Yal_decommit_zero ? osdecommitz((void *)ap,len) : osdecommit((void *)ap,len);
+  if (rv) { do_ylog(Diagcode,Lnone,Yfln,Warn,0,"heap %u decommit %zu` at %zx failed - %m",hb->id,len,ap); return 0; }
+  hb->stat.decommits++;
+  hb->stat.decombytes += len;
+  return 1;
+}
+#endif
+
 static ub4 slabstats(region *reg,struct yal_stats *sp,char *buf,ub4 pos,ub4 len,bool print,ub4 opts,ub4 cnt);
 #include "region.h"
 
@@ -1050,6 +1319,82 @@ static ub4 slabstats(region *reg,struct yal_stats *sp,char *buf,ub4 pos,ub4 len,
 
 #include "slab.h"
 
+#if Yal_enable_magazine
+  #include "mag.h"
+#endif
+
+#if Yal_enable_hist
+  #include "hist.h"
+#else
+  #define hist_alloc(hd,p,len,tag)
+  #define hist_free(hd,ip)
+#endif
+
+#if Yal_enable_prof
+  #include "prof.h"
+#else
+  #define prof_alloc(hd,p,len)
+  #define prof_free(p)
+  static void init_prof(void) {}
+  size_t yal_heapprofile(int Unused fd) { return 0; }
+#endif
+
+#if Yal_enable_rec
+  #include "rec.h"
+#else
+  #define yrec(op,p,arg,len,tag)
+  static void init_rec(void) {}
+#endif
+
+#if Yal_enable_export
+  #include "export.h"
+#else
+  static void export_tick(void) {}
+  static void init_export(void) {}
+  size_t yal_stats_export(char Unused *buf,size_t Unused len,ub4 Unused opts,ub4 Unused tag) { return 0; }
+  size_t yal_stats_snap(struct yal_snap Unused *snaps,size_t Unused cnt) { return 0; }
+  size_t yal_stats_delta(const struct yal_snap Unused *prv,const struct yal_snap Unused *cur,struct yal_snap Unused *rate) { return 0; }
+#endif
+
+#if Yal_enable_arena
+  #include "arena.h"
+#else
+  yal_arena *yal_arena_create(size_t Unused len,ub4 Unused tag) { return nil; }
+  void *yal_arena_alloc(yal_arena Unused *arena,size_t Unused len,size_t Unused align,ub4 Unused tag) { return nil; }
+  void yal_arena_destroy(yal_arena Unused *arena,ub4 Unused tag) {}
+#endif
+
+#if Yal_enable_pool
+  #include "pool.h"
+#else
+  yal_pool *yal_pool_create(size_t Unused cellen,size_t Unused align,ub4 Unused flags) { return nil; }
+  void *yal_pool_alloc(yal_pool Unused *pool,ub4 Unused tag) { return nil; }
+  void yal_pool_free(yal_pool Unused *pool,void Unused *p,ub4 Unused tag) {}
+  void yal_pool_destroy(yal_pool Unused *pool,ub4 Unused tag) {}
+#endif
+
+#if Yal_enable_reserve
+  #include "reserve.h"
+#else
+  #define reserve_env(hb)
+  static void init_reserve(void) {}
+  size_t yal_reserve(size_t Unused size,size_t Unused cnt,ub4 Unused tag) { return 0; }
+#endif
+
+#if Yal_enable_bg
+  #include "bg.h"
+#else
+  #define bg_recent(hb) 0
+  static inline void bg_tick(heapdesc Unused *hd) {}
+  static void init_bg(void) {}
+#endif
+
+#if Yal_enable_fork
+  #include "fork.h"
+#else
+  static void init_fork(void) {}
+#endif
+
 #include "size.h"
 #include "free.h"
 
@@ -1082,29 +1427,34 @@ void __je_bootstrap_free(void Unused * p) { } // no metadata or length
 void * yal_alloc(size_t size,unsigned int tag)
 {
   void *p = ymalloc(size,tag + (Fcount << 16));
+  yrec(Yal_rec_malloc,p,0,size,tag)
   return p;
 }
 
 void * yal_calloc(size_t size,unsigned int tag)
 {
   void *p = yalloc(size,Lcalloc,tag + (Fcount << 16));
+  yrec(Yal_rec_calloc,p,1,size,tag)
   return p;
 }
 
 void yal_free(void *p,unsigned int tag)
 {
+  yrec(Yal_rec_free,p,0,0,tag)
   yfree(p,0,tag + (Fcount << 16));
 }
 
 void * yal_realloc(void *p,size_t oldsize,size_t newsize,unsigned int tag)
 {
   void *q = yrealloc(p,oldsize,newsize,tag + (Fcount << 16));
+  yrec(Yal_rec_realloc,q,(size_t)p,newsize,tag)
   return q;
 }
 
 void *yal_aligned_alloc(size_t align, size_t size,ub4 tag)
 {
   void *p = yalloc_align(align,size,tag + (Fcount << 16));
+  yrec(Yal_rec_align,p,align,size,tag)
   return p;
 }
 
@@ -1113,6 +1463,27 @@ size_t yal_getsize(void *p,unsigned int tag)
   return ysize(p,tag + (Fcount << 16));
 }
 
+size_t yal_alloc_batch(size_t size,void **ptrs,size_t cnt,unsigned int tag)
+{
+  size_t i,n = ymalloc_batch(size,ptrs,cnt,tag + (Fcount << 16));
+
+  for (i = 0; Yal_enable_rec && i < n; i++) { yrec(Yal_rec_malloc,ptrs[i],0,size,tag) }
+  return n;
+}
+
+void yal_free_batch(void **ptrs,size_t cnt,unsigned int tag)
+{
+  size_t i;
+
+  for (i = 0; Yal_enable_rec && i < cnt; i++) { yrec(Yal_rec_free,ptrs[i],0,0,tag) } // before the blocks can be reused
+  yfree_batch(ptrs,cnt,tag + (Fcount << 16));
+}
+
+size_t yal_trim(unsigned int hid,unsigned int effort,size_t pad,unsigned int tag)
+{
+  return ytrim(hid,effort,pad,tag + (Fcount << 16));
+}
+
 ub4 yal_options(enum Yal_options opt,size_t arg1,size_t arg2)
 {
   ub4 rv;
@@ -1128,6 +1499,9 @@ ub4 yal_options(enum Yal_options opt,size_t arg1,size_t arg2)
        return trace_name(a1,(char *)arg2);
 
     case Yal_logmask: rv = ylog_mask; ylog_mask = a1; return rv;
+#if Yal_enable_memlimit
+    case Yal_mem_limit: mem_setlimit(arg1,arg2); return 0;
+#endif
     default: do_ylog(Yal_diag_ill,Lnone,Yfln,Warn,0,"unknown option '%d'",opt); return __LINE__;
   }
 }
@@ -1190,6 +1564,11 @@ int malloc_info(int options, void *stream)
 }
 #endif
 
+int malloc_trim(size_t pad)
+{
+  return ytrim(0,Trim_effort,pad,Yfln) != 0;
+}
+
 #if Yal_malloc_stats
 
 void malloc_stats(void)